@@ -0,0 +1,349 @@
+#pragma once
+
+#include "TimeUtils.h"
+#include "Types.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/* Binary log records.
+ * A call site's format string is registered once and gets an id. Every log call then only records the id, a timestamp
+ * and the raw bytes of its arguments; turning that into text is left to the logging service or to the offline decoder.
+ * A record is a LogRecordHeader followed by the encoded arguments, strings being encoded as their length followed by
+ * their characters. In a binary log file the records are preceded by LOG_FILE_MAGIC and every format is defined by a
+ * record with the id LOG_FORMAT_DEFINITION_ID before it's used. */
+
+constexpr std::array<char, 8> LOG_FILE_MAGIC = {'Q', 'L', 'O', 'G', 'B', 'I', 'N', '1'};
+constexpr u32 LOG_FORMAT_DEFINITION_ID = 0;
+
+struct LogRecordHeader
+{
+    u32 formatId = LOG_FORMAT_DEFINITION_ID;
+    /* Size of the encoded arguments that follow */
+    u32 size = 0;
+    Nanos time = 0;
+};
+
+struct LogFormat
+{
+    std::string format;
+    /* One character per argument, see GetLogArgCode */
+    std::string argCodes;
+};
+
+/* Format string known at compile time, so that it can be a template argument and each call site registers only once.
+ * Every {} is replaced by the next argument */
+template <std::size_t N> struct LogFormatString
+{
+    char value[N] = {};
+
+    constexpr LogFormatString() = default;
+    constexpr LogFormatString(char const (&str)[N])
+    {
+        std::copy_n(str, N, value);
+    }
+
+    constexpr std::string_view View() const
+    {
+        return {value, N - 1};
+    }
+
+    constexpr std::size_t CountPlaceholders() const
+    {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i + 1 < N - 1; ++i)
+        {
+            if (value[i] == '{' && value[i + 1] == '}')
+            {
+                ++count;
+                ++i;
+            }
+        }
+        return count;
+    }
+};
+
+/* "{}{}...{}", the format used by the Log(args...) calls that just concatenate their arguments */
+template <std::size_t NumArgs> constexpr auto MakeConcatenationFormat()
+{
+    LogFormatString<NumArgs * 2 + 1> format;
+    for (std::size_t i = 0; i < NumArgs; ++i)
+    {
+        format.value[2 * i] = '{';
+        format.value[2 * i + 1] = '}';
+    }
+    return format;
+}
+
+/* Strings are logged through a view so that their characters are copied straight into the record, enums as their
+ * underlying value */
+template <typename T> inline auto ToLogArg(T const &value)
+{
+    if constexpr (std::is_convertible_v<T const &, std::string_view>)
+    {
+        return std::string_view(value);
+    }
+    else if constexpr (std::is_enum_v<T>)
+    {
+        return static_cast<std::underlying_type_t<T>>(value);
+    }
+    else
+    {
+        static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, long double>, "Type can't be logged");
+        return value;
+    }
+}
+
+template <typename T> using LogArgType = decltype(ToLogArg(std::declval<T const &>()));
+
+template <typename T> constexpr char GetLogArgCode()
+{
+    if constexpr (std::is_same_v<T, std::string_view>)
+        return 's';
+    else if constexpr (std::is_same_v<T, bool>)
+        return 'b';
+    else if constexpr (std::is_same_v<T, char>)
+        return 'c';
+    else if constexpr (std::is_same_v<T, float>)
+        return 'f';
+    else if constexpr (std::is_same_v<T, double>)
+        return 'd';
+    else if constexpr (std::is_signed_v<T>)
+        return "aeil"[std::bit_width(sizeof(T)) - 1];
+    else
+        return "htjm"[std::bit_width(sizeof(T)) - 1];
+}
+
+template <typename... Args> constexpr std::array<char, sizeof...(Args)> LOG_ARG_CODES = {GetLogArgCode<Args>()...};
+
+template <typename T> constexpr std::size_t GetEncodedSize(T const &arg)
+{
+    if constexpr (std::is_same_v<T, std::string_view>)
+        return sizeof(u32) + arg.size();
+    else
+        return sizeof(T);
+}
+
+template <typename T> inline std::byte *EncodeLogArg(std::byte *destination, T const &arg)
+{
+    if constexpr (std::is_same_v<T, std::string_view>)
+    {
+        const auto size = static_cast<u32>(arg.size());
+        std::memcpy(destination, &size, sizeof(size));
+        std::memcpy(destination + sizeof(size), arg.data(), size);
+        return destination + sizeof(size) + size;
+    }
+    else
+    {
+        std::memcpy(destination, &arg, sizeof(arg));
+        return destination + sizeof(arg);
+    }
+}
+
+/* Writes the header and the arguments, which must already have gone through ToLogArg */
+template <typename... Args>
+inline void EncodeLogRecord(std::byte *destination, LogRecordHeader const &header, Args... args)
+{
+    std::memcpy(destination, &header, sizeof(header));
+    destination += sizeof(header);
+    ((destination = EncodeLogArg(destination, args)), ...);
+}
+
+/* Process wide table of the registered formats. Only touched the first time a call site logs and by the logging
+ * service when it finds a format it doesn't know yet */
+class LogFormatRegistry
+{
+public:
+    static u32 Register(std::string_view format, std::string_view argCodes)
+    {
+        auto &state = GetState();
+        std::lock_guard lock(state.mutex);
+
+        state.formats.push_back({std::string(format), std::string(argCodes)});
+        return static_cast<u32>(state.formats.size());
+    }
+
+    /* Appends the formats registered since formats was last synced. formats[id - 1] is the format with that id */
+    static void Sync(std::vector<LogFormat> &formats)
+    {
+        auto &state = GetState();
+        std::lock_guard lock(state.mutex);
+
+        formats.insert(formats.end(), state.formats.begin() + formats.size(), state.formats.end());
+    }
+
+private:
+    struct State
+    {
+        std::mutex mutex;
+        std::vector<LogFormat> formats;
+    };
+
+    static State &GetState()
+    {
+        static State state;
+        return state;
+    }
+};
+
+/* Turns records back into text. Used by the logging service when writing text logs and by the offline decoder */
+class LogRecordDecoder
+{
+public:
+    /* Decodes the complete records at the front of data and returns the number of bytes consumed. Format definitions
+     * found in the data are added to the known formats */
+    std::size_t Decode(std::byte const *data, std::size_t size, std::ostream &out, bool printTime)
+    {
+        std::size_t consumed = 0;
+        LogRecordHeader header;
+        while (size - consumed >= sizeof(header))
+        {
+            std::memcpy(&header, data + consumed, sizeof(header));
+            if (size - consumed - sizeof(header) < header.size)
+            {
+                break;
+            }
+
+            const auto payload = data + consumed + sizeof(header);
+            if (header.formatId == LOG_FORMAT_DEFINITION_ID)
+            {
+                AddDefinition(payload, header.size);
+            }
+            else
+            {
+                if (printTime)
+                {
+                    out << '[' << header.time << "] ";
+                }
+                DecodeArgs(header.formatId, payload, header.size, out);
+            }
+            consumed += sizeof(header) + header.size;
+        }
+        return consumed;
+    }
+
+    std::vector<LogFormat> &GetFormats()
+    {
+        return formats;
+    }
+
+private:
+    template <typename T> static T Read(std::byte const *&data)
+    {
+        T value;
+        std::memcpy(&value, data, sizeof(value));
+        data += sizeof(value);
+        return value;
+    }
+
+    static std::string_view ReadString(std::byte const *&data)
+    {
+        const auto size = Read<u32>(data);
+        std::string_view value(reinterpret_cast<char const *>(data), size);
+        data += size;
+        return value;
+    }
+
+    void AddDefinition(std::byte const *payload, std::size_t size)
+    {
+        const auto end = payload + size;
+        const auto id = Read<u32>(payload);
+        const auto argCodes = ReadString(payload);
+        const auto format = ReadString(payload);
+        if (payload != end || id == LOG_FORMAT_DEFINITION_ID)
+        {
+            return;
+        }
+
+        if (formats.size() < id)
+        {
+            formats.resize(id);
+        }
+        formats[id - 1] = {std::string(format), std::string(argCodes)};
+    }
+
+    void DecodeArgs(u32 formatId, std::byte const *payload, std::size_t size, std::ostream &out)
+    {
+        if (formatId > formats.size())
+        {
+            out << "<unknown log format " << formatId << ">\n";
+            return;
+        }
+
+        auto const &[format, argCodes] = formats[formatId - 1];
+        const auto end = payload + size;
+        std::size_t nextArg = 0;
+        for (std::size_t i = 0; i < format.size(); ++i)
+        {
+            if (format[i] != '{' || i + 1 == format.size() || format[i + 1] != '}' || nextArg == argCodes.size())
+            {
+                out << format[i];
+                continue;
+            }
+            ++i;
+
+            if (payload >= end)
+            {
+                out << "<truncated>";
+                return;
+            }
+            switch (argCodes[nextArg++])
+            {
+            case 's':
+                out << ReadString(payload);
+                break;
+            case 'b':
+                out << Read<bool>(payload);
+                break;
+            case 'c':
+                out << Read<char>(payload);
+                break;
+            case 'f':
+                out << Read<float>(payload);
+                break;
+            case 'd':
+                out << Read<double>(payload);
+                break;
+            case 'a':
+                out << static_cast<int>(Read<i8>(payload));
+                break;
+            case 'e':
+                out << Read<int16_t>(payload);
+                break;
+            case 'i':
+                out << Read<i32>(payload);
+                break;
+            case 'l':
+                out << Read<int64_t>(payload);
+                break;
+            case 'h':
+                out << static_cast<unsigned>(Read<u8>(payload));
+                break;
+            case 't':
+                out << Read<uint16_t>(payload);
+                break;
+            case 'j':
+                out << Read<u32>(payload);
+                break;
+            case 'm':
+                out << Read<u64>(payload);
+                break;
+            default:
+                out << "<bad argument>";
+                return;
+            }
+        }
+    }
+
+private:
+    std::vector<LogFormat> formats;
+};
@@ -1,6 +1,8 @@
 #pragma once
 
+#include "LogLevel.h"
 #include <assert.h>
+#include <atomic>
 #include <cstdint>
 #include <iostream>
 #include <sstream>
@@ -39,16 +41,33 @@ template <typename... Args> inline void DebugPrintLine(Args &&...args)
 #endif
 }
 
+/* Runtime threshold of the SHOW* macros. Other builds only print warnings and errors unless asked for more */
+inline std::atomic<LogLevel> gShowLevel =
+#if DEBUG || _DEBUG
+    LogLevel::TRACE;
+#else
+    LogLevel::WARNING;
+#endif
+
+inline void SetShowLevel(LogLevel level)
+{
+    gShowLevel.store(level, std::memory_order_relaxed);
+}
+
+inline bool IsShowLevelEnabled(LogLevel level)
+{
+    return IsLogLevelCompiled(level) && level >= gShowLevel.load(std::memory_order_relaxed);
+}
+
 template <typename... Args>
 inline void Log(const char *prefix, const char *file, unsigned int line, const char *functionName, Args &&...args)
 {
     if constexpr (sizeof...(Args) == 0)
         return;
 
-#if DEBUG || _DEBUG
-    DebugPrint("[", prefix, "] ", file, ":", line, " (", functionName, ") => ");
-    DebugPrint(std::forward<Args>(args)..., "\n");
-#endif
+    std::cout << "[" << prefix << "] " << file << ":" << line << " (" << functionName << ") => ";
+    (std::cout << ... << args) << "\n";
+    std::cout.flush();
 }
 
 constexpr const char *GetShortFileName(const char *str, uint32_t len)
@@ -79,33 +98,25 @@ constexpr const char *GetShortFunctionName(const char *str, uint32_t len)
     return result;
 }
 
-#define SHOWINFO(...)                                                                                                  \
-    {                                                                                                                  \
-        constexpr auto fileName = GetShortFileName(__FILE__, sizeof(__FILE__) - 1);                                    \
-        constexpr auto functionName = GetShortFunctionName(__FUNCTION__, sizeof(__FUNCTION__) - 1);                    \
-        Log("  LOG  ", fileName, __LINE__, functionName, __VA_ARGS__);                                                 \
-    }
-
-#define SHOWWARNING(...)                                                                                               \
+/* Neither the message nor its arguments are evaluated when the level is compiled out or below gShowLevel */
+#define SHOW_AT_LEVEL(level, prefix, ...)                                                                              \
     {                                                                                                                  \
-        constexpr auto fileName = GetShortFileName(__FILE__, sizeof(__FILE__) - 1);                                    \
-        constexpr auto functionName = GetShortFunctionName(__FUNCTION__, sizeof(__FUNCTION__) - 1);                    \
-        Log("WARNING", fileName, __LINE__, functionName, __VA_ARGS__);                                                 \
+        if constexpr (IsLogLevelCompiled(level))                                                                       \
+        {                                                                                                              \
+            if (IsShowLevelEnabled(level))                                                                             \
+            {                                                                                                          \
+                constexpr auto fileName = GetShortFileName(__FILE__, sizeof(__FILE__) - 1);                            \
+                constexpr auto functionName = GetShortFunctionName(__FUNCTION__, sizeof(__FUNCTION__) - 1);            \
+                ::Log(prefix, fileName, __LINE__, functionName, __VA_ARGS__);                                          \
+            }                                                                                                          \
+        }                                                                                                              \
     }
 
-#define SHOWERROR(...)                                                                                                 \
-    {                                                                                                                  \
-        constexpr auto fileName = GetShortFileName(__FILE__, sizeof(__FILE__) - 1);                                    \
-        constexpr auto functionName = GetShortFunctionName(__FUNCTION__, sizeof(__FUNCTION__) - 1);                    \
-        Log(" ERROR ", fileName, __LINE__, functionName, __VA_ARGS__);                                                 \
-    }
-
-#define SHOWFATAL(...)                                                                                                 \
-    {                                                                                                                  \
-        constexpr auto fileName = GetShortFileName(__FILE__, sizeof(__FILE__) - 1);                                    \
-        constexpr auto functionName = GetShortFunctionName(__FUNCTION__, sizeof(__FUNCTION__) - 1);                    \
-        Log(" FATAL ", fileName, __LINE__, functionName, __VA_ARGS__);                                                 \
-    }
+#define SHOWTRACE(...) SHOW_AT_LEVEL(LogLevel::TRACE, " TRACE ", __VA_ARGS__)
+#define SHOWINFO(...) SHOW_AT_LEVEL(LogLevel::INFO, "  LOG  ", __VA_ARGS__)
+#define SHOWWARNING(...) SHOW_AT_LEVEL(LogLevel::WARNING, "WARNING", __VA_ARGS__)
+#define SHOWERROR(...) SHOW_AT_LEVEL(LogLevel::ERROR, " ERROR ", __VA_ARGS__)
+#define SHOWFATAL(...) SHOW_AT_LEVEL(LogLevel::FATAL, " FATAL ", __VA_ARGS__)
 
 #define CHECKNR(cond, ...)                                                                                             \
     if (!(cond))                                                                                                       \
@@ -10,5 +10,30 @@ constexpr u32 ME_MAX_MARKET_UPDATES = /* 256 */ 1 * 1024;
 constexpr u32 ME_MAX_NUM_CLIENTS = 256;
 constexpr u32 ME_MAX_ORDER_IDS = /* 1024 */ 1 * 1024;
 constexpr u32 ME_MAX_PRICE_LEVELS = 256;
+/* Ticks covered by each side of the exchange's book before it has to re-center */
+constexpr u32 ME_PRICE_LADDER_SIZE = 4096;
 
 constexpr u32 ME_MAX_PENDING_REQUESTS = 1024;
+/* Longest a request waits in the sequencer for older ones to come in on other connections */
+constexpr u32 ME_SEQUENCER_MAX_WAIT_US = 50;
+/* I/O threads the order server can spread the client connections over */
+constexpr u32 ME_MAX_ORDER_ENTRY_THREADS = 8;
+/* Send and receive buffer of an order entry connection, room for hundreds of full frames either way */
+constexpr u32 ME_ORDER_ENTRY_BUFFER_SIZE = 256 * 1024;
+/* Requests or responses carried by one order entry frame, it has to fit the u8 count of the frame header */
+constexpr u32 ME_MAX_FRAME_MESSAGES = 32;
+
+/* Sequenced requests the journal thread may fall behind by before the sequencer has to wait for it */
+constexpr u32 ME_JOURNAL_QUEUE_SIZE = 64 * 1024;
+/* Size of a journal segment file, a whole number of huge pages */
+constexpr u64 ME_JOURNAL_SEGMENT_SIZE = 64 * 1024 * 1024;
+/* How often the journal asks the kernel to start writing its dirty pages back */
+constexpr u32 ME_JOURNAL_SYNC_INTERVAL_MS = 10;
+/* How often the matching shards checkpoint their books, so that a restart only replays the journal after that */
+constexpr u32 ME_CHECKPOINT_INTERVAL_SECS = 60;
+
+/* Threads the exchange's matching can be split across. Each one handles at least one ticker */
+constexpr u32 ME_MAX_MATCHING_SHARDS = ME_MAX_TICKERS;
+
+/* Core for the threads that are not latency critical, like the logging service. -1 leaves them to the OS */
+constexpr i32 HOUSEKEEPING_CORE = -1;
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Types.h"
+#include <atomic>
+
+/* Severity of a log line. DEBUG can't be used as a name, the debug build defines it as a macro */
+enum class LogLevel : u8
+{
+    TRACE = 0,
+    INFO = 1,
+    WARNING = 2,
+    ERROR = 3,
+    FATAL = 4,
+};
+
+/* Levels below this one are compiled out: their arguments are not even evaluated. Debug builds keep everything, other
+ * builds drop the per-message tracing. Can be overridden from the command line, e.g. -DQUICK_LOG_MIN_LEVEL=2 */
+#ifndef QUICK_LOG_MIN_LEVEL
+#if DEBUG || _DEBUG
+#define QUICK_LOG_MIN_LEVEL 0
+#else
+#define QUICK_LOG_MIN_LEVEL 1
+#endif
+#endif
+
+/* Compared as levels, comparing the underlying u8 against a minimum of 0 trips -Wtype-limits */
+constexpr bool IsLogLevelCompiled(LogLevel level)
+{
+    return level >= static_cast<LogLevel>(QUICK_LOG_MIN_LEVEL);
+}
+
+inline auto LogLevelToString(LogLevel level) -> char const *
+{
+    switch (level)
+    {
+    case LogLevel::TRACE:
+        return "TRACE";
+    case LogLevel::INFO:
+        return "INFO";
+    case LogLevel::WARNING:
+        return "WARNING";
+    case LogLevel::ERROR:
+        return "ERROR";
+    case LogLevel::FATAL:
+        return "FATAL";
+    }
+    return "UNKNOWN";
+}
@@ -1,59 +1,119 @@
 #pragma once
 
+#include "BinaryLog.h"
 #include "Check.h"
+#include "LogLevel.h"
 #include "SafeQueue.h"
 #include "ThreadUtils.h"
+#include "TimeUtils.h"
 #include <chrono>
+#include <cstring>
 #include <fstream>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
-/* TODO: Make this a smart singletone */
-class QuickLogger
+enum class LogOutput : u8
 {
+    /* The logging service decodes the records, the file reads like it always did */
+    TEXT = 0,
+    /* The records are written as they are, the file has to go through log_decoder */
+    BINARY = 1,
+};
+
+class QuickLogger;
+
+/* The one thread per process that writes every logger's records to its file. Each QuickLogger is a lane: a SPSC queue
+ * filled by the thread that owns the logger and drained by the service, so the producers never share anything */
+class LogService
+{
+public:
+    /* Core to pin the service thread on, -1 to leave it to the OS. Only has an effect before the first logger is
+     * created */
+    static void SetCore(i32 coreId)
+    {
+        GetCore() = coreId;
+    }
+
+    static LogService &Instance()
+    {
+        static LogService service;
+        return service;
+    }
+
+    ~LogService()
+    {
+        shouldStop = true;
+        serviceThread->join();
+
+        /* Loggers that are never destroyed still get their last lines written */
+        std::lock_guard lock(lanesMutex);
+        FlushLanes();
+    }
+
+    LogService(const LogService &) = delete;
+    LogService(const LogService &&) = delete;
+    LogService &operator=(const LogService &) = delete;
+    LogService &operator=(const LogService &&) = delete;
+
 private:
-    enum class LogElementType : int8_t
-    {
-        NONE = 0,
-        CHAR = 1,
-        INTEGER = 2,
-        LONG_INTEGER = 3,
-        LONG_LONG_INTEGER = 4,
-        UNSIGNED_INTEGER = 5,
-        UNSIGNED_LONG_INTEGER = 6,
-        UNSIGNED_LONG_LONG_INTEGER = 7,
-        FLOAT = 8,
-        DOUBLE = 9,
-    };
-    struct LogElement
-    {
-        LogElementType type = LogElementType::NONE;
-        union {
-            char c;
-            int i;
-            long l;
-            long long ll;
-            unsigned u;
-            unsigned long ul;
-            unsigned long long ull;
-            float f;
-            double d;
-        } data;
-    };
+    friend class QuickLogger;
+
+    LogService()
+    {
+        /* The clock spends CALIBRATION_TIME calibrating when it is first used. Loggers are created on the way up, before
+           the threads that read the clock on their hot paths, so it's done here */
+        TSCClock::Instance();
+
+        serviceThread = CreateAndStartThread(GetCore(), "LogService", [this] { Run(); });
+        CHECK_FATAL(serviceThread != nullptr, "Could not create the logging service thread");
+    }
+
+    static i32 &GetCore()
+    {
+        static i32 coreId = -1;
+        return coreId;
+    }
 
+    void AddLane(QuickLogger *lane);
+    /* Writes whatever the lane still holds before forgetting about it */
+    void RemoveLane(QuickLogger *lane);
+
+    void Run();
+    bool FlushLanes();
+
+private:
+    /* Only taken when a lane comes or goes and by the service thread, never on the logging path */
+    std::mutex lanesMutex;
+    std::vector<QuickLogger *> lanes;
+
+    std::unique_ptr<std::thread> serviceThread;
+    std::atomic<bool> shouldStop = false;
+};
+
+/* Must only be written to by one thread at a time, the one that owns it */
+class QuickLogger
+{
 public:
-    explicit QuickLogger(std::string const &path) : queue(1024 * 1024 * 8)
+    /* Records are about a hundred bytes and the service drains the lanes every millisecond */
+    static constexpr std::size_t QUEUE_SIZE = 4 * 1024 * 1024;
+
+    explicit QuickLogger(std::string const &path, MemoryOptions const &memoryOptions = {},
+                         LogOutput output = LogOutput::TEXT)
+        : queue(QUEUE_SIZE, memoryOptions), output(output)
     {
-        outputStream.open(path.c_str());
+        outputStream.open(path.c_str(), std::ios::binary);
         CHECK_FATAL(outputStream.is_open(), "Could not open file: ", path);
-        loggerThread = CreateAndStartThread(-1, "LoggerThread", [&] { FlushQueue(); });
-        CHECK_FATAL(loggerThread != nullptr, "Could not create the logger thread");
+        if (output == LogOutput::BINARY)
+        {
+            outputStream.write(LOG_FILE_MAGIC.data(), LOG_FILE_MAGIC.size());
+        }
+        LogService::Instance().AddLane(this);
     };
     ~QuickLogger()
     {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        shouldStop = true;
-        loggerThread->join();
+        LogService::Instance().RemoveLane(this);
     }
 
     QuickLogger() = delete;
@@ -63,140 +123,208 @@ public:
     QuickLogger &operator=(const QuickLogger &&) = delete;
 
 public:
-    void Log()
+    /* Lines below the level are dropped, see also QUICK_LOG_MIN_LEVEL */
+    void SetLevel(LogLevel newLevel)
     {
+        level.store(newLevel, std::memory_order_relaxed);
     }
 
-    template <typename Arg, typename... Args> void Log(Arg const &value, Args &&...args)
+    bool IsEnabled(LogLevel lineLevel) const
     {
-        PushValue(value);
-
-        Log(args...);
+        return IsLogLevelCompiled(lineLevel) && lineLevel >= level.load(std::memory_order_relaxed);
     }
 
-    void PushValue(LogElement const &value)
+    /* Concatenates the arguments */
+    template <typename... Args> void Log(Args const &...args)
     {
-        *queue.GetNextWriteTo() = value;
-        queue.UpdateWriteIndex();
+        if constexpr (sizeof...(Args) != 0)
+        {
+            LogFormat<MakeConcatenationFormat<sizeof...(Args)>()>(args...);
+        }
     }
 
-    void PushValue(char const c)
+    /* Replaces every {} in Format by the next argument. The format is registered the first time the call site runs,
+     * after that a call only copies the arguments into the queue */
+    template <LogFormatString Format, typename... Args> void LogFormat(Args const &...args)
     {
-        PushValue(LogElement{LogElementType::CHAR, {.c = c}});
+        static_assert(Format.CountPlaceholders() == sizeof...(Args), "Every argument needs a {} in the format");
+
+        static const u32 formatId =
+            LogFormatRegistry::Register(Format.View(), {LOG_ARG_CODES<LogArgType<Args>...>.data(), sizeof...(Args)});
+        PushRecord(formatId, ToLogArg(args)...);
     }
 
-    void PushValue(char const *c)
+private:
+    friend class LogService;
+
+    template <typename... Args> void PushRecord(u32 formatId, Args... args)
     {
-        while (*c)
+        const LogRecordHeader header{formatId, static_cast<u32>((GetEncodedSize(args) + ... + 0)), GetCurrentNanos()};
+        const auto recordSize = sizeof(header) + header.size;
+        CHECKNR(recordSize <= queue.GetCapacity(), "Log record of ", recordSize, " bytes doesn't fit in the queue");
+        if (recordSize > queue.GetCapacity()) [[unlikely]]
         {
-            PushValue(*c);
-            ++c;
+            return;
         }
-    }
 
-    void PushValue(std::string const &c)
-    {
-        PushValue(c.c_str());
-    }
+        /* Wait for the logging service rather than lose lines */
+        while (queue.TryGetNextWriteTo(recordSize - 1) == nullptr) [[unlikely]]
+        {
+            std::this_thread::yield();
+        }
 
-    void PushValue(int const c)
-    {
-        PushValue(LogElement{LogElementType::INTEGER, {.i = c}});
-    }
+        auto firstPart = queue.GetNextWriteSpan(recordSize);
+        if (firstPart.size() == recordSize) [[likely]]
+        {
+            EncodeLogRecord(firstPart.data(), header, args...);
+        }
+        else
+        {
+            /* The record wraps around the end of the queue */
+            std::vector<std::byte> record(recordSize);
+            EncodeLogRecord(record.data(), header, args...);
 
-    void PushValue(long const c)
-    {
-        PushValue(LogElement{LogElementType::LONG_INTEGER, {.l = c}});
+            auto secondPart = queue.GetNextWriteSpan(recordSize - firstPart.size(), firstPart.size());
+            std::memcpy(firstPart.data(), record.data(), firstPart.size());
+            std::memcpy(secondPart.data(), record.data() + firstPart.size(), secondPart.size());
+        }
+        queue.UpdateWriteIndex(recordSize);
     }
 
-    void PushValue(long long const c)
+    /* Called by the service with the lanes locked. Returns whether anything was written */
+    bool FlushRecords()
     {
-        PushValue(LogElement{LogElementType::LONG_LONG_INTEGER, {.ll = c}});
-    }
+        bool wroteRecords = false;
+        for (auto bytes = queue.GetNextReadSpan(queue.GetCapacity()); !bytes.empty();
+             bytes = queue.GetNextReadSpan(queue.GetCapacity()))
+        {
+            if (output == LogOutput::BINARY)
+            {
+                /* The formats used by these records were registered before the records were published */
+                WriteNewFormats();
+                outputStream.write(reinterpret_cast<char const *>(bytes.data()), bytes.size());
+            }
+            else
+            {
+                pendingRecords.insert(pendingRecords.end(), bytes.begin(), bytes.end());
+            }
+            queue.UpdateReadIndex(bytes.size());
+            wroteRecords = true;
+        }
 
-    void PushValue(unsigned const c)
-    {
-        PushValue(LogElement{LogElementType::UNSIGNED_INTEGER, {.u = c}});
-    }
+        if (output == LogOutput::TEXT && !pendingRecords.empty())
+        {
+            LogFormatRegistry::Sync(decoder.GetFormats());
+            const auto consumed = decoder.Decode(pendingRecords.data(), pendingRecords.size(), outputStream, false);
+            pendingRecords.erase(pendingRecords.begin(), pendingRecords.begin() + consumed);
+        }
 
-    void PushValue(unsigned long const c)
-    {
-        PushValue(LogElement{LogElementType::UNSIGNED_LONG_INTEGER, {.ul = c}});
+        if (wroteRecords)
+        {
+            outputStream.flush();
+        }
+        return wroteRecords;
     }
 
-    void PushValue(unsigned long long const c)
+    void WriteNewFormats()
     {
-        PushValue(LogElement{LogElementType::UNSIGNED_LONG_LONG_INTEGER, {.ull = c}});
-    }
+        auto &formats = decoder.GetFormats();
+        auto id = static_cast<u32>(formats.size());
+        LogFormatRegistry::Sync(formats);
 
-    void PushValue(float const c)
-    {
-        PushValue(LogElement{LogElementType::FLOAT, {.f = c}});
-    }
+        std::vector<std::byte> record;
+        for (; id < formats.size(); ++id)
+        {
+            const auto argCodes = std::string_view(formats[id].argCodes);
+            const auto format = std::string_view(formats[id].format);
+            const auto formatId = id + 1;
 
-    void PushValue(f64 const c)
-    {
-        PushValue(LogElement{LogElementType::DOUBLE, {.d = c}});
+            const LogRecordHeader header{
+                LOG_FORMAT_DEFINITION_ID,
+                static_cast<u32>(GetEncodedSize(formatId) + GetEncodedSize(argCodes) + GetEncodedSize(format)), 0};
+            record.resize(sizeof(header) + header.size);
+            EncodeLogRecord(record.data(), header, formatId, argCodes, format);
+            outputStream.write(reinterpret_cast<char const *>(record.data()), record.size());
+        }
     }
 
 private:
-    void FlushQueue()
+    std::ofstream outputStream;
+
+    SafeQueue<std::byte> queue;
+    LogOutput output;
+
+    /* Owned by the service thread */
+    LogRecordDecoder decoder;
+    std::vector<std::byte> pendingRecords;
+
+    std::atomic<LogLevel> level = LogLevel::TRACE;
+};
+
+inline void LogService::AddLane(QuickLogger *lane)
+{
+    std::lock_guard lock(lanesMutex);
+    lanes.push_back(lane);
+}
+
+inline void LogService::RemoveLane(QuickLogger *lane)
+{
+    std::lock_guard lock(lanesMutex);
+    lane->FlushRecords();
+    std::erase(lanes, lane);
+}
+
+inline void LogService::Run()
+{
+    auto lastReanchor = GetCurrentTicks();
+    while (!shouldStop)
     {
-        while (!shouldStop)
+        /* The service is the housekeeping thread, it also keeps the clock anchored */
+        const auto now = GetCurrentTicks();
+        if (TicksToDuration(now - lastReanchor) > TSCClock::REANCHOR_INTERVAL)
         {
-            for (auto next = queue.GetNextRead(); queue.GetSize() && next; next = queue.GetNextRead())
-            {
-                switch (next->type)
-                {
-                case LogElementType::CHAR:
-                    LogValue(next->data.c);
-                    break;
-                case LogElementType::INTEGER:
-                    LogValue(next->data.i);
-                    break;
-                case LogElementType::LONG_INTEGER:
-                    LogValue(next->data.l);
-                    break;
-                case LogElementType::LONG_LONG_INTEGER:
-                    LogValue(next->data.ll);
-                    break;
-                case LogElementType::UNSIGNED_INTEGER:
-                    LogValue(next->data.u);
-                    break;
-                case LogElementType::UNSIGNED_LONG_INTEGER:
-                    LogValue(next->data.l);
-                    break;
-                case LogElementType::UNSIGNED_LONG_LONG_INTEGER:
-                    LogValue(next->data.ull);
-                    break;
-                case LogElementType::FLOAT:
-                    LogValue(next->data.f);
-                    break;
-                case LogElementType::DOUBLE:
-                    LogValue(next->data.d);
-                    break;
-                case LogElementType::NONE:
-                default:
-                    break;
-                }
-                queue.UpdateReadIndex();
-            }
-            outputStream.flush();
+            TSCClock::Instance().Reanchor();
+            lastReanchor = now;
+        }
 
+        bool wroteRecords = false;
+        {
+            std::lock_guard lock(lanesMutex);
+            wroteRecords = FlushLanes();
+        }
+
+        /* Keep going while there's work, otherwise wake up once per millisecond at most */
+        if (!wroteRecords)
+        {
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
     }
+}
 
-    template <typename T> void LogValue(T c)
+inline bool LogService::FlushLanes()
+{
+    bool wroteRecords = false;
+    for (auto lane : lanes)
     {
-        outputStream << c;
+        wroteRecords |= lane->FlushRecords();
     }
+    return wroteRecords;
+}
 
-private:
-    std::ofstream outputStream;
-
-    SafeQueue<LogElement> queue;
+/* Levelled versions of LogFormat. Neither the format nor the arguments are evaluated when the level is compiled out or
+ * disabled on the logger, so the arguments can be as expensive as ToString() */
+#define QUICK_LOG(logger, level, format, ...)                                                                          \
+    {                                                                                                                  \
+        if constexpr (IsLogLevelCompiled(level))                                                                       \
+        {                                                                                                              \
+            if ((logger).IsEnabled(level))                                                                             \
+            {                                                                                                          \
+                (logger).template LogFormat<format>(__VA_ARGS__);                                                      \
+            }                                                                                                          \
+        }                                                                                                              \
+    }
 
-    std::unique_ptr<std::thread> loggerThread;
-    std::atomic<bool> shouldStop = false;
-};
+#define QLOG_TRACE(logger, format, ...) QUICK_LOG(logger, LogLevel::TRACE, format __VA_OPT__(, ) __VA_ARGS__)
+#define QLOG_INFO(logger, format, ...) QUICK_LOG(logger, LogLevel::INFO, format __VA_OPT__(, ) __VA_ARGS__)
+#define QLOG_WARNING(logger, format, ...) QUICK_LOG(logger, LogLevel::WARNING, format __VA_OPT__(, ) __VA_ARGS__)
+#define QLOG_ERROR(logger, format, ...) QUICK_LOG(logger, LogLevel::ERROR, format __VA_OPT__(, ) __VA_ARGS__)
@@ -7,10 +7,9 @@
 struct MCastSocket
 {
     static constexpr const u32 BUFFER_SIZE = 64 * 1024 * 1024;
-    MCastSocket(QuickLogger *logger) : logger(logger)
+    MCastSocket(QuickLogger *logger, MemoryOptions const &memoryOptions = {})
+        : logger(logger), outboundData(BUFFER_SIZE, memoryOptions), inboundData(BUFFER_SIZE, memoryOptions)
     {
-        outboundData.resize(BUFFER_SIZE);
-        inboundData.resize(BUFFER_SIZE);
     }
 
     bool Init(std::string const &ip, std::string const &iface, i32 port, bool isListening);
@@ -22,10 +21,10 @@ struct MCastSocket
     QuickLogger *logger;
     Socket socket;
 
-    std::vector<char> outboundData;
+    std::vector<char, MappedAllocator<char>> outboundData;
     size_t nextSendDataIndex = 0;
 
-    std::vector<char> inboundData;
+    std::vector<char, MappedAllocator<char>> inboundData;
     size_t nextRecvDataIndex = 0;
 
     std::function<void(MCastSocket *)> recvCallback = nullptr;
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "SafeQueue.h"
+
+#include <assert.h>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <vector>
+
+/* Bounded multiple producer / single consumer queue.
+ * Every slot carries a sequence number, in the style of a disruptor ring. A producer reserves a position by advancing
+ * the shared claim index with a CAS, fills the slot and publishes it by bumping the slot's sequence, so producers never
+ * wait for each other to finish writing. The consumer reads the slots in position order and hands each one back to the
+ * producers of the next lap by setting its sequence to position + capacity. */
+template <typename T> class MPSCQueue
+{
+public:
+    explicit MPSCQueue(std::size_t numElements, MemoryOptions const &memoryOptions = {})
+        : slots(std::bit_ceil(numElements < 2 ? std::size_t(2) : numElements), memoryOptions), mask(slots.size() - 1)
+    {
+        for (std::size_t i = 0; i < slots.size(); ++i)
+        {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MPSCQueue(MPSCQueue const &) = delete;
+    MPSCQueue(MPSCQueue &&) = delete;
+
+    MPSCQueue &operator=(MPSCQueue const &) = delete;
+    MPSCQueue &operator=(MPSCQueue &&) = delete;
+
+public:
+    /* Reserves the next free slot for the calling producer. Returns nullptr when the queue is full. The slot must be
+     * published with UpdateWriteIndex(slot) once it has been written */
+    T *TryGetNextWriteTo()
+    {
+        auto position = claimIndex.load(std::memory_order_relaxed);
+        while (true)
+        {
+            auto &slot = slots[position & mask];
+            const auto sequence = slot.sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+
+            if (difference == 0)
+            {
+                if (claimIndex.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    if (full.load(std::memory_order_relaxed)) [[unlikely]]
+                    {
+                        full.store(false, std::memory_order_relaxed);
+                    }
+                    return &slot.data;
+                }
+            }
+            else if (difference < 0)
+            {
+                /* The consumer hasn't released this slot from the previous lap yet. Like SafeQueue, only the first
+                   producer to fail after a claim succeeded records a full event */
+                if (!full.load(std::memory_order_relaxed) && !full.exchange(true, std::memory_order_relaxed))
+                {
+                    fullEvents.fetch_add(1, std::memory_order_relaxed);
+                }
+                return nullptr;
+            }
+            else
+            {
+                /* Another producer claimed this position, try the next one */
+                position = claimIndex.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /* Spinning version of TryGetNextWriteTo */
+    T *GetNextWriteTo()
+    {
+        auto slot = TryGetNextWriteTo();
+        while (slot == nullptr) [[unlikely]]
+        {
+            slot = TryGetNextWriteTo();
+        }
+        return slot;
+    }
+
+    void UpdateWriteIndex(T *data)
+    {
+        auto slot = reinterpret_cast<Slot *>(data);
+        assert(slot >= slots.data() && slot < slots.data() + slots.size() && "Slot does not belong to this queue");
+
+        /* While reserved the sequence still holds the claimed position */
+        const auto position = slot->sequence.load(std::memory_order_relaxed);
+        slot->sequence.store(position + 1, std::memory_order_release);
+    }
+
+    T *GetNextRead()
+    {
+        auto &slot = slots[readIndex & mask];
+        const auto sequence = slot.sequence.load(std::memory_order_acquire);
+        return (sequence == readIndex + 1) ? &slot.data : nullptr;
+    }
+
+    void UpdateReadIndex()
+    {
+        auto &slot = slots[readIndex & mask];
+        assert(slot.sequence.load(std::memory_order_relaxed) == readIndex + 1 && "Reading a slot that isn't published");
+
+        slot.sequence.store(readIndex + slots.size(), std::memory_order_release);
+        ++readIndex;
+        publishedReadIndex.store(readIndex, std::memory_order_relaxed);
+    }
+
+    /* Number of claimed but not yet consumed slots. Some of them might still be written by their producers */
+    std::size_t GetSize() const
+    {
+        return claimIndex.load(std::memory_order_relaxed) - publishedReadIndex.load(std::memory_order_relaxed);
+    }
+
+    std::size_t GetCapacity() const
+    {
+        return slots.size();
+    }
+
+    /* Number of times a producer found the queue full after a claim last succeeded */
+    std::size_t GetFullEvents() const
+    {
+        return fullEvents.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot
+    {
+        /* Must be the first member, UpdateWriteIndex gets back to the slot from the data pointer */
+        T data{};
+        std::atomic<std::size_t> sequence = 0;
+    };
+
+    std::vector<Slot, MappedAllocator<Slot>> slots;
+    std::size_t mask;
+
+    /* Shared by all the producers */
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> claimIndex = 0;
+    std::atomic<bool> full = false;
+    std::atomic<std::size_t> fullEvents = 0;
+
+    /* Owned by the consumer */
+    alignas(CACHE_LINE_SIZE) std::size_t readIndex = 0;
+    std::atomic<std::size_t> publishedReadIndex = 0;
+};
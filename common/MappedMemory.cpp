@@ -0,0 +1,141 @@
+#include "MappedMemory.h"
+#include "Check.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <string>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+/* From <numaif.h>, spelled out so that we don't need to link with libnuma */
+constexpr int MPOL_PREFERRED_POLICY = 1;
+
+auto GetMappedLength(std::size_t bytes, MemoryOptions const &options) -> std::size_t
+{
+    /* Small structures would waste most of a huge page */
+    const auto pageSize = (options.hugePages && bytes >= HUGE_PAGE_SIZE) ? HUGE_PAGE_SIZE : PAGE_SIZE;
+    return (bytes + pageSize - 1) / pageSize * pageSize;
+}
+
+auto GetNumaNode(MemoryOptions const &options) -> i32
+{
+    if (options.numaNode != MemoryOptions::CURRENT_NUMA_NODE)
+    {
+        return options.numaNode;
+    }
+
+    unsigned cpu = 0, node = 0;
+    if (getcpu(&cpu, &node) != 0)
+    {
+        return MemoryOptions::ANY_NUMA_NODE;
+    }
+    return static_cast<i32>(node);
+}
+
+void BindToNode(void *memory, std::size_t length, i32 node)
+{
+    unsigned long nodeMask = 1UL << node;
+    const auto maxNode = sizeof(nodeMask) * 8;
+
+    if (node >= static_cast<i32>(maxNode) ||
+        syscall(SYS_mbind, memory, length, MPOL_PREFERRED_POLICY, &nodeMask, maxNode, 0) != 0)
+    {
+        SHOWWARNING("Could not bind ", length, " bytes to NUMA node ", node, ": ", strerror(errno));
+    }
+}
+} // namespace
+
+void *MapMemory(std::size_t bytes, MemoryOptions const &options)
+{
+    const auto length = GetMappedLength(bytes, options);
+    const auto hugePageLength = length % HUGE_PAGE_SIZE == 0;
+
+    void *memory = MAP_FAILED;
+    if (options.hugePages && hugePageLength)
+    {
+        memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory == MAP_FAILED)
+        {
+            SHOWINFO("No reserved huge pages for ", length, " bytes, falling back to transparent huge pages");
+        }
+    }
+
+    if (memory == MAP_FAILED)
+    {
+        memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        CHECK(memory != MAP_FAILED, nullptr, "Could not map ", length, " bytes: ", strerror(errno));
+
+        if (options.hugePages && hugePageLength && madvise(memory, length, MADV_HUGEPAGE) != 0)
+        {
+            SHOWWARNING("Transparent huge pages are not available: ", strerror(errno));
+        }
+    }
+
+    /* The placement has to be decided before the first touch */
+    const auto node = GetNumaNode(options);
+    if (node != MemoryOptions::ANY_NUMA_NODE)
+    {
+        BindToNode(memory, length, node);
+    }
+
+    if (options.lock && mlock(memory, length) != 0)
+    {
+        SHOWWARNING("Could not lock ", length, " bytes: ", strerror(errno));
+    }
+
+    if (options.prefault)
+    {
+        /* Writing makes the kernel back the page for real, a read would only map the shared zero page */
+        auto bytesToTouch = static_cast<volatile char *>(memory);
+        for (std::size_t offset = 0; offset < length; offset += PAGE_SIZE)
+        {
+            bytesToTouch[offset] = 0;
+        }
+    }
+
+    return memory;
+}
+
+MemoryOptions MemoryOptions::ForCpu(i32 cpu) const
+{
+    if (numaNode != CURRENT_NUMA_NODE || cpu < 0)
+    {
+        return *this;
+    }
+
+    /* The cpu's directory holds a nodeN link to the node it belongs to */
+    const auto path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    auto directory = opendir(path.c_str());
+    if (directory == nullptr)
+    {
+        return *this;
+    }
+
+    auto result = *this;
+    while (auto entry = readdir(directory))
+    {
+        unsigned node = 0;
+        if (sscanf(entry->d_name, "node%u", &node) == 1)
+        {
+            result.numaNode = static_cast<i32>(node);
+            break;
+        }
+    }
+    closedir(directory);
+    return result;
+}
+
+void UnmapMemory(void *memory, std::size_t bytes, MemoryOptions const &options)
+{
+    if (memory == nullptr)
+    {
+        return;
+    }
+    munmap(memory, GetMappedLength(bytes, options));
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Types.h"
+#include <cstddef>
+#include <memory>
+#include <new>
+
+constexpr std::size_t PAGE_SIZE = 4 * 1024;
+constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+/* How the memory behind a large structure should be obtained. The default is the ordinary heap, everything else maps
+ * the memory directly so that it can be placed and faulted in before the hot path ever touches it */
+struct MemoryOptions
+{
+    static constexpr i32 ANY_NUMA_NODE = -1;
+    /* The node of the cpu the allocating thread runs on */
+    static constexpr i32 CURRENT_NUMA_NODE = -2;
+
+    /* MAP_HUGETLB when the system has huge pages reserved, transparent huge pages otherwise */
+    bool hugePages = false;
+    /* Touch every page on allocation so the first write on the hot path doesn't take a page fault */
+    bool prefault = false;
+    /* mlock the memory so it is never swapped out */
+    bool lock = false;
+    i32 numaNode = ANY_NUMA_NODE;
+
+    bool IsDefault() const
+    {
+        return !hugePages && !prefault && !lock && numaNode == ANY_NUMA_NODE;
+    }
+
+    bool operator==(MemoryOptions const &) const = default;
+
+    /* The same options with CURRENT_NUMA_NODE resolved to the node of cpu, for structures built by one thread and used
+     * by another pinned to cpu. A negative cpu or an unknown node leaves the options as they are */
+    MemoryOptions ForCpu(i32 cpu) const;
+
+    /* Everything on, placed next to the thread that creates the structure */
+    static constexpr MemoryOptions LowLatency()
+    {
+        return {.hugePages = true, .prefault = true, .lock = true, .numaNode = CURRENT_NUMA_NODE};
+    }
+};
+
+/* Returns nullptr if the memory could not be mapped. Failing to get huge pages, to bind the memory to a node or to lock
+ * it is not an error, the memory is still usable */
+void *MapMemory(std::size_t bytes, MemoryOptions const &options);
+void UnmapMemory(void *memory, std::size_t bytes, MemoryOptions const &options);
+
+/* Allocator for the standard containers that backs them with MapMemory */
+template <typename T> class MappedAllocator
+{
+public:
+    using value_type = T;
+
+    MappedAllocator() = default;
+    MappedAllocator(MemoryOptions const &options) : options(options)
+    {
+    }
+    template <typename U> MappedAllocator(MappedAllocator<U> const &other) : options(other.GetOptions())
+    {
+    }
+
+    T *allocate(std::size_t count)
+    {
+        if (options.IsDefault())
+        {
+            return std::allocator<T>().allocate(count);
+        }
+
+        auto memory = MapMemory(count * sizeof(T), options);
+        if (memory == nullptr) [[unlikely]]
+        {
+            throw std::bad_alloc();
+        }
+        return static_cast<T *>(memory);
+    }
+
+    void deallocate(T *memory, std::size_t count)
+    {
+        if (options.IsDefault())
+        {
+            std::allocator<T>().deallocate(memory, count);
+            return;
+        }
+        UnmapMemory(memory, count * sizeof(T), options);
+    }
+
+    MemoryOptions const &GetOptions() const
+    {
+        return options;
+    }
+
+    template <typename U> bool operator==(MappedAllocator<U> const &other) const
+    {
+        return options == other.GetOptions();
+    }
+
+private:
+    MemoryOptions options;
+};
@@ -18,7 +18,9 @@ enum class MarketUpdateType : u8
     TRADE = 4,
     CLEAR = 5,
     SNAPSHOT_START = 6,
-    SNAPSHOT_END = 7
+    SNAPSHOT_END = 7,
+    /* The order moved to the back of the queue at the given price, with the given priority and quantity */
+    REPLACE = 8
 };
 
 inline auto MarketUpdateTypeToString(MarketUpdateType type) -> std::string
@@ -41,6 +43,8 @@ inline auto MarketUpdateTypeToString(MarketUpdateType type) -> std::string
         return "SNAPSHOT_START";
     case MarketUpdateType::SNAPSHOT_END:
         return "SNAPSHOT_END";
+    case MarketUpdateType::REPLACE:
+        return "REPLACE";
     }
     return "UNKNOWN";
 }
@@ -56,6 +60,9 @@ struct MEMarketUpdate
     Price price = Price_INVALID;
     Priority priority = Priority_INVALID;
     Quantity quantity = Quantity_INVALID;
+    /* Numbers the updates of the ticker from 1 in the order its book made them. Only the ticker's requests decide it,
+     * so it doesn't depend on the number of shards or on how their updates interleave, and a replay gives it again */
+    u64 tickerSequenceNumber = 0;
 
     inline auto ToString(u32 indent = 0) const -> std::string
     {
@@ -70,6 +77,7 @@ struct MEMarketUpdate
         ss << indentString << "\tprice : " << PriceToString(price) << '\n';
         ss << indentString << "\tpriority : " << PriorityToString(priority) << '\n';
         ss << indentString << "\tquantity : " << QuantityToString(quantity) << '\n';
+        ss << indentString << "\ttickerSequenceNumber : " << tickerSequenceNumber << '\n';
         ss << indentString << "}";
 
         return ss.str();
@@ -78,6 +86,8 @@ struct MEMarketUpdate
 
 struct MPDMarketUpdate
 {
+    /* Numbers the updates of the whole channel in the order they were sent, for the consumers to notice a lost packet.
+     * With several shards it depends on how their updates interleave, the ticker's own number doesn't */
     u64 sequenceNumber = 0;
     MEMarketUpdate marketUpdate{};
 
@@ -1,15 +1,38 @@
 #pragma once
 
 #include "Logger.h"
+#include "MappedMemory.h"
+#include "Types.h"
+#include <cstddef>
+#include <limits>
+#include <new>
 #include <vector>
 
+/* Fixed size object pool.
+ * Free blocks form an intrusive LIFO list: a free block stores the index of the next free block in its own storage, so
+ * Allocate and Deallocate are O(1) regardless of fragmentation and the block handed out is the one most recently
+ * released, which is likely still in cache. Debug builds keep a separate array of free flags to validate Deallocate; it
+ * never shares a cache line with the objects. */
 template <typename T> class MemoryPool final
 {
 public:
-    explicit MemoryPool(std::size_t numElems) : store(numElems, {T(), true})
+    explicit MemoryPool(std::size_t numElems, MemoryOptions const &memoryOptions = {}) : store(numElems, memoryOptions)
     {
-        DCHECK_FATAL(reinterpret_cast<T *>(&store[0].object) == reinterpret_cast<T *>(&store[0]),
-                     "The object should be first in the object block structure");
+        CHECK_FATAL(numElems < INVALID_INDEX, "Memory pool can hold at most ", INVALID_INDEX - 1, " elements");
+
+        for (std::size_t i = 0; i < numElems; ++i)
+        {
+            store[i].nextFree = static_cast<u32>(i + 1);
+        }
+        if (numElems != 0)
+        {
+            store[numElems - 1].nextFree = INVALID_INDEX;
+            nextFreeIndex = 0;
+        }
+
+#if DEBUG || _DEBUG
+        isFree.assign(numElems, true);
+#endif
     }
 
     MemoryPool() = delete;
@@ -20,18 +43,23 @@ public:
     MemoryPool &operator=(MemoryPool &&) = delete;
 
 public:
-    template <typename... Args> T *Allocate(Args... args)
+    /* Returns nullptr when every block is in use */
+    template <typename... Args> T *Allocate(Args &&...args)
     {
-        auto obj_block = &(store[nextFreeIndex]);
-        CHECK(obj_block->isFree, nullptr, "Expected free block at index ", nextFreeIndex);
+        CHECK(nextFreeIndex != INVALID_INDEX, nullptr,
+              "Memory pool is full. Should remove some elements before attempting to allocate");
 
-        T *ret = &obj_block->object;
-        ret = new (ret) T(std::forward<Args>(args)...);
-        obj_block->isFree = false;
+        const auto index = nextFreeIndex;
+        auto objBlock = &store[index];
+        nextFreeIndex = objBlock->nextFree;
 
-        UpdateNextFreeIndex();
+#if DEBUG || _DEBUG
+        DCHECK_FATAL(isFree[index], "Expected free block at index ", index);
+        isFree[index] = false;
+#endif
+        ++numAllocated;
 
-        return ret;
+        return new (objBlock->object) T(std::forward<Args>(args)...);
     }
 
     void Deallocate(T *elem)
@@ -41,39 +69,45 @@ public:
                      "Element that is expected to be deleted is not within store range. Maybe was allocated with "
                      "another memory pool?")
 
-        DCHECK_FATAL(&store[elemIndex].object == elem,
+        DCHECK_FATAL(reinterpret_cast<T *>(store[elemIndex].object) == elem,
                      "Element passed to Deallocate doesn't coincide with the element in store")
 
-        DCHECK_FATAL(!store[elemIndex].isFree, "Expected in use element");
+#if DEBUG || _DEBUG
+        DCHECK_FATAL(!isFree[elemIndex], "Expected in use element");
+        isFree[elemIndex] = true;
+#endif
 
-        store[elemIndex].isFree = true;
+        elem->~T();
+
+        store[elemIndex].nextFree = nextFreeIndex;
+        nextFreeIndex = static_cast<u32>(elemIndex);
+        --numAllocated;
     }
 
-private:
-    inline void UpdateNextFreeIndex()
+    std::size_t GetNumAllocated() const
     {
-        const auto initialFreeIndex = nextFreeIndex;
-        while (!store[nextFreeIndex].isFree)
-        {
-            nextFreeIndex++;
-            if (nextFreeIndex == store.size()) [[unlikely]]
-            {
-                nextFreeIndex = 0;
-            }
-            if (nextFreeIndex == initialFreeIndex) [[unlikely]]
-            {
-                SHOWWARNING("Memory pool is full. Should remove some elements before attempting to allocate");
-            }
-        }
+        return numAllocated;
     }
 
-private:
-    struct ObjectBlock
+    std::size_t GetCapacity() const
     {
-        T object;
-        bool isFree = true;
+        return store.size();
+    }
+
+private:
+    static constexpr u32 INVALID_INDEX = std::numeric_limits<u32>::max();
+
+    /* A block either holds a live object or, while free, the index of the next free block */
+    union ObjectBlock {
+        alignas(T) std::byte object[sizeof(T)];
+        u32 nextFree;
     };
 
-    std::vector<ObjectBlock> store;
-    size_t nextFreeIndex = 0;
+    std::vector<ObjectBlock, MappedAllocator<ObjectBlock>> store;
+    u32 nextFreeIndex = INVALID_INDEX;
+    std::size_t numAllocated = 0;
+
+#if DEBUG || _DEBUG
+    std::vector<bool> isFree;
+#endif
 };
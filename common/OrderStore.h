@@ -0,0 +1,193 @@
+#pragma once
+
+#include "Check.h"
+#include "MappedMemory.h"
+#include "Types.h"
+
+#include <cstddef>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* Orders resting in a book, split between what walking a price level needs and what only reporting needs. Used by the
+ * exchange's book and by the trading side's copy of it.
+ * The hot records are 32 bytes, two per cache line, and link to each other by their index in the store. The cold
+ * record of an order sits at the same index in a parallel array and is only read for the orders a walk actually
+ * reports on. */
+
+using OrderIndex = u32;
+constexpr auto OrderIndex_INVALID = std::numeric_limits<OrderIndex>::max();
+
+struct alignas(32) HotOrder
+{
+    Price price = Price_INVALID;
+    Priority priority = Priority_INVALID;
+    Quantity quantity = Quantity_INVALID;
+    /* The orders at a price form a ring in time priority */
+    OrderIndex prevOrder = OrderIndex_INVALID;
+    OrderIndex nextOrder = OrderIndex_INVALID;
+    Side side = Side::INVALID;
+};
+static_assert(sizeof(HotOrder) == 32, "Hot orders must stay at two per cache line");
+
+/* Head of the orders resting at one price. Keeps their total quantity and count, so the depth at a price is known
+ * without walking its orders */
+struct OrderLevel
+{
+    Side side = Side::INVALID;
+    Price price = Price_INVALID;
+    OrderIndex firstOrder = OrderIndex_INVALID;
+    Quantity totalQuantity = 0;
+    u32 numOrders = 0;
+
+    OrderLevel() = default;
+    OrderLevel(Side side, Price price) : side(side), price(price)
+    {
+    }
+
+    auto ToString() const -> std::string
+    {
+        std::stringstream ss;
+        ss << "OrderLevel {\n"
+           << "\tside: " << SideToString(side) << "\n"
+           << "\tprice: " << PriceToString(price) << "\n"
+           << "\tfirstOrder: " << firstOrder << "\n"
+           << "\ttotalQuantity: " << QuantityToString(totalQuantity) << "\n"
+           << "\tnumOrders: " << numOrders << "\n"
+           << "}";
+
+        return ss.str();
+    }
+};
+
+/* Fixed size store of orders. Like MemoryPool, the free slots form an intrusive LIFO list, threaded here through the
+ * nextOrder field of the hot records */
+template <typename ColdOrder> class OrderStore final
+{
+public:
+    explicit OrderStore(std::size_t numOrders, MemoryOptions const &memoryOptions = {})
+        : hot(numOrders, HotOrder(), memoryOptions), cold(numOrders, ColdOrder(), memoryOptions)
+    {
+        CHECK_FATAL(numOrders < OrderIndex_INVALID, "Order store can hold at most ", OrderIndex_INVALID - 1,
+                    " orders");
+
+        for (std::size_t i = 0; i < numOrders; ++i)
+        {
+            hot[i].nextOrder = static_cast<OrderIndex>(i + 1);
+        }
+        if (numOrders != 0)
+        {
+            hot[numOrders - 1].nextOrder = OrderIndex_INVALID;
+            nextFreeIndex = 0;
+        }
+    }
+
+    OrderStore() = delete;
+    OrderStore(OrderStore const &) = delete;
+    OrderStore(OrderStore &&) = delete;
+
+    OrderStore &operator=(OrderStore const &) = delete;
+    OrderStore &operator=(OrderStore &&) = delete;
+
+public:
+    /* Returns OrderIndex_INVALID when the store is full */
+    OrderIndex Allocate(HotOrder const &hotOrder, ColdOrder const &coldOrder)
+    {
+        CHECK(nextFreeIndex != OrderIndex_INVALID, OrderIndex_INVALID, "Order store is full");
+
+        const auto index = nextFreeIndex;
+        nextFreeIndex = hot[index].nextOrder;
+        hot[index] = hotOrder;
+        cold[index] = coldOrder;
+        ++numAllocated;
+        return index;
+    }
+
+    void Deallocate(OrderIndex index)
+    {
+        DCHECK_FATAL(index < hot.size(), "Order index ", index, " is outside the store");
+
+        hot[index].quantity = Quantity_INVALID;
+        hot[index].nextOrder = nextFreeIndex;
+        nextFreeIndex = index;
+        --numAllocated;
+    }
+
+    HotOrder &Hot(OrderIndex index)
+    {
+        return hot[index];
+    }
+
+    ColdOrder &Cold(OrderIndex index)
+    {
+        return cold[index];
+    }
+
+    /* Queues the order behind the ones already resting at its level */
+    void PushBack(OrderLevel &level, OrderIndex index)
+    {
+        auto &order = hot[index];
+        if (level.firstOrder == OrderIndex_INVALID)
+        {
+            order.prevOrder = order.nextOrder = index;
+            level.firstOrder = index;
+        }
+        else
+        {
+            auto &first = hot[level.firstOrder];
+            order.prevOrder = first.prevOrder;
+            order.nextOrder = level.firstOrder;
+            hot[first.prevOrder].nextOrder = index;
+            first.prevOrder = index;
+        }
+
+        level.totalQuantity += order.quantity;
+        ++level.numOrders;
+    }
+
+    /* Takes the order out of its level. The level is left empty, with no first order, after its last order */
+    void Unlink(OrderLevel &level, OrderIndex index)
+    {
+        auto &order = hot[index];
+        if (order.nextOrder == index)
+        {
+            level.firstOrder = OrderIndex_INVALID;
+        }
+        else
+        {
+            hot[order.prevOrder].nextOrder = order.nextOrder;
+            hot[order.nextOrder].prevOrder = order.prevOrder;
+            if (level.firstOrder == index)
+            {
+                level.firstOrder = order.nextOrder;
+            }
+        }
+
+        level.totalQuantity -= order.quantity;
+        --level.numOrders;
+    }
+
+    void SetQuantity(OrderLevel &level, OrderIndex index, Quantity quantity)
+    {
+        level.totalQuantity = level.totalQuantity - hot[index].quantity + quantity;
+        hot[index].quantity = quantity;
+    }
+
+    std::size_t GetNumAllocated() const
+    {
+        return numAllocated;
+    }
+
+    std::size_t GetCapacity() const
+    {
+        return hot.size();
+    }
+
+private:
+    std::vector<HotOrder, MappedAllocator<HotOrder>> hot;
+    std::vector<ColdOrder, MappedAllocator<ColdOrder>> cold;
+
+    OrderIndex nextFreeIndex = OrderIndex_INVALID;
+    std::size_t numAllocated = 0;
+};
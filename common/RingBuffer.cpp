@@ -0,0 +1,54 @@
+#include "RingBuffer.h"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+RingBuffer::RingBuffer(std::size_t capacity, MemoryOptions const &memoryOptions)
+    : mCapacity(std::bit_ceil(std::max(capacity, PAGE_SIZE))), mMask(mCapacity - 1)
+{
+    const int fd = memfd_create("ring_buffer", MFD_CLOEXEC);
+    CHECK_FATAL(fd >= 0, "Could not create the memory of a ring buffer: ", strerror(errno));
+    CHECK_FATAL(ftruncate(fd, static_cast<off_t>(mCapacity)) == 0, "Could not size a ring buffer to ", mCapacity,
+                " bytes: ", strerror(errno));
+
+    /* Reserve both halves in one go, then put the file over each of them */
+    auto reserved = mmap(nullptr, 2 * mCapacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CHECK_FATAL(reserved != MAP_FAILED, "Could not reserve ", 2 * mCapacity, " bytes for a ring buffer: ",
+                strerror(errno));
+    mData = static_cast<char *>(reserved);
+
+    const int populate = memoryOptions.prefault ? MAP_POPULATE : 0;
+    for (auto half : {mData, mData + mCapacity})
+    {
+        auto mapped = mmap(half, mCapacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED | populate, fd, 0);
+        CHECK_FATAL(mapped == half, "Could not map a ring buffer of ", mCapacity, " bytes: ", strerror(errno));
+    }
+    close(fd);
+
+    if (memoryOptions.lock && mlock(mData, 2 * mCapacity) != 0)
+    {
+        SHOWWARNING("Could not lock a ring buffer of ", mCapacity, " bytes: ", strerror(errno));
+    }
+}
+
+RingBuffer::~RingBuffer()
+{
+    munmap(mData, 2 * mCapacity);
+}
+
+bool RingBuffer::Write(void const *data, std::size_t len)
+{
+    auto space = GetWriteSpan();
+    if (len > space.size()) [[unlikely]]
+    {
+        return false;
+    }
+
+    std::memcpy(space.data(), data, len);
+    mWriteIndex += len;
+    return true;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Check.h"
+#include "MappedMemory.h"
+#include "Types.h"
+
+#include <cstddef>
+#include <span>
+
+/* Byte ring buffer for a single thread, like the send and receive buffers of a socket.
+ * The capacity is rounded up to a power of two number of pages, and the same memory is mapped twice in a row: the
+ * byte at capacity + i is the byte at i. Whatever is readable, or writable, is therefore one contiguous span even when
+ * it wraps around the end of the ring, so a message straddling the wrap is parsed in place and consuming it is only
+ * an index update, nothing is ever moved to the front. */
+class RingBuffer
+{
+public:
+    /* Huge pages and NUMA placement are not honoured, the mirrored mapping is made of ordinary shared pages */
+    explicit RingBuffer(std::size_t capacity, MemoryOptions const &memoryOptions = {});
+    ~RingBuffer();
+
+    RingBuffer() = delete;
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer(const RingBuffer &&) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &&) = delete;
+
+    std::size_t GetCapacity() const
+    {
+        return mCapacity;
+    }
+
+    /* Bytes written and not consumed yet */
+    std::size_t GetSize() const
+    {
+        return mWriteIndex - mReadIndex;
+    }
+
+    bool IsEmpty() const
+    {
+        return mWriteIndex == mReadIndex;
+    }
+
+    /* Everything written and not consumed yet */
+    std::span<char> GetReadSpan()
+    {
+        return {mData + (mReadIndex & mMask), GetSize()};
+    }
+
+    void UpdateReadIndex(std::size_t count)
+    {
+        DCHECK_FATAL(count <= GetSize(), "RingBuffer consumed ", count, " bytes out of ", GetSize());
+        mReadIndex += count;
+    }
+
+    /* All the free space */
+    std::span<char> GetWriteSpan()
+    {
+        return {mData + (mWriteIndex & mMask), mCapacity - GetSize()};
+    }
+
+    void UpdateWriteIndex(std::size_t count)
+    {
+        DCHECK_FATAL(count <= mCapacity - GetSize(), "RingBuffer overflowed by ", count - (mCapacity - GetSize()),
+                     " bytes");
+        mWriteIndex += count;
+    }
+
+    /* Copies len bytes in, or nothing at all when they don't fit */
+    bool Write(void const *data, std::size_t len);
+
+    void Clear()
+    {
+        mReadIndex = mWriteIndex = 0;
+    }
+
+private:
+    std::size_t mCapacity;
+    std::size_t mMask;
+    char *mData = nullptr;
+
+    /* Only ever grow, the offset in the ring is the index masked */
+    u64 mReadIndex = 0;
+    u64 mWriteIndex = 0;
+};
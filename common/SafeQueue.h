@@ -1,48 +1,131 @@
 #pragma once
 
+#include "MappedMemory.h"
+
 #include <assert.h>
+#include <algorithm>
 #include <atomic>
-#include <pthread.h>
+#include <bit>
+#include <cstddef>
+#include <span>
 #include <vector>
 
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+/* Single producer / single consumer ring buffer.
+ * The capacity is rounded up to a power of two so the slot is found with a mask. The producer and the consumer each
+ * own a cache line holding their index and a cached copy of the other side's index, which means the fast path only
+ * touches the other side's line when the cached value says the queue looks empty (or full). */
 template <typename T> class SafeQueue
 {
 public:
-    SafeQueue(std::size_t numElements) : store(numElements, T())
+    explicit SafeQueue(std::size_t numElements, MemoryOptions const &memoryOptions = {})
+        : store(std::bit_ceil(numElements < 2 ? std::size_t(2) : numElements), T(), memoryOptions),
+          mask(store.size() - 1)
+    {
+    }
+
+    /* Returns the slot offset elements after the next write position. Together with UpdateWriteIndex(count) this lets
+     * a producer fill a whole batch, even one that wraps around the end of the ring, and publish it with one store */
+    T *GetNextWriteTo(std::size_t offset = 0)
     {
+        return &store[(producer.writeIndex.load(std::memory_order_relaxed) + offset) & mask];
     }
 
-    T *GetNextWriteTo()
+    /* Returns up to count contiguous slots starting offset elements after the next write position. The span is shorter
+     * than requested when it reaches the end of the ring */
+    std::span<T> GetNextWriteSpan(std::size_t count, std::size_t offset = 0)
     {
-        return &store[nextWriteIndex];
+        const auto first = (producer.writeIndex.load(std::memory_order_relaxed) + offset) & mask;
+        return {&store[first], std::min(count, store.size() - first)};
     }
 
-    void UpdateWriteIndex()
+    /* Bounded version of GetNextWriteTo. Returns nullptr when the slot still holds data the consumer hasn't read yet.
+     * The caller decides whether to spin, drop or escalate; a full event is recorded only for the first failure, so a
+     * caller spinning here counts once until a slot frees up */
+    T *TryGetNextWriteTo(std::size_t offset = 0)
     {
-        nextWriteIndex = (nextWriteIndex + 1) % store.size();
-        numElements++;
+        const auto writeIndex = producer.writeIndex.load(std::memory_order_relaxed) + offset;
+        if (IsFullFromProducer(writeIndex)) [[unlikely]]
+        {
+            if (!producer.full)
+            {
+                producer.full = true;
+                producer.fullEvents.store(producer.fullEvents.load(std::memory_order_relaxed) + 1,
+                                          std::memory_order_relaxed);
+            }
+            return nullptr;
+        }
+        producer.full = false;
+        return &store[writeIndex & mask];
+    }
+
+    void UpdateWriteIndex(std::size_t count = 1)
+    {
+        const auto writeIndex = producer.writeIndex.load(std::memory_order_relaxed);
+        /* Leaves the cached index and the counters alone, so debug builds count the same as release builds */
+        assert(writeIndex + count - consumer.readIndex.load(std::memory_order_acquire) <= store.size() &&
+               "SafeQueue overwrote data that was not consumed yet");
+        producer.writeIndex.store(writeIndex + count, std::memory_order_release);
     }
 
     T const *GetNextRead() const
     {
-        return (nextReadIndex == nextWriteIndex) ? nullptr : &store[nextReadIndex];
+        const auto readIndex = consumer.readIndex.load(std::memory_order_relaxed);
+        return IsEmptyFromConsumer(readIndex) ? nullptr : &store[readIndex & mask];
     }
 
     T *GetNextRead()
     {
-        return (nextReadIndex == nextWriteIndex) ? nullptr : &store[nextReadIndex];
+        const auto readIndex = consumer.readIndex.load(std::memory_order_relaxed);
+        return IsEmptyFromConsumer(readIndex) ? nullptr : &store[readIndex & mask];
+    }
+
+    /* Returns up to maxCount contiguous readable elements. The span is shorter than requested when fewer elements are
+     * available or when it reaches the end of the ring; in the latter case the next call returns the wrapped part */
+    std::span<T> GetNextReadSpan(std::size_t maxCount)
+    {
+        const auto readIndex = consumer.readIndex.load(std::memory_order_relaxed);
+        if (consumer.cachedWriteIndex - readIndex < maxCount)
+        {
+            consumer.cachedWriteIndex = producer.writeIndex.load(std::memory_order_acquire);
+        }
+
+        const auto first = readIndex & mask;
+        const auto available = std::min(consumer.cachedWriteIndex - readIndex, maxCount);
+        return {&store[first], std::min(available, store.size() - first)};
     }
 
-    void UpdateReadIndex()
+    void UpdateReadIndex(std::size_t count = 1)
     {
-        nextReadIndex = (nextReadIndex + 1) % store.size();
-        assert(numElements != 0);
-        numElements--;
+        const auto readIndex = consumer.readIndex.load(std::memory_order_relaxed);
+        assert(count <= consumer.cachedWriteIndex - readIndex && "SafeQueue read index moved past the write index");
+        consumer.readIndex.store(readIndex + count, std::memory_order_release);
     }
 
     std::size_t GetSize() const
     {
-        return numElements;
+        const auto readIndex = consumer.readIndex.load(std::memory_order_acquire);
+        const auto writeIndex = producer.writeIndex.load(std::memory_order_acquire);
+        return writeIndex - readIndex;
+    }
+
+    std::size_t GetCapacity() const
+    {
+        return store.size();
+    }
+
+    /* Largest number of unread elements the producer has seen in the queue. It is sampled only when the producer
+     * reloads the consumer's index, that is once the producer has written a whole ring since the last reload */
+    std::size_t GetHighWaterMark() const
+    {
+        return producer.highWaterMark.load(std::memory_order_relaxed);
+    }
+
+    /* Number of times TryGetNextWriteTo found the queue full after it last had room */
+    std::size_t GetFullEvents() const
+    {
+        return producer.fullEvents.load(std::memory_order_relaxed);
     }
 
     SafeQueue(SafeQueue const &) = delete;
@@ -52,8 +135,56 @@ public:
     SafeQueue &operator=(SafeQueue &&) = delete;
 
 private:
-    std::vector<T> store;
-    std::atomic<std::size_t> nextWriteIndex = 0;
-    std::atomic<std::size_t> nextReadIndex = 0;
-    std::atomic<std::size_t> numElements = 0;
+    /* Called only by the consumer. Reloads the producer's index only if the cached copy says there is nothing left */
+    bool IsEmptyFromConsumer(std::size_t readIndex) const
+    {
+        if (readIndex != consumer.cachedWriteIndex) [[likely]]
+        {
+            return false;
+        }
+        consumer.cachedWriteIndex = producer.writeIndex.load(std::memory_order_acquire);
+        return readIndex == consumer.cachedWriteIndex;
+    }
+
+    /* Called only by the producer. Reloads the consumer's index only if the cached copy says the ring is full, and
+     * takes that moment to sample the high water mark */
+    bool IsFullFromProducer(std::size_t writeIndex)
+    {
+        if (writeIndex - producer.cachedReadIndex < store.size()) [[likely]]
+        {
+            return false;
+        }
+        producer.cachedReadIndex = consumer.readIndex.load(std::memory_order_acquire);
+
+        const auto size = std::min(writeIndex + 1 - producer.cachedReadIndex, store.size());
+        if (size > producer.highWaterMark.load(std::memory_order_relaxed))
+        {
+            producer.highWaterMark.store(size, std::memory_order_relaxed);
+        }
+        return writeIndex - producer.cachedReadIndex >= store.size();
+    }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) ProducerState
+    {
+        std::atomic<std::size_t> writeIndex = 0;
+        std::size_t cachedReadIndex = 0;
+        bool full = false;
+
+        /* Written only by the producer; atomic so that other threads can report them */
+        std::atomic<std::size_t> highWaterMark = 0;
+        std::atomic<std::size_t> fullEvents = 0;
+    };
+
+    struct alignas(CACHE_LINE_SIZE) ConsumerState
+    {
+        std::atomic<std::size_t> readIndex = 0;
+        mutable std::size_t cachedWriteIndex = 0;
+    };
+
+    std::vector<T, MappedAllocator<T>> store;
+    std::size_t mask;
+
+    ProducerState producer;
+    ConsumerState consumer;
 };
@@ -134,6 +134,13 @@ Socket CreateSocket(QuickLogger &logger, std::string const &t_ip, std::string co
                 return -1;
             }
 
+            /* Several TCP listeners can share the port, the kernel then spreads the new connections over them */
+            if (!isUdp && setsockopt(fdSocket, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0)
+            {
+                logger.Log("setsockopt(SO_REUSEPORT) failed. errno: ", strerror(errno), '\n');
+                return -1;
+            }
+
             sockaddr_in addr = {};
             addr.sin_port = htons(port);
             addr.sin_family = AF_INET;
@@ -1,9 +1,9 @@
 #include "TCPServer.h"
 #include "Check.h"
-#include "STLUtils.h"
 #include "SocketUtils.h"
 #include "TCPSocket.h"
 #include "Types.h"
+#include <algorithm>
 #include <cstring>
 #include <sys/epoll.h>
 #include <sys/socket.h>
@@ -12,10 +12,10 @@ void DefaultRecvFinishedCallback()
 {
 }
 
-bool TCPServer::AddSocketToEpoll(TCPSocket *tcpSocket)
+bool TCPServer::AddSocketToEpoll(TCPSocket *tcpSocket, u32 events)
 {
     epoll_event ev;
-    ev.events = EPOLLET | EPOLLIN;
+    ev.events = events;
     ev.data.ptr = reinterpret_cast<void *>(tcpSocket);
 
     return (epoll_ctl(efd, EPOLL_CTL_ADD, tcpSocket->socket, &ev) != -1);
@@ -26,15 +26,6 @@ bool TCPServer::RemoveSocketFromEpoll(TCPSocket *tcpSocket)
     return (epoll_ctl(efd, EPOLL_CTL_DEL, tcpSocket->socket, nullptr) != -1);
 }
 
-void TCPServer::DeleteSocket(TCPSocket *tcpSocket)
-{
-    RemoveSocketFromEpoll(tcpSocket);
-
-    RemoveElementFromArray(receiveSockets, tcpSocket);
-    RemoveElementFromArray(sendSockets, tcpSocket);
-    // RemoveElementFromArray(disconnectedSockets, tcpSocket);
-}
-
 void TCPServer::Listen(std::string const &iface, i32 port)
 {
     efd = epoll_create(1);
@@ -43,57 +34,47 @@ void TCPServer::Listen(std::string const &iface, i32 port)
     CHECK_FATAL(listenerSocket.Connect("", iface, port, true), "Listener socket failed to connect. Iface = ", iface,
                 "; port = ", port, "; error = ", strerror(errno));
 
-    AddSocketToEpoll(&listenerSocket);
+    AddSocketToEpoll(&listenerSocket, EPOLLET | EPOLLIN);
 }
 
 void TCPServer::Poll()
 {
-    const i32 maxEvents = 1 + sendSockets.size() + receiveSockets.size();
-
-    const i32 n = epoll_wait(efd, events, maxEvents, 0);
-    bool haveNewCoonections = false;
+    const i32 n = epoll_wait(efd, events, std::size(events), 0);
+    bool haveNewConnections = false;
     for (s32 i = 0; i < n; ++i)
     {
         epoll_event &event = events[i];
         auto socket = reinterpret_cast<TCPSocket *>(event.data.ptr);
 
-        if (event.events & EPOLLIN)
+        if (socket == &listenerSocket)
         {
-            logger.Log("EPOLLIN socket = ", socket->socket, '\n');
-            if (socket == &listenerSocket)
-            {
-                logger.Log("New connection on socket = ", listenerSocket.socket, '\n');
-                haveNewCoonections = true;
-                continue;
-            }
-
-            if (std::find(receiveSockets.begin(), receiveSockets.end(), socket) == receiveSockets.end())
-            {
-                receiveSockets.push_back(socket);
-            }
+            haveNewConnections = true;
+            continue;
         }
 
-        if (event.events & EPOLLOUT)
+        QLOG_TRACE(logger, "Socket {} has events {}\n", socket->socket, event.events);
+
+        /* A peer that hung up is read once more, which hands over what it sent last and finds the connection closed */
+        if (event.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
         {
-            logger.Log("EPOLLOUT socket = ", socket->socket, '\n');
-            if (std::find(sendSockets.begin(), sendSockets.end(), socket) == sendSockets.end())
-            {
-                sendSockets.push_back(socket);
-            }
+            AddToReadyList(socket);
         }
 
-        if (event.events & (EPOLLERR | EPOLLHUP))
+        if ((event.events & EPOLLOUT) && socket->GetSendQueueSize() > 0)
         {
-            logger.Log("EPOLLERR socket = ", socket->socket, '\n');
-
-            if (std::find(receiveSockets.begin(), receiveSockets.end(), socket) == receiveSockets.end())
-            {
-                receiveSockets.push_back(socket);
-            }
+            socket->LinkToSendList();
         }
     }
 
-    while (haveNewCoonections)
+    if (haveNewConnections)
+    {
+        Accept();
+    }
+}
+
+void TCPServer::Accept()
+{
+    while (true)
     {
         sockaddr_storage addr;
         socklen_t addrLen = sizeof(addr);
@@ -102,35 +83,130 @@ void TCPServer::Poll()
             break;
 
         CHECK_FATAL(SetNonBlocking(newSocket) && SetNoDelay(newSocket), "Failed to set attributes for the new socket");
-        logger.Log("Accepted new socket = ", newSocket, '\n');
 
-        auto newTCPSocket = new TCPSocket(logger);
+        TCPSocket *newTCPSocket;
+        if (!mFreeSockets.empty())
+        {
+            newTCPSocket = mFreeSockets.back();
+            mFreeSockets.pop_back();
+        }
+        else
+        {
+            newTCPSocket = mSockets.emplace_back(std::make_unique<TCPSocket>(logger, MemoryOptions{}, socketBufferSize))
+                               .get();
+        }
         newTCPSocket->socket = newSocket;
         newTCPSocket->recvCallback = recvCallback;
+        newTCPSocket->disconnectCallback = disconnectCallback;
+        newTCPSocket->sendList = &mSendList;
+
+        CHECK_FATAL(AddSocketToEpoll(newTCPSocket, EPOLLET | EPOLLIN | EPOLLOUT | EPOLLRDHUP),
+                    "Failed to add new socket to epoll list");
+        ++mNumConnections;
+        logger.Log("Accepted new socket = ", newSocket, "; connections = ", mNumConnections, '\n');
 
-        CHECK_FATAL(AddSocketToEpoll(newTCPSocket), "Failed to add new socket to epoll list");
+        /* Whatever arrived before the socket was in the epoll set raised no event */
+        AddToReadyList(newTCPSocket);
+    }
+}
 
-        logger.Log("Socket = ", listenerSocket.socket, " has new connection\n");
+void TCPServer::AddToReadyList(TCPSocket *tcpSocket)
+{
+    if (tcpSocket->inReadyList)
+    {
+        return;
+    }
 
-        receiveSockets.push_back(newTCPSocket);
+    tcpSocket->inReadyList = true;
+    tcpSocket->nextReady = nullptr;
+    if (mReadyTail == nullptr)
+    {
+        mReadyHead = tcpSocket;
+    }
+    else
+    {
+        mReadyTail->nextReady = tcpSocket;
     }
+    mReadyTail = tcpSocket;
 }
 
 void TCPServer::RecvAndSend()
 {
+    /* Edge triggered, a socket raises no new event until it has been read up to EAGAIN. It stays ready while it
+       returns data, which may have more behind it, and while its receive buffer is full, which it hasn't read at all */
     auto recv = false;
-    for (auto socket : receiveSockets)
+    auto socket = mReadyHead;
+    mReadyHead = mReadyTail = nullptr;
+    while (socket != nullptr)
     {
-        recv |= socket->RecvAndSend();
+        auto next = socket->nextReady;
+        socket->nextReady = nullptr;
+        socket->inReadyList = false;
+
+        const bool received = socket->Recv();
+        recv |= received;
+        if (socket->peerClosed)
+        {
+            mClosedSockets.push_back(socket);
+        }
+        else if (received || socket->recvBuffer.GetWriteSpan().empty())
+        {
+            AddToReadyList(socket);
+        }
+        socket = next;
     }
 
-    if (recv)
+    /* Whatever a peer sent before going away has been handed to the receive callback by now */
+    for (auto closed : mClosedSockets)
+    {
+        logger.Log("Peer closed socket = ", closed->socket, '\n');
+        closed->disconnectCallback(closed);
+    }
+
+    if (recv || !mClosedSockets.empty())
     {
         recvFinishedCallback();
     }
 
-    for (auto socket : sendSockets)
+    Flush();
+
+    for (auto closed : mClosedSockets)
     {
-        socket->RecvAndSend();
+        CloseSocket(closed);
     }
+    mClosedSockets.clear();
+}
+
+void TCPServer::Flush()
+{
+    /* What a socket can't write now is kept by it, EPOLLOUT puts it back on the list once the peer caught up */
+    auto socket = mSendList;
+    mSendList = nullptr;
+    while (socket != nullptr)
+    {
+        auto next = socket->nextSend;
+        socket->nextSend = nullptr;
+        socket->inSendList = false;
+        if (!socket->peerClosed)
+        {
+            socket->Flush();
+        }
+        socket = next;
+    }
+}
+
+void TCPServer::CloseSocket(TCPSocket *tcpSocket)
+{
+    RemoveSocketFromEpoll(tcpSocket);
+    tcpSocket->Reset();
+    --mNumConnections;
+
+    if (tcpSocket->TCPBufferSize == socketBufferSize) [[likely]]
+    {
+        mFreeSockets.push_back(tcpSocket);
+        return;
+    }
+
+    /* The buffer size changed since it was accepted, it won't be used again */
+    std::erase_if(mSockets, [tcpSocket](auto const &owned) { return owned.get() == tcpSocket; });
 }
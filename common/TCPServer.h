@@ -2,10 +2,15 @@
 
 #include "Logger.h"
 #include "TCPSocket.h"
+#include <memory>
 #include <sys/epoll.h>
+#include <vector>
 
 void DefaultRecvFinishedCallback();
 
+/* Edge triggered: epoll only says which sockets changed, the server keeps the sockets with something to read in a ready
+ * list and the ones with something to send in a send list, so an iteration only costs the active connections. The
+ * sockets of closed connections are kept, with their buffers, for the next connections */
 class TCPServer
 {
 public:
@@ -15,6 +20,11 @@ public:
         recvFinishedCallback = DefaultRecvFinishedCallback;
     }
 
+    ~TCPServer()
+    {
+        Destroy();
+    }
+
     TCPServer() = delete;
     TCPServer(const TCPServer &) = delete;
     TCPServer(const TCPServer &&) = delete;
@@ -23,15 +33,14 @@ public:
 
     void Listen(std::string const &iface, i32 port);
 
-    bool AddSocketToEpoll(TCPSocket *tcpSocket);
-    bool RemoveSocketFromEpoll(TCPSocket *tcpSocket);
-
-    void DeleteSocket(TCPSocket *tcpSocket);
-
     void Poll();
 
     void RecvAndSend();
 
+    /* Writes what the sockets queued, RecvAndSend ends with it. Call it before the data given to SendInPlace changes */
+    void Flush();
+
+    /* Stops listening. The connections still open are closed when the server is destroyed */
     void Destroy()
     {
         if (efd != -1)
@@ -43,16 +52,46 @@ public:
         listenerSocket.Destroy();
     }
 
+    std::size_t GetNumConnections() const
+    {
+        return mNumConnections;
+    }
+
     i32 efd = -1;
     TCPSocket listenerSocket;
     epoll_event events[1024];
 
-    std::vector<TCPSocket *> receiveSockets, sendSockets;
+    /* Buffer size of the sockets accepted from then on */
+    std::size_t socketBufferSize = TCPSocket::DEFAULT_BUFFER_SIZE;
 
     std::function<void(TCPSocket *, Nanos)> recvCallback;
     std::function<void()> recvFinishedCallback = DefaultRecvFinishedCallback;
+    /* Given to the sockets accepted from then on, see TCPSocket::disconnectCallback */
+    std::function<void(TCPSocket *)> disconnectCallback = DefaultDisconnectCallback;
 
     std::string timeStr;
 
     QuickLogger &logger;
+
+private:
+    bool AddSocketToEpoll(TCPSocket *tcpSocket, u32 events);
+    bool RemoveSocketFromEpoll(TCPSocket *tcpSocket);
+
+    void Accept();
+    void AddToReadyList(TCPSocket *tcpSocket);
+    void CloseSocket(TCPSocket *tcpSocket);
+
+private:
+    /* Sockets to read from, oldest first */
+    TCPSocket *mReadyHead = nullptr;
+    TCPSocket *mReadyTail = nullptr;
+    /* Sockets with data queued by Send, they link themselves in */
+    TCPSocket *mSendList = nullptr;
+
+    std::vector<TCPSocket *> mClosedSockets;
+    /* Sockets of closed connections, ready for new ones */
+    std::vector<TCPSocket *> mFreeSockets;
+    /* Every socket allocated, connected or in the pool */
+    std::vector<std::unique_ptr<TCPSocket>> mSockets;
+    std::size_t mNumConnections = 0;
 };
@@ -3,12 +3,14 @@
 #include "TimeUtils.h"
 #include <asm-generic/socket.h>
 #include <bits/types/struct_iovec.h>
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
 #include <sys/socket.h>
 
 void DefaultRecvCallback(TCPSocket *socket, Nanos time)
 {
-    socket->logger.Log("DefaultRecvCallback[Socket = ", socket->socket, "; nextRecvIndex = ", socket->nextRecvIndex,
+    socket->logger.Log("DefaultRecvCallback[Socket = ", socket->socket, "; length = ", socket->recvBuffer.GetSize(),
                        "; time = ", time, "]\n");
 }
 
@@ -25,21 +27,107 @@ Socket TCPSocket::Connect(std::string const &ip, std::string const &iface, i32 p
 
 void TCPSocket::Send(void const *data, size_t len)
 {
-    if (len > 0)
+    if (len == 0)
     {
-        memcpy(&sendBuffer[nextSendIndex], data, len);
-        nextSendIndex += len;
+        return;
     }
+
+    if (mNumSendPieces == MAX_SEND_PIECES || sendBuffer.GetWriteSpan().size() < len) [[unlikely]]
+    {
+        Flush();
+    }
+
+    auto space = sendBuffer.GetWriteSpan();
+    if (space.size() < len) [[unlikely]]
+    {
+        AbortSend(len);
+        return;
+    }
+
+    memcpy(space.data(), data, len);
+    sendBuffer.UpdateWriteIndex(len);
+    QueueSendPiece(space.data(), len, true);
+}
+
+void TCPSocket::SendInPlace(void const *data, size_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+
+    if (mNumSendPieces == MAX_SEND_PIECES) [[unlikely]]
+    {
+        Flush();
+    }
+    QueueSendPiece(static_cast<char const *>(data), len, false);
+}
+
+void TCPSocket::QueueSendPiece(char const *data, std::size_t len, bool inRing)
+{
+    /* Copies made one after the other are one piece */
+    auto &last = mSendPieces[mNumSendPieces];
+    if (inRing && mNumSendPieces > 0 && mSendPieceInRing[mNumSendPieces] &&
+        static_cast<char const *>(last.iov_base) + last.iov_len == data)
+    {
+        last.iov_len += len;
+    }
+    else
+    {
+        ++mNumSendPieces;
+        mSendPieces[mNumSendPieces] = {const_cast<char *>(data), len};
+        mSendPieceInRing[mNumSendPieces] = inRing;
+    }
+
+    mPendingSendSize += len;
+    LinkToSendList();
+}
+
+void DefaultDisconnectCallback(TCPSocket *)
+{
+}
+
+void TCPSocket::Reset()
+{
+    Destroy();
+    sendBuffer.Clear();
+    recvBuffer.Clear();
+    mNumSendPieces = 0;
+    mSendBacklog = 0;
+    mPendingSendSize = 0;
+    mSendQueueHighWaterMark = 0;
+    peerClosed = false;
+    inReadyList = false;
+    inSendList = false;
+    nextReady = nullptr;
+    nextSend = nullptr;
+    sendList = nullptr;
+    recvCallback = DefaultRecvCallback;
+    disconnectCallback = DefaultDisconnectCallback;
 }
 
 bool TCPSocket::RecvAndSend()
+{
+    const bool received = Recv();
+    Flush();
+    return received;
+}
+
+bool TCPSocket::Recv()
 {
     char ctrl[CMSG_SPACE(sizeof(struct timeval))];
     auto cmsg = reinterpret_cast<struct cmsghdr *>(&ctrl);
 
+    /* The consumer is a whole buffer behind, the kernel keeps the data until it catches up */
+    auto space = recvBuffer.GetWriteSpan();
+    if (space.empty()) [[unlikely]]
+    {
+        return false;
+    }
+
     iovec iov;
-    iov.iov_base = recvBuffer.data() + nextRecvIndex;
-    iov.iov_len = TCPBufferSize - nextRecvIndex;
+    iov.iov_base = space.data();
+    iov.iov_len = space.size();
 
     msghdr msg;
     msg.msg_flags = 0;
@@ -53,7 +141,7 @@ bool TCPSocket::RecvAndSend()
     auto const readSize = recvmsg(socket, &msg, MSG_DONTWAIT);
     if (readSize > 0)
     {
-        nextRecvIndex += readSize;
+        recvBuffer.UpdateWriteIndex(readSize);
 
         Nanos kernelTime = 0;
         timeval kernelTimeValue;
@@ -66,18 +154,131 @@ bool TCPSocket::RecvAndSend()
 
         const auto userTime = GetCurrentNanos();
 
-        logger.Log("Read socket = ", socket, "; len = ", nextRecvIndex, "; user time = ", userTime,
+        logger.Log("Read socket = ", socket, "; len = ", recvBuffer.GetSize(), "; user time = ", userTime,
                    "; kernel time = ", kernelTime, "; diff = ", userTime - kernelTime, "\n");
 
         recvCallback(this, kernelTime);
     }
-
-    if (nextSendIndex > 0)
+    else if (readSize == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
     {
-        i32 n = send(socket, sendBuffer.data(), nextSendIndex, MSG_DONTWAIT);
-        logger.Log("Send socket ", socket, " returned ", n, "\n");
+        /* Closed, reset, timed out or otherwise broken, nothing more is coming */
+        peerClosed = true;
     }
-    nextSendIndex = 0;
 
     return readSize > 0;
 }
+
+void TCPSocket::Flush()
+{
+    if (GetSendQueueSize() == 0)
+    {
+        return;
+    }
+
+    mSendPieces[0] = {sendBuffer.GetReadSpan().data(), mSendBacklog};
+    mSendPieceInRing[0] = true;
+    const std::size_t first = mSendBacklog > 0 ? 0 : 1;
+
+    msghdr msg{};
+    msg.msg_iov = &mSendPieces[first];
+    msg.msg_iovlen = mNumSendPieces + 1 - first;
+
+    const auto n = sendmsg(socket, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) [[unlikely]]
+    {
+        /* The connection is gone, Recv finds out and the owner tears it down */
+        logger.Log("Send socket ", socket, " failed, dropping ", GetSendQueueSize(), " bytes: ", strerror(errno), "\n");
+        sendBuffer.Clear();
+        mNumSendPieces = 0;
+        mSendBacklog = 0;
+        mPendingSendSize = 0;
+        return;
+    }
+
+    const auto sent = static_cast<std::size_t>(std::max<ssize_t>(n, 0));
+    QLOG_TRACE(logger, "Send socket {} wrote {} of {} bytes\n", socket, sent, GetSendQueueSize());
+    if (sent == GetSendQueueSize()) [[likely]]
+    {
+        sendBuffer.Clear();
+        mNumSendPieces = 0;
+        mSendBacklog = 0;
+        mPendingSendSize = 0;
+        return;
+    }
+
+    KeepUnsent(first, sent);
+}
+
+void TCPSocket::KeepUnsent(std::size_t first, std::size_t sent)
+{
+    /* Skip what went out whole, counting what of it was in the ring */
+    std::size_t ringSent = 0;
+    std::size_t piece = first;
+    for (; sent >= mSendPieces[piece].iov_len; ++piece)
+    {
+        sent -= mSendPieces[piece].iov_len;
+        ringSent += mSendPieceInRing[piece] ? mSendPieces[piece].iov_len : 0;
+    }
+
+    /* What went out of the ring was at its front, the ring now holds exactly its pieces that are left */
+    sendBuffer.UpdateReadIndex(ringSent + (mSendPieceInRing[piece] ? sent : 0));
+    mSendPieces[piece].iov_base = static_cast<char *>(mSendPieces[piece].iov_base) + sent;
+    mSendPieces[piece].iov_len -= sent;
+
+    std::size_t unsent = 0;
+    std::size_t inPlaceUnsent = 0;
+    for (std::size_t i = piece; i <= mNumSendPieces; ++i)
+    {
+        unsent += mSendPieces[i].iov_len;
+        inPlaceUnsent += mSendPieceInRing[i] ? 0 : mSendPieces[i].iov_len;
+    }
+    DCHECK_FATAL(sendBuffer.GetSize() == unsent - inPlaceUnsent, "The send ring holds ", sendBuffer.GetSize(),
+                 " bytes but ", unsent - inPlaceUnsent, " of its bytes are left to send");
+
+    if (inPlaceUnsent != 0)
+    {
+        /* The caller's bytes must be copied before it reuses them, only they need free space. Going from the last piece
+         * to the first, the ring's bytes move up to where they are in the stream and the caller's are copied in
+         * between, so nothing is overwritten before it has moved */
+        if (sendBuffer.GetWriteSpan().size() < inPlaceUnsent) [[unlikely]]
+        {
+            AbortSend(unsent);
+            return;
+        }
+
+        auto stream = sendBuffer.GetReadSpan().data();
+        std::size_t streamEnd = unsent;
+        std::size_t ringEnd = sendBuffer.GetSize();
+        for (std::size_t i = mNumSendPieces + 1; i-- > piece;)
+        {
+            auto const &unsentPiece = mSendPieces[i];
+            streamEnd -= unsentPiece.iov_len;
+            if (mSendPieceInRing[i])
+            {
+                ringEnd -= unsentPiece.iov_len;
+                memmove(stream + streamEnd, stream + ringEnd, unsentPiece.iov_len);
+            }
+            else
+            {
+                memcpy(stream + streamEnd, unsentPiece.iov_base, unsentPiece.iov_len);
+            }
+        }
+        sendBuffer.UpdateWriteIndex(inPlaceUnsent);
+    }
+
+    mNumSendPieces = 0;
+    mPendingSendSize = 0;
+    mSendBacklog = unsent;
+    mSendQueueHighWaterMark = std::max(mSendQueueHighWaterMark, unsent);
+}
+
+void TCPSocket::AbortSend(std::size_t len)
+{
+    logger.Log("Send buffer of socket ", socket, " can't take ", len, " more bytes behind ", GetSendQueueSize(),
+               ", shutting the connection down\n");
+    sendBuffer.Clear();
+    mNumSendPieces = 0;
+    mSendBacklog = 0;
+    mPendingSendSize = 0;
+    shutdown(socket, SHUT_RDWR);
+}
@@ -1,24 +1,37 @@
 #pragma once
 
 #include "Logger.h"
+#include "RingBuffer.h"
 #include "SocketUtils.h"
 #include "TimeUtils.h"
+#include <array>
 #include <functional>
 #include <netinet/in.h>
 #include <string>
+#include <sys/uio.h>
 
 class TCPSocket;
 void DefaultRecvCallback(TCPSocket *socket, Nanos time);
+void DefaultDisconnectCallback(TCPSocket *socket);
 
+/* Sends are gathered: Send copies small pieces like headers into the send ring, SendInPlace queues the caller's bytes
+ * as they are, and Flush hands everything queued to the kernel with one sendmsg. What the kernel doesn't take is kept
+ * in the send ring, in order, until the socket is writable again */
 class TCPSocket
 {
 public:
-    std::size_t TCPBufferSize = 64 * 1024 * 1024;
+    static constexpr std::size_t DEFAULT_BUFFER_SIZE = 256 * 1024;
+    /* Pieces queued between two flushes, Flush is called early when there are more */
+    static constexpr std::size_t MAX_SEND_PIECES = 64;
 
-    TCPSocket(QuickLogger &logger) : logger(logger)
+    std::size_t TCPBufferSize = DEFAULT_BUFFER_SIZE;
+
+    /* bufferSize is the size of each of the send and receive ring buffers, rounded up to a power of two pages */
+    TCPSocket(QuickLogger &logger, MemoryOptions const &memoryOptions = {},
+              std::size_t bufferSize = DEFAULT_BUFFER_SIZE)
+        : TCPBufferSize(bufferSize), sendBuffer(TCPBufferSize, memoryOptions), recvBuffer(TCPBufferSize, memoryOptions),
+          logger(logger)
     {
-        sendBuffer.resize(TCPBufferSize);
-        recvBuffer.resize(TCPBufferSize);
     }
 
     TCPSocket() = delete;
@@ -28,9 +41,42 @@ public:
     TCPSocket &operator=(const TCPSocket &&) = delete;
 
     Socket Connect(std::string const &ip, std::string const &iface, i32 port, bool isListening);
+    /* Copies the bytes, they can be reused as soon as it returns */
     void Send(void const *data, size_t len);
+    /* Queues the bytes without copying them, they must stay valid and unchanged until the next Flush */
+    void SendInPlace(void const *data, size_t len);
+    /* Reads what the kernel has and hands it to recvCallback. Returns whether anything was read */
+    bool Recv();
+    /* Writes what was queued. The part the kernel doesn't take is copied into the send ring for the next Flush */
+    void Flush();
     bool RecvAndSend();
 
+    /* Bytes queued that the kernel hasn't taken yet */
+    std::size_t GetSendQueueSize() const
+    {
+        return mSendBacklog + mPendingSendSize;
+    }
+
+    /* Most bytes a Flush ever left behind, how far the peer fell behind */
+    std::size_t GetSendQueueHighWaterMark() const
+    {
+        return mSendQueueHighWaterMark;
+    }
+
+    /* Back to the state of a socket never connected, keeping the buffers for the next connection */
+    void Reset();
+
+    /* Queues the socket on the send list of the server it belongs to, once */
+    void LinkToSendList()
+    {
+        if (sendList != nullptr && !inSendList)
+        {
+            nextSend = *sendList;
+            *sendList = this;
+            inSendList = true;
+        }
+    }
+
     void Destroy()
     {
         if (socket != -1)
@@ -48,15 +94,44 @@ public:
 public:
     Socket socket = -1;
 
-    std::vector<char> sendBuffer;
-    size_t nextSendIndex = 0;
-    std::vector<char> recvBuffer;
-    size_t nextRecvIndex = 0;
+    /* What Flush couldn't write yet, followed by the copies Send made since */
+    RingBuffer sendBuffer;
+    /* What Recv read and recvCallback hasn't consumed yet. The callback parses GetReadSpan() and calls
+     * UpdateReadIndex with what it is done with, a partial message is left in place for the next read */
+    RingBuffer recvBuffer;
+    /* Set once the peer closed or reset the connection */
+    bool peerClosed = false;
+
+    /* Bookkeeping of the TCPServer that accepted the socket, so it only goes through the sockets with work to do */
+    bool inReadyList = false;
+    bool inSendList = false;
+    TCPSocket *nextReady = nullptr;
+    TCPSocket *nextSend = nullptr;
+    /* Head of the server's send list, nullptr for a socket of our own */
+    TCPSocket **sendList = nullptr;
 
     sockaddr_in inAddr;
 
     std::function<void(TCPSocket *, Nanos time)> recvCallback = DefaultRecvCallback;
+    /* Called by the TCPServer that accepted the socket once the peer went away, before it recycles the socket */
+    std::function<void(TCPSocket *)> disconnectCallback = DefaultDisconnectCallback;
     std::string timeStr;
 
     QuickLogger &logger;
+
+private:
+    void QueueSendPiece(char const *data, std::size_t len, bool inRing);
+    /* Keeps what wasn't sent, sent being the bytes of the pieces from first on the kernel took */
+    void KeepUnsent(std::size_t first, std::size_t sent);
+    /* The peer is too far behind to keep the stream whole, the connection is shut down */
+    void AbortSend(std::size_t len);
+
+private:
+    /* Piece 0 is the backlog at the front of sendBuffer, the pieces queued since the last Flush follow */
+    std::array<iovec, MAX_SEND_PIECES + 1> mSendPieces;
+    std::array<bool, MAX_SEND_PIECES + 1> mSendPieceInRing;
+    std::size_t mNumSendPieces = 0;
+    std::size_t mSendBacklog = 0;
+    std::size_t mPendingSendSize = 0;
+    std::size_t mSendQueueHighWaterMark = 0;
 };
@@ -1,12 +1,25 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <bits/chrono.h>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <cstdlib>
 #include <ctime>
+#include <mutex>
 #include <string>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
 
 using Nanos = int64_t;
+/* Raw clock reading, only meaningful once converted by TSCClock */
+using Ticks = uint64_t;
 
 constexpr Nanos NANOS_TO_MICROS = 1000;
 constexpr Nanos MICROS_TO_MILLIS = 1000;
@@ -14,10 +27,225 @@ constexpr Nanos MILLIS_TO_SECS = 1000;
 constexpr Nanos NANOS_TO_MILLIS = NANOS_TO_MICROS * MICROS_TO_MILLIS;
 constexpr Nanos NANOS_TO_SECS = NANOS_TO_MICROS * MICROS_TO_MILLIS * MILLIS_TO_SECS;
 
+inline Nanos ReadClockNanos(clockid_t clock)
+{
+    timespec time;
+    clock_gettime(clock, &time);
+    return time.tv_sec * NANOS_TO_SECS + time.tv_nsec;
+}
+
+/* Clock based on the invariant TSC.
+ * Reading it is a single rdtsc. The tick rate is measured at startup against CLOCK_MONOTONIC_RAW and the ticks are
+ * anchored to CLOCK_REALTIME, so converted values are nanoseconds since the epoch like system_clock's. Reanchor
+ * refines the rate over a longer baseline and slews the conversion toward the realtime clock, so that converted values
+ * never go backwards; the housekeeping thread calls it periodically. Only an offset above STEP_THRESHOLD, which means
+ * the realtime clock itself was stepped, is stepped over. Without an invariant TSC the ticks are CLOCK_MONOTONIC_RAW
+ * nanoseconds instead. */
+class TSCClock
+{
+public:
+    static constexpr Nanos CALIBRATION_TIME = 10 * NANOS_TO_MILLIS;
+    static constexpr Nanos REANCHOR_INTERVAL = NANOS_TO_SECS;
+    static constexpr int SAMPLE_ATTEMPTS = 16;
+    /* Same bounds as the kernel's NTP discipline: a frequency correction of at most 500 ppm, a step above 128 ms */
+    static constexpr double MAX_SLEW_RATE = 500e-6;
+    static constexpr Nanos STEP_THRESHOLD = 128 * NANOS_TO_MILLIS;
+
+    static TSCClock &Instance()
+    {
+        static TSCClock clock;
+        return clock;
+    }
+
+    Ticks ReadTicks() const
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        if (invariantTSC) [[likely]]
+        {
+            return __rdtsc();
+        }
+#endif
+        return static_cast<Ticks>(ReadClockNanos(CLOCK_MONOTONIC_RAW));
+    }
+
+    /* Nanoseconds since the epoch */
+    Nanos ToNanos(Ticks ticks) const
+    {
+        Anchor anchor;
+        uint64_t sequence;
+        do
+        {
+            sequence = anchorSequence.load(std::memory_order_acquire);
+            anchor.ticks = anchorTicks.load(std::memory_order_relaxed);
+            anchor.nanos = anchorNanos.load(std::memory_order_relaxed);
+            anchor.nanosPerTick = nanosPerTick.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((sequence & 1) || sequence != anchorSequence.load(std::memory_order_relaxed));
+
+        return anchor.nanos + static_cast<Nanos>(static_cast<double>(static_cast<int64_t>(ticks - anchor.ticks)) *
+                                                 anchor.nanosPerTick);
+    }
+
+    /* Length of an interval measured in ticks. It runs at the same slewed rate as ToNanos, like CLOCK_MONOTONIC does */
+    Nanos ToDuration(Ticks ticks) const
+    {
+        return static_cast<Nanos>(static_cast<double>(ticks) * nanosPerTick.load(std::memory_order_relaxed));
+    }
+
+    /* The new anchor continues the current conversion at the sample, and its rate follows the realtime clock's
+     * frequency plus a correction that takes the remaining offset away by the next reanchor */
+    void Reanchor()
+    {
+        std::lock_guard lock(reanchorMutex);
+
+        const auto sample = TakeSample();
+        const auto rawNanosPerTick = invariantTSC && sample.ticks != calibrationTicks
+                                         ? static_cast<double>(sample.rawNanos - calibrationRawNanos) /
+                                               static_cast<double>(sample.ticks - calibrationTicks)
+                                         : 1.0;
+
+        const auto nanos = ToNanos(sample.ticks);
+        const auto offset = sample.realtimeNanos - nanos;
+        if (!anchored || std::abs(offset) > STEP_THRESHOLD)
+        {
+            StoreAnchor(sample.ticks, sample.realtimeNanos, rawNanosPerTick);
+            anchored = true;
+        }
+        else
+        {
+            /* How fast the realtime clock ran against the raw one since the last sample. It carries NTP's frequency
+             * correction, unless the realtime clock was stepped in between */
+            auto frequency = 1.0;
+            if (sample.ticks != lastSample.ticks)
+            {
+                const auto measured = static_cast<double>(sample.realtimeNanos - lastSample.realtimeNanos) /
+                                      (static_cast<double>(sample.ticks - lastSample.ticks) * rawNanosPerTick);
+                frequency = std::abs(measured - 1.0) <= MAX_SLEW_RATE ? measured : 1.0;
+            }
+            const auto slew = std::clamp(static_cast<double>(offset) / static_cast<double>(REANCHOR_INTERVAL),
+                                         -MAX_SLEW_RATE, MAX_SLEW_RATE);
+            StoreAnchor(sample.ticks, nanos, rawNanosPerTick * (frequency + slew));
+        }
+        lastSample = sample;
+    }
+
+    bool IsInvariantTSC() const
+    {
+        return invariantTSC;
+    }
+
+    TSCClock(const TSCClock &) = delete;
+    TSCClock(const TSCClock &&) = delete;
+    TSCClock &operator=(const TSCClock &) = delete;
+    TSCClock &operator=(const TSCClock &&) = delete;
+
+private:
+    struct Anchor
+    {
+        Ticks ticks;
+        Nanos nanos;
+        double nanosPerTick;
+    };
+
+    struct Sample
+    {
+        Ticks ticks;
+        Nanos rawNanos;
+        Nanos realtimeNanos;
+    };
+
+    TSCClock() : invariantTSC(HasInvariantTSC())
+    {
+        const auto start = TakeSample();
+        calibrationTicks = start.ticks;
+        calibrationRawNanos = start.rawNanos;
+
+        while (ReadClockNanos(CLOCK_MONOTONIC_RAW) - start.rawNanos < CALIBRATION_TIME)
+            ;
+
+        Reanchor();
+    }
+
+    void StoreAnchor(Ticks ticks, Nanos nanos, double newNanosPerTick)
+    {
+        /* Seqlock: readers retry while the sequence is odd or has changed under them */
+        const auto sequence = anchorSequence.load(std::memory_order_relaxed);
+        anchorSequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        anchorTicks.store(ticks, std::memory_order_relaxed);
+        anchorNanos.store(nanos, std::memory_order_relaxed);
+        nanosPerTick.store(newNanosPerTick, std::memory_order_relaxed);
+        anchorSequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    static bool HasInvariantTSC()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned eax, ebx, ecx, edx;
+        if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+        {
+            return edx & (1u << 8);
+        }
+#endif
+        return false;
+    }
+
+    /* The clocks are read between two tick readings and matched with their midpoint. The tightest of a few attempts is
+     * kept, so that a preemption or an interrupt in the middle doesn't skew the calibration */
+    Sample TakeSample() const
+    {
+        Sample best{};
+        Ticks bestGap = ~Ticks(0);
+        for (int attempt = 0; attempt < SAMPLE_ATTEMPTS; ++attempt)
+        {
+            const auto before = ReadTicks();
+            const auto rawNanos = ReadClockNanos(CLOCK_MONOTONIC_RAW);
+            const auto realtimeNanos = ReadClockNanos(CLOCK_REALTIME);
+            const auto after = ReadTicks();
+            if (after - before < bestGap)
+            {
+                bestGap = after - before;
+                best = {before + (after - before) / 2, rawNanos, realtimeNanos};
+            }
+        }
+        return best;
+    }
+
+private:
+    const bool invariantTSC;
+
+    Ticks calibrationTicks = 0;
+    Nanos calibrationRawNanos = 0;
+    std::mutex reanchorMutex;
+    bool anchored = false;
+    Sample lastSample{};
+
+    std::atomic<uint64_t> anchorSequence = 0;
+    std::atomic<Ticks> anchorTicks = 0;
+    std::atomic<Nanos> anchorNanos = 0;
+    std::atomic<double> nanosPerTick = 1.0;
+};
+
+/* Cheap timestamp for the hot paths. Convert it with TicksToNanos only when it has to be reported */
+inline Ticks GetCurrentTicks()
+{
+    return TSCClock::Instance().ReadTicks();
+}
+
+inline Nanos TicksToNanos(Ticks ticks)
+{
+    return TSCClock::Instance().ToNanos(ticks);
+}
+
+inline Nanos TicksToDuration(Ticks ticks)
+{
+    return TSCClock::Instance().ToDuration(ticks);
+}
+
+/* Nanoseconds since the epoch */
 inline auto GetCurrentNanos()
 {
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch())
-        .count();
+    return TicksToNanos(GetCurrentTicks());
 }
 
 inline void GetCurrentTimeStr(std::string &timeStr)
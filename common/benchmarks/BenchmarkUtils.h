@@ -0,0 +1,120 @@
+#pragma once
+
+#include "TimeUtils.h"
+#include "Types.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+inline auto GetBenchmarkIterations(int argc, char **argv, u64 defaultIterations) -> u64
+{
+    return argc > 1 ? std::strtoull(argv[1], nullptr, 10) : defaultIterations;
+}
+
+/* Returns the core to pin a benchmark thread on, or -1 when the machine doesn't have that many cores */
+inline auto GetBenchmarkCore(i32 coreId) -> i32
+{
+    return coreId < (i32)std::thread::hardware_concurrency() ? coreId : -1;
+}
+
+/* Busy-wait hint. On a single core machine spinning only burns the time slice of the thread we are waiting for */
+inline void SpinPause()
+{
+    static const bool singleCore = std::thread::hardware_concurrency() <= 1;
+    if (singleCore)
+    {
+        std::this_thread::yield();
+        return;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+template <typename Func> inline auto MeasureNanos(Func &&func) -> Nanos
+{
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+inline void ReportBenchmark(std::string const &name, u64 operations, Nanos nanos)
+{
+    const f64 nanosPerOp = operations ? (f64)nanos / (f64)operations : 0.0;
+    const f64 opsPerSec = nanos ? (f64)operations * 1e9 / (f64)nanos : 0.0;
+
+    std::cout << std::left << std::setw(56) << name << std::right << std::setw(12) << std::fixed
+              << std::setprecision(2) << nanosPerOp << " ns/op" << std::setw(16) << std::setprecision(0) << opsPerSec
+              << " ops/s\n";
+}
+
+/* Keeps the compiler from optimizing away a value computed only for the benchmark */
+template <typename T> inline void DoNotOptimize(T const &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/* Hardware event counted for the calling thread while it runs in user space. Stop returns -1 when the kernel or the
+ * hypervisor doesn't expose the event, or perf_event_paranoid forbids it */
+class PerfCounter
+{
+public:
+    PerfCounter(u32 type, u64 config)
+    {
+        perf_event_attr attributes{};
+        attributes.size = sizeof(attributes);
+        attributes.type = type;
+        attributes.config = config;
+        attributes.disabled = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+    }
+
+    ~PerfCounter()
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+
+    PerfCounter(PerfCounter const &) = delete;
+    PerfCounter &operator=(PerfCounter const &) = delete;
+
+    static u64 CacheEvent(u64 cache, u64 operation, u64 result)
+    {
+        return cache | (operation << 8) | (result << 16);
+    }
+
+    void Start()
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    int64_t Stop()
+    {
+        int64_t count = -1;
+        if (fd < 0 || ioctl(fd, PERF_EVENT_IOC_DISABLE, 0) != 0 || read(fd, &count, sizeof(count)) != sizeof(count))
+        {
+            return -1;
+        }
+        return count;
+    }
+
+private:
+    int fd = -1;
+};
@@ -0,0 +1,113 @@
+#include "common/Types.h"
+#include "common/benchmarks/BenchmarkUtils.h"
+#include "exchange/matcher/Checkpoint.h"
+#include "exchange/matcher/MEOrderBook.h"
+#include "exchange/matcher/MatchingEngine.h"
+
+#include <filesystem>
+#include <string>
+
+constexpr Price BASE_PRICE = 1000;
+constexpr u32 NUM_LEVELS = 100;
+constexpr u64 PROJECTED_ORDERS = 1'000'000;
+
+const std::string CHECKPOINT_DIRECTORY = "checkpoint_benchmark";
+
+template <typename T> void Drain(SafeQueue<T> &queue)
+{
+    for (auto span = queue.GetNextReadSpan(queue.GetCapacity()); !span.empty();
+         span = queue.GetNextReadSpan(queue.GetCapacity()))
+    {
+        queue.UpdateReadIndex(span.size());
+    }
+}
+
+struct Engine
+{
+    Exchange::MEClientRequestQueue requests{ME_MAX_CLIENT_UPDATES};
+    Exchange::MEClientResponseQueue responses{ME_MAX_CLIENT_UPDATES};
+    Exchange::MEMarketUpdateQueue marketUpdates{ME_MAX_MARKET_UPDATES};
+    Exchange::MatchingEngine engine{&requests, &responses, &marketUpdates};
+
+    void Process(Exchange::MEClientRequest request)
+    {
+        engine.ProcessClientRequest(&request);
+        Drain(responses);
+        Drain(marketUpdates);
+    }
+};
+
+/* Every book as full as the limits allow: ME_MAX_ORDER_IDS resting orders spread over NUM_LEVELS levels a side and
+ * every client, none crossing */
+u64 FillBooks(Engine &engine)
+{
+    u64 numOrders = 0;
+    for (TickerId tickerId = 0; tickerId < ME_MAX_TICKERS; ++tickerId)
+    {
+        for (u32 i = 0; i < ME_MAX_ORDER_IDS; ++i)
+        {
+            const auto side = i % 2 == 0 ? Side::BUY : Side::SELL;
+            const Price level = (i / 2) % NUM_LEVELS;
+            const Price price = side == Side::BUY ? BASE_PRICE - level : 2 * BASE_PRICE + level;
+            engine.Process({Exchange::ClientRequestType::NEW, i % ME_MAX_NUM_CLIENTS, tickerId, i / ME_MAX_NUM_CLIENTS,
+                            side, price, 10});
+            ++numOrders;
+        }
+    }
+    return numOrders;
+}
+
+/* The matching stall is the serialization in the shard, writing the file and loading it at restart are off the
+ * matching path. The books can't hold 1M orders under the current limits, the per order cost is projected instead */
+void BenchmarkCheckpoint(u64 iterations)
+{
+    std::filesystem::remove_all(CHECKPOINT_DIRECTORY);
+
+    Engine original;
+    const auto numOrders = FillBooks(original);
+
+    Exchange::CheckpointWriter writer(CHECKPOINT_DIRECTORY, 1, 1);
+    original.engine.SetCheckpointWriter(&writer);
+
+    Nanos serializeNanos = 0;
+    Nanos writeNanos = 0;
+    Nanos loadNanos = 0;
+    for (u64 i = 0; i < iterations; ++i)
+    {
+        serializeNanos += MeasureNanos([&] {
+            original.Process({Exchange::ClientRequestType::CHECKPOINT, ClientId_INVALID, TickerId_INVALID, i + 1});
+        });
+        /* Not started, so Stop writes the checkpoint on this thread */
+        writeNanos += MeasureNanos([&] { writer.Stop(); });
+
+        const auto path = Exchange::FindLatestCheckpoint(CHECKPOINT_DIRECTORY);
+        Engine restored;
+        Exchange::CheckpointInfo info;
+        loadNanos += MeasureNanos([&] {
+            info = Exchange::ReadCheckpoint(path, [&](TickerId tickerId) {
+                return restored.engine.GetOrderBook(tickerId);
+            });
+        });
+        CHECK_FATAL(info.orders.size() == numOrders, "Restored ", info.orders.size(), " orders out of ", numOrders);
+        std::filesystem::remove(path);
+    }
+    original.engine.SetCheckpointWriter(nullptr);
+    std::filesystem::remove_all(CHECKPOINT_DIRECTORY);
+
+    const auto orders = std::to_string(numOrders);
+    ReportBenchmark("checkpoint serialize " + orders + " orders (matching stall)", iterations, serializeNanos);
+    ReportBenchmark("checkpoint write + fsync " + orders + " orders", iterations, writeNanos);
+    ReportBenchmark("checkpoint load " + orders + " orders", iterations, loadNanos);
+    ReportBenchmark("checkpoint serialize (per order)", iterations * numOrders, serializeNanos);
+    ReportBenchmark("checkpoint load (per order)", iterations * numOrders, loadNanos);
+
+    const auto project = [&](Nanos nanos) { return nanos * PROJECTED_ORDERS / (iterations * numOrders) / 1'000'000; };
+    std::cout << "projected for " << PROJECTED_ORDERS << " orders: stall " << project(serializeNanos) << " ms, write "
+              << project(writeNanos) << " ms, load " << project(loadNanos) << " ms\n";
+}
+
+int main(int argc, char **argv)
+{
+    BenchmarkCheckpoint(GetBenchmarkIterations(argc, argv, 20));
+    return 0;
+}
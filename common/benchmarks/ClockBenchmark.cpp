@@ -0,0 +1,41 @@
+#include "common/TimeUtils.h"
+#include "common/Types.h"
+#include "common/benchmarks/BenchmarkUtils.h"
+
+/* What the previous GetCurrentNanos did */
+inline Nanos LegacyGetCurrentNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+template <typename Func> void BenchmarkClock(std::string const &name, u64 iterations, Func &&readClock)
+{
+    u64 checksum = 0;
+    const auto nanos = MeasureNanos([&] {
+        for (u64 i = 0; i < iterations; ++i)
+        {
+            checksum += static_cast<u64>(readClock());
+        }
+    });
+    DoNotOptimize(checksum);
+
+    ReportBenchmark(name, iterations, nanos);
+}
+
+int main(int argc, char **argv)
+{
+    const auto iterations = GetBenchmarkIterations(argc, argv, 10'000'000);
+
+    std::cout << "Invariant TSC: " << (TSCClock::Instance().IsInvariantTSC() ? "yes" : "no") << '\n';
+
+    BenchmarkClock("system_clock::now", iterations, LegacyGetCurrentNanos);
+    BenchmarkClock("clock_gettime(CLOCK_MONOTONIC_RAW)", iterations, [] { return ReadClockNanos(CLOCK_MONOTONIC_RAW); });
+    BenchmarkClock("GetCurrentTicks", iterations, GetCurrentTicks);
+    BenchmarkClock("GetCurrentNanos", iterations, GetCurrentNanos);
+
+    /* Drift of the calibrated clock against the realtime clock it's anchored to */
+    const auto drift = GetCurrentNanos() - LegacyGetCurrentNanos();
+    std::cout << "Drift against system_clock: " << drift << " ns\n";
+    return 0;
+}
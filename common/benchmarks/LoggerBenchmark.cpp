@@ -0,0 +1,163 @@
+#include "common/Logger.h"
+#include "common/SafeQueue.h"
+#include "common/Types.h"
+#include "common/benchmarks/BenchmarkUtils.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+/* The logger as it was before the binary records, kept here as the baseline to compare against */
+class LegacyQuickLogger
+{
+private:
+    struct LogElement
+    {
+        char type = 0;
+        union {
+            char c;
+            long long ll;
+            unsigned long long ull;
+            double d;
+        } data;
+    };
+
+public:
+    explicit LegacyQuickLogger(std::string const &path) : queue(1024 * 1024 * 8)
+    {
+        outputStream.open(path.c_str());
+        loggerThread = CreateAndStartThread(-1, "LegacyLoggerThread", [&] { FlushQueue(); });
+    }
+    ~LegacyQuickLogger()
+    {
+        shouldStop = true;
+        loggerThread->join();
+    }
+
+    void Log()
+    {
+    }
+
+    template <typename Arg, typename... Args> void Log(Arg const &value, Args &&...args)
+    {
+        PushValue(value);
+        Log(args...);
+    }
+
+private:
+    void PushValue(LogElement const &value)
+    {
+        *queue.GetNextWriteTo() = value;
+        queue.UpdateWriteIndex();
+    }
+
+    void PushValue(char const c)
+    {
+        PushValue(LogElement{1, {.c = c}});
+    }
+
+    void PushValue(char const *c)
+    {
+        while (*c)
+        {
+            PushValue(*c);
+            ++c;
+        }
+    }
+
+    void PushValue(std::string const &c)
+    {
+        PushValue(c.c_str());
+    }
+
+    void PushValue(u64 const c)
+    {
+        PushValue(LogElement{2, {.ull = c}});
+    }
+
+    void FlushQueue()
+    {
+        while (!shouldStop)
+        {
+            for (auto next = queue.GetNextRead(); next; next = queue.GetNextRead())
+            {
+                if (next->type == 1)
+                    outputStream << next->data.c;
+                else
+                    outputStream << next->data.ull;
+                queue.UpdateReadIndex();
+            }
+            outputStream.flush();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    std::ofstream outputStream;
+    SafeQueue<LogElement> queue;
+    std::unique_ptr<std::thread> loggerThread;
+    std::atomic<bool> shouldStop = false;
+};
+
+/* Shaped like the requests the matching engine logs */
+struct Request
+{
+    u8 type = 1;
+    u32 clientId = 3;
+    u32 tickerId = 1;
+    u64 orderId = 0;
+    i8 side = 1;
+    u64 price = 100;
+    u32 quantity = 10;
+
+    auto ToString() const -> std::string
+    {
+        std::stringstream ss;
+        ss << "Request {\n\ttype: " << (int)type << "\n\tclientId: " << clientId << "\n\ttickerId: " << tickerId
+           << "\n\torderId: " << orderId << "\n\tside: " << (int)side << "\n\tprice: " << price
+           << "\n\tquantity: " << quantity << "\n}";
+        return ss.str();
+    }
+};
+
+template <typename Logger, typename LogFunction, typename... LoggerArgs>
+void BenchmarkLogger(std::string const &name, u64 iterations, LogFunction &&log, LoggerArgs &&...loggerArgs)
+{
+    Logger logger(std::forward<LoggerArgs>(loggerArgs)...);
+    Request request;
+
+    const auto nanos = MeasureNanos([&] {
+        for (u64 i = 0; i < iterations; ++i)
+        {
+            request.orderId = i;
+            log(logger, request);
+        }
+    });
+
+    ReportBenchmark(name, iterations, nanos);
+}
+
+/* On a machine with few cores the logger thread competes with the benchmark, so its decoding shows up in the numbers */
+int main(int argc, char **argv)
+{
+    /* The legacy logger overwrites its queue when it fills up, keep it below 8M elements */
+    const auto iterations = GetBenchmarkIterations(argc, argv, 20'000);
+
+    auto logToString = [](auto &logger, Request const &request) {
+        logger.Log("Processing request ", request.ToString(), '\n');
+    };
+    auto logFields = [](auto &logger, Request const &request) {
+        logger.template LogFormat<"Processing request: type {} client {} ticker {} order {} side {} price {} "
+                                  "quantity {}\n">(request.type, request.clientId, request.tickerId, request.orderId,
+                                                   request.side, request.price, request.quantity);
+    };
+
+    BenchmarkLogger<LegacyQuickLogger>("LegacyQuickLogger Log(ToString())", iterations, logToString,
+                                       "logger_benchmark_legacy.log");
+    BenchmarkLogger<QuickLogger>("QuickLogger Log(ToString())", iterations, logToString, "logger_benchmark_text.log");
+    BenchmarkLogger<QuickLogger>("QuickLogger LogFormat(fields)", iterations, logFields,
+                                 "logger_benchmark_format.log");
+    BenchmarkLogger<QuickLogger>("QuickLogger LogFormat(fields), binary output", iterations, logFields,
+                                 "logger_benchmark_binary.log", MemoryOptions{}, LogOutput::BINARY);
+
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include "common/Logger.h"
+#include "common/MPSCQueue.h"
+#include "common/SafeQueue.h"
+#include "common/ThreadUtils.h"
+#include "common/Types.h"
+#include "common/benchmarks/BenchmarkUtils.h"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Message
+{
+    u32 producerId = 0;
+    u64 sequence = 0;
+    u64 payload[2] = {};
+};
+
+constexpr std::size_t QUEUE_SIZE = 4096;
+constexpr u32 MAX_PRODUCERS = 8;
+
+/* Baseline: the single producer queue shared by all the producers through a lock */
+class LockedQueue
+{
+public:
+    explicit LockedQueue(std::size_t numElements) : queue(numElements)
+    {
+    }
+
+    bool TryPush(Message const &message)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto nextWrite = queue.TryGetNextWriteTo();
+        if (nextWrite == nullptr)
+        {
+            return false;
+        }
+        *nextWrite = message;
+        queue.UpdateWriteIndex();
+        return true;
+    }
+
+    Message *GetNextRead()
+    {
+        return queue.GetNextRead();
+    }
+
+    void UpdateReadIndex()
+    {
+        queue.UpdateReadIndex();
+    }
+
+private:
+    std::mutex mutex;
+    SafeQueue<Message> queue;
+};
+
+class LockFreeQueue
+{
+public:
+    explicit LockFreeQueue(std::size_t numElements) : queue(numElements)
+    {
+    }
+
+    bool TryPush(Message const &message)
+    {
+        auto nextWrite = queue.TryGetNextWriteTo();
+        if (nextWrite == nullptr)
+        {
+            return false;
+        }
+        *nextWrite = message;
+        queue.UpdateWriteIndex(nextWrite);
+        return true;
+    }
+
+    Message *GetNextRead()
+    {
+        return queue.GetNextRead();
+    }
+
+    void UpdateReadIndex()
+    {
+        queue.UpdateReadIndex();
+    }
+
+private:
+    MPSCQueue<Message> queue;
+};
+
+template <typename Queue> void BenchmarkProducers(std::string const &name, u32 numProducers, u64 iterations)
+{
+    Queue queue(QUEUE_SIZE);
+    const u64 messagesPerProducer = iterations / numProducers;
+    std::atomic<bool> start = false;
+
+    auto produceFunction = [&](u32 producerId) {
+        while (!start)
+        {
+            SpinPause();
+        }
+
+        Message message;
+        message.producerId = producerId;
+        for (u64 i = 0; i < messagesPerProducer; ++i)
+        {
+            message.sequence = i;
+            while (!queue.TryPush(message))
+            {
+                SpinPause();
+            }
+        }
+    };
+
+    /* The thread arguments are forwarded by reference, so every producer gets its own stable id */
+    std::array<u32, MAX_PRODUCERS> producerIds;
+    std::vector<std::unique_ptr<std::thread>> producers;
+    for (u32 i = 0; i < numProducers; ++i)
+    {
+        producerIds[i] = i;
+        producers.push_back(
+            CreateAndStartThread(GetBenchmarkCore(i + 1), "Benchmark/Producer", produceFunction, producerIds[i]));
+    }
+
+    std::array<u64, MAX_PRODUCERS> nextExpected{};
+    const auto totalMessages = messagesPerProducer * numProducers;
+
+    const auto nanos = MeasureNanos([&] {
+        start = true;
+
+        for (u64 received = 0; received < totalMessages;)
+        {
+            auto nextRead = queue.GetNextRead();
+            if (nextRead == nullptr)
+            {
+                SpinPause();
+                continue;
+            }
+
+            CHECK_FATAL(nextRead->sequence == nextExpected[nextRead->producerId], "Producer ", nextRead->producerId,
+                        " messages were reordered");
+            ++nextExpected[nextRead->producerId];
+
+            queue.UpdateReadIndex();
+            ++received;
+        }
+    });
+
+    for (auto &producer : producers)
+    {
+        producer->join();
+    }
+
+    ReportBenchmark(name + " " + std::to_string(numProducers) + " producer(s)", totalMessages, nanos);
+}
+
+int main(int argc, char **argv)
+{
+    const auto iterations = GetBenchmarkIterations(argc, argv, 8'000'000);
+    SetThreadCore(0);
+
+    for (u32 numProducers = 1; numProducers <= MAX_PRODUCERS; numProducers *= 2)
+    {
+        BenchmarkProducers<LockedQueue>("mutex + SafeQueue", numProducers, iterations);
+        BenchmarkProducers<LockFreeQueue>("MPSCQueue", numProducers, iterations);
+    }
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "common/MappedMemory.h"
+#include "common/Types.h"
+#include "common/benchmarks/BenchmarkUtils.h"
+
+#include <random>
+#include <vector>
+
+constexpr std::size_t BUFFER_SIZE = 64 * 1024 * 1024;
+
+/* Time spent by the first write to every page, which is what the first burst after startup pays */
+void BenchmarkFirstTouch(std::string const &name, MemoryOptions const &options)
+{
+    std::vector<char, MappedAllocator<char>> buffer(options);
+    const auto allocationNanos = MeasureNanos([&] { buffer.reserve(BUFFER_SIZE); });
+
+    auto data = buffer.data();
+    const auto touchNanos = MeasureNanos([&] {
+        for (std::size_t offset = 0; offset < BUFFER_SIZE; offset += PAGE_SIZE)
+        {
+            data[offset] = 1;
+        }
+    });
+    DoNotOptimize(data[0]);
+
+    ReportBenchmark(name + " allocate (per 4 KiB page)", BUFFER_SIZE / PAGE_SIZE, allocationNanos);
+    ReportBenchmark(name + " first touch (per 4 KiB page)", BUFFER_SIZE / PAGE_SIZE, touchNanos);
+}
+
+/* Random reads over the whole buffer, dominated by TLB misses when it's backed by small pages */
+void BenchmarkRandomAccess(std::string const &name, MemoryOptions const &options, u64 iterations)
+{
+    std::vector<u64, MappedAllocator<u64>> buffer(BUFFER_SIZE / sizeof(u64), 0, options);
+
+    std::mt19937_64 random(42);
+    std::vector<u32> indices(iterations);
+    for (auto &index : indices)
+    {
+        index = random() % buffer.size();
+    }
+
+    u64 checksum = 0;
+    const auto nanos = MeasureNanos([&] {
+        for (auto index : indices)
+        {
+            checksum += buffer[index];
+        }
+    });
+    DoNotOptimize(checksum);
+
+    ReportBenchmark(name + " random read", iterations, nanos);
+}
+
+int main(int argc, char **argv)
+{
+    const auto iterations = GetBenchmarkIterations(argc, argv, 10'000'000);
+
+    const MemoryOptions hugePages{.hugePages = true};
+    const MemoryOptions prefaulted{.prefault = true};
+    const auto lowLatency = MemoryOptions::LowLatency();
+
+    BenchmarkFirstTouch("heap", {});
+    BenchmarkFirstTouch("huge pages", hugePages);
+    BenchmarkFirstTouch("prefaulted", prefaulted);
+    BenchmarkFirstTouch("low latency", lowLatency);
+
+    BenchmarkRandomAccess("heap", {}, iterations);
+    BenchmarkRandomAccess("low latency", lowLatency, iterations);
+
+    return 0;
+}
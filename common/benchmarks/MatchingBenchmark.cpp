@@ -0,0 +1,68 @@
+#include "common/Logger.h"
+#include "common/Types.h"
+#include "common/benchmarks/BenchmarkUtils.h"
+#include "exchange/matcher/MEOrderBook.h"
+#include "exchange/matcher/MatchingEngine.h"
+
+constexpr ClientId RESTING_CLIENT = 1;
+constexpr ClientId AGGRESSIVE_CLIENT = 2;
+constexpr Price BASE_PRICE = 100;
+
+template <typename T> void Drain(SafeQueue<T> &queue)
+{
+    for (auto span = queue.GetNextReadSpan(queue.GetCapacity()); !span.empty();
+         span = queue.GetNextReadSpan(queue.GetCapacity()))
+    {
+        queue.UpdateReadIndex(span.size());
+    }
+}
+
+/* An aggressive buy that takes out numLevels ask levels holding one order each. Only the sweep is timed, the asks are
+ * put back before every iteration */
+void BenchmarkSweep(u32 numLevels, u64 iterations)
+{
+    Exchange::MEClientRequestQueue clientRequests(ME_MAX_CLIENT_UPDATES);
+    Exchange::MEClientResponseQueue clientResponses(ME_MAX_CLIENT_UPDATES);
+    Exchange::MEMarketUpdateQueue marketUpdates(ME_MAX_MARKET_UPDATES);
+    Exchange::MatchingEngine engine(&clientRequests, &clientResponses, &marketUpdates);
+
+    QuickLogger logger("matching_benchmark.log");
+    Exchange::MEOrderBook book(0, &logger, &engine);
+
+    Nanos totalNanos = 0;
+    for (u64 i = 0; i < iterations; ++i)
+    {
+        for (u32 level = 0; level < numLevels; ++level)
+        {
+            book.Add(RESTING_CLIENT, level, 0, Side::SELL, BASE_PRICE + level, 1);
+        }
+        engine.PublishOutputs();
+        Drain(clientResponses);
+        Drain(marketUpdates);
+
+        totalNanos += MeasureNanos([&] {
+            book.Add(AGGRESSIVE_CLIENT, 0, 0, Side::BUY, BASE_PRICE + numLevels - 1, numLevels);
+            engine.PublishOutputs();
+        });
+
+        /* Accepted, then two fills per level */
+        CHECK_FATAL(clientResponses.GetSize() == 1 + 2 * numLevels, "Sweep didn't fill every level");
+        CHECK_FATAL(book.GetOrdersAtPrice(Side::SELL, BASE_PRICE) == nullptr, "Sweep left orders in the book");
+        Drain(clientResponses);
+        Drain(marketUpdates);
+    }
+
+    ReportBenchmark("sweep " + std::to_string(numLevels) + " levels", iterations, totalNanos);
+    ReportBenchmark("sweep " + std::to_string(numLevels) + " levels (per level)", iterations * numLevels, totalNanos);
+}
+
+int main(int argc, char **argv)
+{
+    const auto iterations = GetBenchmarkIterations(argc, argv, 100'000);
+
+    for (u32 numLevels : {1, 10, 100})
+    {
+        BenchmarkSweep(numLevels, std::max<u64>(iterations / numLevels, 1));
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "common/Logger.h"
+#include "common/MemoryPool.h"
+#include "common/Types.h"
+#include "common/benchmarks/BenchmarkUtils.h"
+
+#include <random>
+#include <vector>
+
+/* The pool as it was before the free-list, kept here as the baseline to compare against */
+template <typename T> class LegacyMemoryPool final
+{
+public:
+    explicit LegacyMemoryPool(std::size_t numElems) : store(numElems, {T(), true})
+    {
+    }
+
+    template <typename... Args> T *Allocate(Args... args)
+    {
+        auto obj_block = &(store[nextFreeIndex]);
+        T *ret = &obj_block->object;
+        ret = new (ret) T(std::forward<Args>(args)...);
+        obj_block->isFree = false;
+
+        UpdateNextFreeIndex();
+
+        return ret;
+    }
+
+    void Deallocate(T *elem)
+    {
+        auto elemIndex = reinterpret_cast<ObjectBlock *>(elem) - &store[0];
+        store[elemIndex].isFree = true;
+    }
+
+private:
+    void UpdateNextFreeIndex()
+    {
+        const auto initialFreeIndex = nextFreeIndex;
+        while (!store[nextFreeIndex].isFree)
+        {
+            nextFreeIndex++;
+            if (nextFreeIndex == store.size()) [[unlikely]]
+            {
+                nextFreeIndex = 0;
+            }
+            if (nextFreeIndex == initialFreeIndex) [[unlikely]]
+            {
+                break;
+            }
+        }
+    }
+
+    struct ObjectBlock
+    {
+        T object;
+        bool isFree = true;
+    };
+
+    std::vector<ObjectBlock> store;
+    size_t nextFreeIndex = 0;
+};
+
+/* Roughly the size of an exchange order */
+struct Order
+{
+    u64 fields[9] = {};
+
+    Order() = default;
+    explicit Order(u64 id)
+    {
+        fields[0] = id;
+    }
+};
+
+constexpr std::size_t POOL_SIZE = 256 * 1024;
+
+/* Fills the pool to 90% and then frees a random live element and allocates a new one on every iteration */
+template <typename Pool> void BenchmarkFragmented(std::string const &name, u64 iterations)
+{
+    Pool pool(POOL_SIZE);
+    std::mt19937_64 random(42);
+
+    std::vector<Order *> live;
+    live.reserve(POOL_SIZE);
+    for (std::size_t i = 0; i < POOL_SIZE * 9 / 10; ++i)
+    {
+        live.push_back(pool.Allocate(i));
+    }
+
+    /* Pre-compute the random choices so that the generator isn't measured */
+    std::vector<u32> victims(iterations);
+    for (auto &victim : victims)
+    {
+        victim = random() % live.size();
+    }
+
+    u64 checksum = 0;
+    const auto nanos = MeasureNanos([&] {
+        for (u64 i = 0; i < iterations; ++i)
+        {
+            auto &slot = live[victims[i]];
+            pool.Deallocate(slot);
+            slot = pool.Allocate(i);
+            checksum += slot->fields[0];
+        }
+    });
+    DoNotOptimize(checksum);
+
+    ReportBenchmark(name + " free+allocate at 90% occupancy", iterations, nanos);
+}
+
+int main(int argc, char **argv)
+{
+    const auto iterations = GetBenchmarkIterations(argc, argv, 1'000'000);
+
+    BenchmarkFragmented<LegacyMemoryPool<Order>>("LegacyMemoryPool", iterations);
+    BenchmarkFragmented<MemoryPool<Order>>("MemoryPool", iterations);
+
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include "common/Logger.h"
+#include "common/TCPSocket.h"
+#include "common/Types.h"
+#include "common/benchmarks/BenchmarkUtils.h"
+#include "exchange/matcher/ShardedMatchingEngine.h"
+#include "exchange/order_server/OrderEntryFrame.h"
+#include "exchange/order_server/OrderServer.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+constexpr u32 NUM_CLIENTS = 256;
+constexpr i32 BASE_PORT = 12400;
+constexpr Price BASE_PRICE = 100;
+
+/* A simulated client on loopback. It checks the sequence numbers of the response frames and counts the responses */
+struct Client
+{
+    Client(QuickLogger &logger, ClientId clientId, i32 port)
+        : socket(logger), clientId(clientId)
+    {
+        CHECK_FATAL(socket.Connect("127.0.0.1", "lo", port, false) >= 0, "Client ", clientId, " couldn't connect");
+        socket.recvCallback = [this](TCPSocket *socket, Nanos) {
+            auto received = socket->recvBuffer.GetReadSpan();
+            bool malformed = false;
+            const auto consumed = Exchange::ParseFrames<Exchange::MEClientResponse>(
+                received.data(), received.size(), malformed,
+                [this](Exchange::OMFrameHeader const &header, std::span<Exchange::MEClientResponse const> responses) {
+                    CHECK_FATAL(header.sequenceNumber == nextResponseSequenceNumber++, "Client ", this->clientId,
+                                " got response frame ", header.sequenceNumber);
+                    numResponses += responses.size();
+                });
+            CHECK_FATAL(!malformed, "Client ", this->clientId, " got a malformed frame");
+            socket->recvBuffer.UpdateReadIndex(consumed);
+        };
+    }
+
+    /* A new order and its cancel in one frame, answered with an accept and a cancel */
+    void SendRound(OrderId orderId)
+    {
+        const TickerId tickerId = clientId % ME_MAX_TICKERS;
+        const Exchange::MEClientRequest requests[] = {
+            {Exchange::ClientRequestType::NEW, clientId, tickerId, orderId, Side::BUY, BASE_PRICE, 1},
+            {Exchange::ClientRequestType::CANCEL, clientId, tickerId, orderId, Side::BUY, BASE_PRICE, 1},
+        };
+        Exchange::SendFrame(socket, nextRequestSequenceNumber++, std::span<Exchange::MEClientRequest const>(requests));
+        socket.RecvAndSend();
+    }
+
+    TCPSocket socket;
+    ClientId clientId;
+    u64 nextRequestSequenceNumber = 1;
+    u64 nextResponseSequenceNumber = 1;
+    u64 numResponses = 0;
+};
+
+/* Every round, each of the NUM_CLIENTS clients sends a frame and the round ends once all of them have their answers.
+ * This thread plays the clients and the market data publisher */
+void BenchmarkOrderEntry(u32 numIOThreads, u64 numRounds)
+{
+    const i32 port = BASE_PORT + static_cast<i32>(numIOThreads);
+    const auto shardConfig = Exchange::ShardConfig::RoundRobin(1);
+    Exchange::ShardedMatchingEngine engine(shardConfig);
+    auto marketUpdates = engine.GetMarketUpdateQueues();
+    engine.Start();
+
+    auto orderServer = std::make_unique<Exchange::OrderServer>(engine.GetClientRequestQueues(), shardConfig,
+                                                               engine.GetClientResponseQueues(), "lo", port, "", 1,
+                                                               numIOThreads);
+    orderServer->Start();
+
+    QuickLogger logger("order_entry_benchmark.log");
+    std::vector<std::unique_ptr<Client>> clients;
+    for (ClientId clientId = 0; clientId < NUM_CLIENTS; ++clientId)
+    {
+        clients.push_back(std::make_unique<Client>(logger, clientId, port));
+    }
+
+    auto drainMarketUpdates = [&]() {
+        for (auto queue : marketUpdates)
+        {
+            for (auto span = queue->GetNextReadSpan(ME_MAX_MARKET_UPDATES); !span.empty();
+                 span = queue->GetNextReadSpan(ME_MAX_MARKET_UPDATES))
+            {
+                queue->UpdateReadIndex(span.size());
+            }
+        }
+    };
+
+    Nanos worstRound = 0;
+    const auto nanos = MeasureNanos([&] {
+        for (u64 round = 0; round < numRounds; ++round)
+        {
+            const auto roundNanos = MeasureNanos([&] {
+                for (auto &client : clients)
+                {
+                    client->SendRound(round);
+                }
+
+                const u64 expectedResponses = 2 * (round + 1);
+                for (bool done = false; !done;)
+                {
+                    done = true;
+                    for (auto &client : clients)
+                    {
+                        client->socket.RecvAndSend();
+                        done &= client->numResponses == expectedResponses;
+                    }
+                    drainMarketUpdates();
+                    if (!done)
+                    {
+                        SpinPause();
+                    }
+                }
+            });
+            worstRound = std::max(worstRound, roundNanos);
+        }
+    });
+
+    /* The server sees the clients go away and cancels what they left, which is nothing */
+    clients.clear();
+    orderServer->Stop();
+    orderServer.reset();
+    drainMarketUpdates();
+    engine.Stop();
+
+    const auto name = std::to_string(NUM_CLIENTS) + " clients, " + std::to_string(numIOThreads) + " I/O thread(s)";
+    ReportBenchmark(name + " (per request)", 2 * NUM_CLIENTS * numRounds, nanos);
+    ReportBenchmark(name + " (per round)", numRounds, nanos);
+    std::cout << name << ": worst round " << worstRound << " ns\n";
+}
+
+int main(int argc, char **argv)
+{
+    const auto numRounds = GetBenchmarkIterations(argc, argv, 200);
+
+    for (u32 numIOThreads = 1; numIOThreads <= std::min<u32>(4, ME_MAX_ORDER_ENTRY_THREADS); numIOThreads *= 2)
+    {
+        BenchmarkOrderEntry(numIOThreads, numRounds);
+    }
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include "common/OrderStore.h"
+#include "common/Types.h"
+#include "common/benchmarks/BenchmarkUtils.h"
+#include "exchange/matcher/MEOrder.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+/* MEOrder as it was before the hot/cold split, kept here as the baseline */
+struct LegacyOrder
+{
+    TickerId tickerId = TickerId_INVALID;
+    ClientId clientId = ClientId_INVALID;
+    OrderId clientOrderId = OrderId_INVALID;
+    OrderId marketOrderId = OrderId_INVALID;
+    Side side = Side::INVALID;
+    Price price = Price_INVALID;
+    Quantity quantity = Quantity_INVALID;
+    Priority priority = Priority_INVALID;
+
+    LegacyOrder *nextOrder = nullptr;
+    LegacyOrder *prevOrder = nullptr;
+};
+
+constexpr u32 NUM_LEVELS = 256;
+constexpr u32 ORDERS_PER_LEVEL = 256;
+constexpr u32 NUM_ORDERS = NUM_LEVELS * ORDERS_PER_LEVEL;
+
+/* Which slot every order of every level lives in. Shuffled, as after a long session of adds and cancels, so the orders
+ * of a level are scattered over the whole store */
+std::vector<u32> MakeSlots()
+{
+    std::vector<u32> slots(NUM_ORDERS);
+    std::iota(slots.begin(), slots.end(), 0);
+    std::shuffle(slots.begin(), slots.end(), std::mt19937(42));
+    return slots;
+}
+
+struct LegacyBook
+{
+    std::vector<LegacyOrder> orders{NUM_ORDERS};
+    std::vector<LegacyOrder *> firstOrders;
+
+    LegacyBook(std::vector<u32> const &slots)
+    {
+        for (u32 level = 0; level < NUM_LEVELS; ++level)
+        {
+            LegacyOrder *first = nullptr;
+            for (u32 i = 0; i < ORDERS_PER_LEVEL; ++i)
+            {
+                auto order = &orders[slots[level * ORDERS_PER_LEVEL + i]];
+                *order = {1, 2, i, level * ORDERS_PER_LEVEL + i, Side::SELL, level, 1'000'000, i};
+                if (first == nullptr)
+                {
+                    first = order->nextOrder = order->prevOrder = order;
+                    continue;
+                }
+                order->prevOrder = first->prevOrder;
+                order->nextOrder = first;
+                first->prevOrder->nextOrder = order;
+                first->prevOrder = order;
+            }
+            firstOrders.push_back(first);
+        }
+    }
+
+    /* What a walk that only needs the queue reads, like finding the quantity ahead of an order */
+    u64 WalkLevel(u32 level)
+    {
+        u64 total = 0;
+        auto first = firstOrders[level];
+        auto order = first;
+        do
+        {
+            total += order->quantity + order->price;
+            order = order->nextOrder;
+        } while (order != first);
+        return total;
+    }
+
+    /* Fills one lot of every order, reading what reporting the fill needs */
+    u64 MatchLevel(u32 level)
+    {
+        u64 total = 0;
+        auto first = firstOrders[level];
+        auto order = first;
+        do
+        {
+            order->quantity -= 1;
+            total += order->price + order->clientId + order->clientOrderId + order->marketOrderId;
+            order = order->nextOrder;
+        } while (order != first);
+        return total;
+    }
+};
+
+struct SplitBook
+{
+    Exchange::MEOrderStore orders{NUM_ORDERS};
+    std::vector<OrderLevel> levels{NUM_LEVELS};
+
+    SplitBook(std::vector<u32> const &slots)
+    {
+        /* The store hands out the slots in order, so allocate everything and then queue it level by level */
+        for (u32 i = 0; i < NUM_ORDERS; ++i)
+        {
+            orders.Allocate({}, {});
+        }
+        for (u32 level = 0; level < NUM_LEVELS; ++level)
+        {
+            for (u32 i = 0; i < ORDERS_PER_LEVEL; ++i)
+            {
+                const auto index = slots[level * ORDERS_PER_LEVEL + i];
+                orders.Hot(index) = {.price = level, .priority = i, .quantity = 1'000'000, .side = Side::SELL};
+                orders.Cold(index) = {1, 2, i, level * ORDERS_PER_LEVEL + i};
+                orders.PushBack(levels[level], index);
+            }
+        }
+    }
+
+    u64 WalkLevel(u32 level)
+    {
+        u64 total = 0;
+        const auto first = levels[level].firstOrder;
+        auto index = first;
+        do
+        {
+            auto const &order = orders.Hot(index);
+            total += order.quantity + order.price;
+            index = order.nextOrder;
+        } while (index != first);
+        return total;
+    }
+
+    u64 MatchLevel(u32 level)
+    {
+        u64 total = 0;
+        auto &ordersAtPrice = levels[level];
+        const auto first = ordersAtPrice.firstOrder;
+        auto index = first;
+        do
+        {
+            auto &order = orders.Hot(index);
+            auto const &info = orders.Cold(index);
+            order.quantity -= 1;
+            ordersAtPrice.totalQuantity -= 1;
+            total += order.price + info.clientId + info.clientOrderId + info.marketOrderId;
+            index = order.nextOrder;
+        } while (index != first);
+        return total;
+    }
+};
+
+template <typename Book, typename Walk>
+void BenchmarkWalk(std::string const &name, Book &book, std::vector<u32> const &levels, Walk walk)
+{
+    PerfCounter l1Misses(PERF_TYPE_HW_CACHE, PerfCounter::CacheEvent(PERF_COUNT_HW_CACHE_L1D,
+                                                                     PERF_COUNT_HW_CACHE_OP_READ,
+                                                                     PERF_COUNT_HW_CACHE_RESULT_MISS));
+    PerfCounter llcMisses(PERF_TYPE_HW_CACHE, PerfCounter::CacheEvent(PERF_COUNT_HW_CACHE_LL,
+                                                                      PERF_COUNT_HW_CACHE_OP_READ,
+                                                                      PERF_COUNT_HW_CACHE_RESULT_MISS));
+
+    u64 checksum = 0;
+    l1Misses.Start();
+    llcMisses.Start();
+    const auto nanos = MeasureNanos([&] {
+        for (auto level : levels)
+        {
+            checksum += walk(book, level);
+        }
+    });
+    const auto l1 = l1Misses.Stop();
+    const auto llc = llcMisses.Stop();
+    DoNotOptimize(checksum);
+
+    const u64 ordersWalked = levels.size() * ORDERS_PER_LEVEL;
+    ReportBenchmark(name + " (per order)", ordersWalked, nanos);
+
+    const auto perOrder = [&](int64_t count) {
+        return count < 0 ? std::string("n/a") : std::to_string(static_cast<f64>(count) / ordersWalked);
+    };
+    std::cout << "    L1D read misses per order: " << perOrder(l1) << "; LLC read misses per order: " << perOrder(llc)
+              << '\n';
+}
+
+int main(int argc, char **argv)
+{
+    const auto iterations = GetBenchmarkIterations(argc, argv, 20'000);
+
+    const auto slots = MakeSlots();
+    std::vector<u32> levels(iterations);
+    std::mt19937 random(7);
+    for (auto &level : levels)
+    {
+        level = random() % NUM_LEVELS;
+    }
+
+    LegacyBook legacy(slots);
+    SplitBook split(slots);
+
+    BenchmarkWalk("legacy walk", legacy, levels, [](auto &book, u32 level) { return book.WalkLevel(level); });
+    BenchmarkWalk("hot/cold walk", split, levels, [](auto &book, u32 level) { return book.WalkLevel(level); });
+    BenchmarkWalk("legacy match", legacy, levels, [](auto &book, u32 level) { return book.MatchLevel(level); });
+    BenchmarkWalk("hot/cold match", split, levels, [](auto &book, u32 level) { return book.MatchLevel(level); });
+    return 0;
+}
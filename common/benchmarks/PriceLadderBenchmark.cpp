@@ -0,0 +1,194 @@
+#include "common/Logger.h"
+#include "common/MemoryPool.h"
+#include "common/Types.h"
+#include "common/benchmarks/BenchmarkUtils.h"
+#include "exchange/matcher/PriceLadder.h"
+
+#include <random>
+#include <vector>
+
+struct BenchLevel
+{
+    Price price = Price_INVALID;
+    BenchLevel *nextEntry = nullptr;
+    BenchLevel *prevEntry = nullptr;
+
+    BenchLevel(Price price) : price(price)
+    {
+    }
+};
+
+/* The sorted ring of levels the exchange book used before the ladder, kept here as the baseline. Only the ask side,
+ * lowest price first */
+class LegacyLevelList
+{
+public:
+    static constexpr u32 NUM_SLOTS = ME_PRICE_LADDER_SIZE;
+
+    LegacyLevelList()
+    {
+        mByPrice.fill(nullptr);
+    }
+
+    BenchLevel *GetBest() const
+    {
+        return mHead;
+    }
+
+    void Insert(BenchLevel *level)
+    {
+        mByPrice[level->price % NUM_SLOTS] = level;
+        if (mHead == nullptr)
+        {
+            mHead = level->prevEntry = level->nextEntry = level;
+            return;
+        }
+
+        auto target = mHead;
+        do
+        {
+            if (level->price < target->price)
+            {
+                break;
+            }
+            target = target->nextEntry;
+        } while (target != mHead);
+
+        /* Insert before target, which is the head again when the level goes at the back */
+        auto prevEntry = target->prevEntry;
+        level->prevEntry = prevEntry;
+        level->nextEntry = target;
+        prevEntry->nextEntry = level;
+        target->prevEntry = level;
+        if (target == mHead && level->price < mHead->price)
+        {
+            mHead = level;
+        }
+    }
+
+    BenchLevel *Erase(Price price)
+    {
+        auto level = mByPrice[price % NUM_SLOTS];
+        mByPrice[price % NUM_SLOTS] = nullptr;
+        if (level->nextEntry == level)
+        {
+            mHead = nullptr;
+            return level;
+        }
+
+        level->prevEntry->nextEntry = level->nextEntry;
+        level->nextEntry->prevEntry = level->prevEntry;
+        if (level == mHead)
+        {
+            mHead = level->nextEntry;
+        }
+        return level;
+    }
+
+private:
+    BenchLevel *mHead = nullptr;
+    std::array<BenchLevel *, NUM_SLOTS> mByPrice;
+};
+
+class LadderLevels
+{
+public:
+    BenchLevel *GetBest() const
+    {
+        return mLadder.GetBest();
+    }
+
+    void Insert(BenchLevel *level)
+    {
+        mLadder.Insert(level->price, level);
+    }
+
+    BenchLevel *Erase(Price price)
+    {
+        auto level = mLadder.Get(price);
+        mLadder.Erase(price);
+        return level;
+    }
+
+private:
+    Exchange::PriceLadder<BenchLevel> mLadder{Side::SELL};
+};
+
+constexpr Price BASE_PRICE = 10'000;
+
+struct LevelChange
+{
+    Price removed;
+    Price added;
+};
+
+/* Every change removes a random level and adds one at a random free price, so the book keeps its depth */
+std::vector<LevelChange> MakeChanges(u32 depth, u64 iterations, std::vector<Price> &initialPrices)
+{
+    const u32 range = 2 * depth;
+    std::vector<bool> used(range, false);
+    initialPrices.clear();
+    for (u32 i = 0; i < depth; ++i)
+    {
+        initialPrices.push_back(BASE_PRICE + 2 * i);
+        used[2 * i] = true;
+    }
+
+    std::mt19937_64 random(42);
+    auto prices = initialPrices;
+    std::vector<LevelChange> changes;
+    changes.reserve(iterations);
+    for (u64 i = 0; i < iterations; ++i)
+    {
+        auto &slot = prices[random() % prices.size()];
+        u32 offset;
+        do
+        {
+            offset = random() % range;
+        } while (used[offset]);
+
+        used[slot - BASE_PRICE] = false;
+        used[offset] = true;
+        changes.push_back({slot, BASE_PRICE + offset});
+        slot = BASE_PRICE + offset;
+    }
+    return changes;
+}
+
+template <typename Levels> void BenchmarkLevels(std::string const &name, u32 depth, u64 iterations)
+{
+    std::vector<Price> initialPrices;
+    const auto changes = MakeChanges(depth, iterations, initialPrices);
+
+    MemoryPool<BenchLevel> pool(depth + 1);
+    Levels levels;
+    for (auto price : initialPrices)
+    {
+        levels.Insert(pool.Allocate(price));
+    }
+
+    Price checksum = 0;
+    const auto nanos = MeasureNanos([&] {
+        for (auto const &change : changes)
+        {
+            pool.Deallocate(levels.Erase(change.removed));
+            levels.Insert(pool.Allocate(change.added));
+            checksum += levels.GetBest()->price;
+        }
+    });
+    DoNotOptimize(checksum);
+
+    ReportBenchmark(name + " depth " + std::to_string(depth) + " remove + add + best", iterations, nanos);
+}
+
+int main(int argc, char **argv)
+{
+    const auto iterations = GetBenchmarkIterations(argc, argv, 1'000'000);
+
+    for (u32 depth : {10, 100, 1000})
+    {
+        BenchmarkLevels<LegacyLevelList>("list", depth, iterations);
+        BenchmarkLevels<LadderLevels>("ladder", depth, iterations);
+    }
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include "common/Logger.h"
+#include "common/SafeQueue.h"
+#include "common/ThreadUtils.h"
+#include "common/Types.h"
+#include "common/benchmarks/BenchmarkUtils.h"
+
+#include <atomic>
+#include <cassert>
+#include <vector>
+
+/* The queue as it was before the SPSC rewrite, kept here as the baseline to compare against */
+template <typename T> class LegacySafeQueue
+{
+public:
+    LegacySafeQueue(std::size_t numElements) : store(numElements, T())
+    {
+    }
+
+    T *GetNextWriteTo()
+    {
+        return &store[nextWriteIndex];
+    }
+
+    /* It cannot tell full from empty, so it never fills up completely */
+    T *TryGetNextWriteTo()
+    {
+        return numElements >= store.size() - 1 ? nullptr : GetNextWriteTo();
+    }
+
+    void UpdateWriteIndex()
+    {
+        nextWriteIndex = (nextWriteIndex + 1) % store.size();
+        numElements++;
+    }
+
+    T *GetNextRead()
+    {
+        return (nextReadIndex == nextWriteIndex) ? nullptr : &store[nextReadIndex];
+    }
+
+    void UpdateReadIndex()
+    {
+        nextReadIndex = (nextReadIndex + 1) % store.size();
+        assert(numElements != 0);
+        numElements--;
+    }
+
+    std::size_t GetSize() const
+    {
+        return numElements;
+    }
+
+private:
+    std::vector<T> store;
+    std::atomic<std::size_t> nextWriteIndex = 0;
+    std::atomic<std::size_t> nextReadIndex = 0;
+    std::atomic<std::size_t> numElements = 0;
+};
+
+struct Message
+{
+    u64 sequence = 0;
+    u64 payload[4] = {};
+};
+
+constexpr std::size_t QUEUE_SIZE = 1024;
+
+template <typename Queue> void BenchmarkSingleThread(std::string const &name, u64 iterations)
+{
+    Queue queue(QUEUE_SIZE);
+    u64 checksum = 0;
+
+    const auto nanos = MeasureNanos([&] {
+        for (u64 i = 0; i < iterations; ++i)
+        {
+            auto nextWrite = queue.GetNextWriteTo();
+            nextWrite->sequence = i;
+            queue.UpdateWriteIndex();
+
+            auto nextRead = queue.GetNextRead();
+            checksum += nextRead->sequence;
+            queue.UpdateReadIndex();
+        }
+    });
+    DoNotOptimize(checksum);
+
+    ReportBenchmark(name + " write+read (same thread)", iterations, nanos);
+}
+
+template <typename Queue> void BenchmarkCrossCore(std::string const &name, u64 iterations)
+{
+    Queue queue(QUEUE_SIZE);
+
+    u64 checksum = 0;
+
+    auto consumeFunction = [&] {
+        u64 expected = 0;
+        while (expected < iterations)
+        {
+            auto nextRead = queue.GetNextRead();
+            if (nextRead == nullptr)
+            {
+                SpinPause();
+                continue;
+            }
+            CHECK_FATAL(nextRead->sequence == expected, "Out of order message ", nextRead->sequence, " expected ",
+                        expected);
+            checksum += nextRead->payload[0];
+            queue.UpdateReadIndex();
+            ++expected;
+        }
+    };
+
+    const auto nanos = MeasureNanos([&] {
+        auto consumer = CreateAndStartThread(GetBenchmarkCore(1), "Benchmark/Consumer", consumeFunction);
+
+        for (u64 i = 0; i < iterations; ++i)
+        {
+            /* Each queue's own full check: SafeQueue only looks at the consumer's index when its cached copy says
+               it is full */
+            auto nextWrite = queue.TryGetNextWriteTo();
+            while (nextWrite == nullptr)
+            {
+                SpinPause();
+                nextWrite = queue.TryGetNextWriteTo();
+            }
+            nextWrite->sequence = i;
+            nextWrite->payload[0] = i;
+            queue.UpdateWriteIndex();
+        }
+
+        consumer->join();
+    });
+    DoNotOptimize(checksum);
+
+    ReportBenchmark(name + " producer -> consumer (cross core)", iterations, nanos);
+}
+
+int main(int argc, char **argv)
+{
+    const auto iterations = GetBenchmarkIterations(argc, argv, 10'000'000);
+    SetThreadCore(0);
+
+    BenchmarkSingleThread<LegacySafeQueue<Message>>("LegacySafeQueue", iterations);
+    BenchmarkSingleThread<SafeQueue<Message>>("SafeQueue", iterations);
+
+    BenchmarkCrossCore<LegacySafeQueue<Message>>("LegacySafeQueue", iterations);
+    BenchmarkCrossCore<SafeQueue<Message>>("SafeQueue", iterations);
+
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "common/Logger.h"
+#include "common/Types.h"
+#include "common/benchmarks/BenchmarkUtils.h"
+#include "exchange/order_server/FIFOSequencer.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+/* A burst of numClients connections with requestsPerClient requests each, read one connection after the other like a
+ * poll pass does. Every connection's requests are in time order, the connections overlap in time */
+std::vector<std::pair<Nanos, Exchange::MEClientRequest>> MakeBurst(u32 numClients, u32 requestsPerClient)
+{
+    std::mt19937 random(42);
+    std::vector<std::pair<Nanos, Exchange::MEClientRequest>> burst;
+    for (ClientId clientId = 0; clientId < numClients; ++clientId)
+    {
+        Nanos recvTime = random() % 1000;
+        for (u32 i = 0; i < requestsPerClient; ++i)
+        {
+            recvTime += 1 + random() % 100;
+            burst.push_back({recvTime,
+                             {Exchange::ClientRequestType::NEW, clientId, static_cast<TickerId>(i % ME_MAX_TICKERS), i,
+                              Side::BUY, 100, 1}});
+        }
+    }
+    return burst;
+}
+
+void BenchmarkBurst(u32 numClients, u32 requestsPerClient, u64 iterations)
+{
+    QuickLogger logger("sequencer_benchmark.log");
+    const auto shardConfig = Exchange::ShardConfig::RoundRobin(1);
+    Exchange::MEClientRequestQueue shard(ME_MAX_PENDING_REQUESTS);
+    Exchange::FIFOSequencer sequencer({&shard}, shardConfig, &logger);
+    const auto burst = MakeBurst(numClients, requestsPerClient);
+
+    Nanos totalNanos = 0;
+    for (u64 i = 0; i < iterations; ++i)
+    {
+        totalNanos += MeasureNanos([&] {
+            for (auto const &[recvTime, request] : burst)
+            {
+                sequencer.AddClientRequest(recvTime, request);
+            }
+            sequencer.SequenceAndPublish();
+        });
+        for (auto span = shard.GetNextReadSpan(shard.GetCapacity()); !span.empty();
+             span = shard.GetNextReadSpan(shard.GetCapacity()))
+        {
+            shard.UpdateReadIndex(span.size());
+        }
+    }
+
+    ReportBenchmark("sequence " + std::to_string(numClients) + " clients x " + std::to_string(requestsPerClient) +
+                        " requests (per request)",
+                    iterations * burst.size(), totalNanos);
+}
+
+int main(int argc, char **argv)
+{
+    const auto iterations = GetBenchmarkIterations(argc, argv, 10'000);
+
+    BenchmarkBurst(1, 1, iterations * 100);
+    BenchmarkBurst(1, ME_MAX_PENDING_REQUESTS, iterations);
+    BenchmarkBurst(16, ME_MAX_PENDING_REQUESTS / 16, iterations);
+    BenchmarkBurst(ME_MAX_NUM_CLIENTS, ME_MAX_PENDING_REQUESTS / ME_MAX_NUM_CLIENTS, iterations);
+    return 0;
+}
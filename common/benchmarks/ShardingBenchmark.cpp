@@ -0,0 +1,157 @@
+#include "common/Logger.h"
+#include "common/ThreadUtils.h"
+#include "common/Types.h"
+#include "common/benchmarks/BenchmarkUtils.h"
+#include "exchange/matcher/ShardedMatchingEngine.h"
+
+#include <atomic>
+#include <random>
+#include <vector>
+
+constexpr ClientId SELLER = 1;
+constexpr ClientId BUYER = 2;
+constexpr Price BASE_PRICE = 100;
+constexpr TickerId HOT_TICKER = 0;
+
+/* Half of the flow on one ticker, the rest spread over the others */
+constexpr u32 HOT_TICKER_PERCENT = 50;
+
+enum class TickerMix
+{
+    UNIFORM,
+    SKEWED
+};
+
+/* Pairs of a resting sell and a buy that takes it out, so every ticker's book stays small. A pair is 2 requests, 4
+ * responses (two accepts, two fills) and 3 market updates (add, trade, cancel) */
+std::vector<Exchange::MEClientRequest> MakeRequests(TickerMix mix, u64 numPairs)
+{
+    std::mt19937 random(42);
+    std::vector<Exchange::MEClientRequest> requests;
+    requests.reserve(2 * numPairs);
+    for (u64 i = 0; i < numPairs; ++i)
+    {
+        TickerId tickerId = random() % ME_MAX_TICKERS;
+        if (mix == TickerMix::SKEWED)
+        {
+            tickerId = random() % 100 < HOT_TICKER_PERCENT ? HOT_TICKER : 1 + random() % (ME_MAX_TICKERS - 1);
+        }
+
+        requests.push_back({Exchange::ClientRequestType::NEW, SELLER, tickerId, i, Side::SELL, BASE_PRICE, 1});
+        requests.push_back({Exchange::ClientRequestType::NEW, BUYER, tickerId, i, Side::BUY, BASE_PRICE, 1});
+    }
+    return requests;
+}
+
+/* The benchmark thread plays the sequencer and routes the requests to the shards, another thread plays the order
+ * server and the market data publisher and drains every shard's outputs. Timed until the last response is read */
+void BenchmarkShards(std::string const &name, Exchange::ShardConfig shardConfig,
+                     std::vector<Exchange::MEClientRequest> const &requests)
+{
+    for (u32 shard = 0; shard < shardConfig.numShards; ++shard)
+    {
+        shardConfig.cores[shard] = GetBenchmarkCore(2 + shard);
+    }
+
+    Exchange::ShardedMatchingEngine engine(shardConfig);
+    auto clientRequests = engine.GetClientRequestQueues();
+    auto clientResponses = engine.GetClientResponseQueues();
+    auto marketUpdates = engine.GetMarketUpdateQueues();
+    engine.Start();
+
+    const u64 expectedResponses = 2 * requests.size();
+    std::atomic<bool> start = false;
+    u64 numResponses = 0;
+    u64 numMarketUpdates = 0;
+
+    auto drainFunction = [&]() {
+        while (!start)
+        {
+            SpinPause();
+        }
+
+        while (numResponses < expectedResponses)
+        {
+            bool idle = true;
+            for (u32 shard = 0; shard < shardConfig.numShards; ++shard)
+            {
+                auto responses = clientResponses[shard]->GetNextReadSpan(ME_MAX_CLIENT_UPDATES);
+                if (!responses.empty())
+                {
+                    numResponses += responses.size();
+                    clientResponses[shard]->UpdateReadIndex(responses.size());
+                    idle = false;
+                }
+
+                auto updates = marketUpdates[shard]->GetNextReadSpan(ME_MAX_MARKET_UPDATES);
+                if (!updates.empty())
+                {
+                    numMarketUpdates += updates.size();
+                    marketUpdates[shard]->UpdateReadIndex(updates.size());
+                    idle = false;
+                }
+            }
+            if (idle)
+            {
+                SpinPause();
+            }
+        }
+    };
+    auto drainer = CreateAndStartThread(GetBenchmarkCore(1), "Benchmark/Drainer", drainFunction);
+
+    const auto nanos = MeasureNanos([&] {
+        start = true;
+
+        for (auto const &request : requests)
+        {
+            auto queue = clientRequests[shardConfig.GetShard(request.tickerId)];
+            Exchange::MEClientRequest *slot;
+            while ((slot = queue->TryGetNextWriteTo()) == nullptr)
+            {
+                SpinPause();
+            }
+            *slot = request;
+            queue->UpdateWriteIndex();
+        }
+
+        drainer->join();
+    });
+    engine.Stop();
+
+    /* The last updates can be published after the responses the drainer stopped on */
+    for (auto queue : marketUpdates)
+    {
+        numMarketUpdates += queue->GetSize();
+    }
+    CHECK_FATAL(numResponses == expectedResponses, "Missing client responses");
+    CHECK_FATAL(numMarketUpdates == 3 * requests.size() / 2, "Missing market updates");
+    ReportBenchmark(name + ", " + std::to_string(shardConfig.numShards) + " shard(s)", requests.size(), nanos);
+}
+
+int main(int argc, char **argv)
+{
+    const auto iterations = GetBenchmarkIterations(argc, argv, 200'000);
+    SetThreadCore(0);
+
+    const auto uniform = MakeRequests(TickerMix::UNIFORM, iterations / 2);
+    const auto skewed = MakeRequests(TickerMix::SKEWED, iterations / 2);
+
+    for (u32 numShards = 1; numShards <= ME_MAX_MATCHING_SHARDS; numShards *= 2)
+    {
+        BenchmarkShards("uniform tickers", Exchange::ShardConfig::RoundRobin(numShards), uniform);
+        BenchmarkShards("skewed tickers", Exchange::ShardConfig::RoundRobin(numShards), skewed);
+
+        /* Same skewed flow with the hot ticker given a shard of its own */
+        if (numShards > 1)
+        {
+            auto isolated = Exchange::ShardConfig::RoundRobin(numShards);
+            for (TickerId tickerId = 0; tickerId < ME_MAX_TICKERS; ++tickerId)
+            {
+                isolated.tickerToShard[tickerId] = tickerId == HOT_TICKER ? 0 : 1 + (tickerId - 1) % (numShards - 1);
+            }
+            BenchmarkShards("skewed tickers, hot ticker isolated", isolated, skewed);
+        }
+    }
+
+    return 0;
+}
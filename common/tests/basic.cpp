@@ -2,14 +2,33 @@
 #include "SocketUtils.h"
 #include "common/Check.h"
 #include "common/Logger.h"
+#include "common/MPSCQueue.h"
+#include "common/MappedMemory.h"
 #include "common/MemoryPool.h"
+#include "common/OrderStore.h"
+#include "common/RingBuffer.h"
 #include "common/TCPServer.h"
 #include "common/ThreadUtils.h"
 #include "common/TimeUtils.h"
+#include "exchange/matcher/Checkpoint.h"
+#include "exchange/matcher/ClientOrderMap.h"
+#include "exchange/matcher/MatchingEngine.h"
+#include "exchange/matcher/ShardedMatchingEngine.h"
+#include "exchange/matcher/PriceLadder.h"
+#include "exchange/order_server/FIFOSequencer.h"
+#include "exchange/order_server/Journal.h"
+#include "exchange/order_server/OrderEntryFrame.h"
+#include "exchange/order_server/OrderServer.h"
 
 #include <fstream>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <iterator>
+#include <map>
+#include <random>
 #include <string>
 
 void MyFunction(int firstArgument)
@@ -65,6 +84,1362 @@ TEST(Basic, MemoryPoolExample)
     }
 }
 
+TEST(Basic, MemoryPoolFreeList)
+{
+    MemoryPool<u64> pool(4);
+
+    std::array<u64 *, 4> elems;
+    for (u64 i = 0; i < elems.size(); ++i)
+    {
+        elems[i] = pool.Allocate(i);
+        ASSERT_NE(elems[i], nullptr);
+    }
+    EXPECT_EQ(pool.GetNumAllocated(), 4u);
+    EXPECT_EQ(pool.Allocate(100u), nullptr);
+
+    /* The most recently freed block is handed out first */
+    pool.Deallocate(elems[1]);
+    pool.Deallocate(elems[3]);
+    EXPECT_EQ(pool.Allocate(7u), elems[3]);
+    EXPECT_EQ(pool.Allocate(8u), elems[1]);
+    EXPECT_EQ(*elems[1], 8u);
+    EXPECT_EQ(*elems[2], 2u);
+    EXPECT_EQ(pool.GetNumAllocated(), 4u);
+}
+
+TEST(Basic, OrderStore)
+{
+    OrderStore<OrderId> store(4);
+    OrderLevel level(Side::BUY, 100);
+
+    std::array<OrderIndex, 3> orders;
+    for (u32 i = 0; i < orders.size(); ++i)
+    {
+        orders[i] = store.Allocate({.price = 100, .priority = i, .quantity = 10 * (i + 1), .side = Side::BUY}, i);
+        store.PushBack(level, orders[i]);
+    }
+    EXPECT_EQ(level.numOrders, 3);
+    EXPECT_EQ(level.totalQuantity, 60);
+    EXPECT_EQ(level.firstOrder, orders[0]);
+    EXPECT_EQ(store.Hot(orders[0]).prevOrder, orders[2]);
+
+    store.SetQuantity(level, orders[1], 5);
+    EXPECT_EQ(level.totalQuantity, 45);
+
+    /* Taking out the first order moves the head, the ring stays closed */
+    store.Unlink(level, orders[0]);
+    store.Deallocate(orders[0]);
+    EXPECT_EQ(level.firstOrder, orders[1]);
+    EXPECT_EQ(store.Hot(orders[1]).prevOrder, orders[2]);
+    EXPECT_EQ(store.Hot(orders[2]).nextOrder, orders[1]);
+    EXPECT_EQ(level.totalQuantity, 35);
+
+    /* The slot just released is the next one handed out */
+    EXPECT_EQ(store.Allocate({}, 7), orders[0]);
+    EXPECT_EQ(store.Cold(orders[0]), 7);
+    EXPECT_NE(store.Allocate({}, 8), OrderIndex_INVALID);
+    EXPECT_EQ(store.Allocate({}, 9), OrderIndex_INVALID);
+
+    store.Unlink(level, orders[1]);
+    store.Unlink(level, orders[2]);
+    EXPECT_EQ(level.numOrders, 0);
+    EXPECT_EQ(level.totalQuantity, 0);
+    EXPECT_EQ(level.firstOrder, OrderIndex_INVALID);
+}
+
+TEST(Basic, MappedMemory)
+{
+    const auto options = MemoryOptions::LowLatency();
+
+    std::vector<u64, MappedAllocator<u64>> buffer(HUGE_PAGE_SIZE / sizeof(u64), 7, options);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(buffer.data()) % PAGE_SIZE, 0u);
+    EXPECT_EQ(buffer.back(), 7u);
+
+    MemoryPool<u64> pool(16, options);
+    EXPECT_EQ(*pool.Allocate(5u), 5u);
+
+    SafeQueue<u64> queue(16, options);
+    *queue.GetNextWriteTo() = 3;
+    queue.UpdateWriteIndex();
+    EXPECT_EQ(*queue.GetNextRead(), 3u);
+
+    /* A pinned cpu resolves CURRENT_NUMA_NODE to its own node, an unpinned cpu or an explicit node is left alone */
+    EXPECT_NE(options.ForCpu(0).numaNode, MemoryOptions::ANY_NUMA_NODE);
+    EXPECT_EQ(options.ForCpu(-1), options);
+    EXPECT_EQ(MemoryOptions{}.ForCpu(0), MemoryOptions{});
+}
+
+TEST(Basic, RingBuffer)
+{
+    RingBuffer buffer(1000);
+    EXPECT_EQ(buffer.GetCapacity(), PAGE_SIZE);
+
+    /* Leave a partial message at the end of the ring */
+    std::string filler(PAGE_SIZE - 10, 'f');
+    ASSERT_TRUE(buffer.Write(filler.data(), filler.size()));
+    buffer.UpdateReadIndex(filler.size());
+    ASSERT_TRUE(buffer.Write("0123", 4));
+
+    /* The rest of it wraps around, yet reads back in one piece */
+    const std::string rest = "456789abcdef";
+    auto space = buffer.GetWriteSpan();
+    ASSERT_EQ(space.size(), PAGE_SIZE - 4);
+    std::copy(rest.begin(), rest.end(), space.begin());
+    buffer.UpdateWriteIndex(rest.size());
+
+    auto data = buffer.GetReadSpan();
+    EXPECT_EQ(std::string(data.data(), data.size()), "0123456789abcdef");
+    buffer.UpdateReadIndex(6);
+    data = buffer.GetReadSpan();
+    EXPECT_EQ(std::string(data.data(), data.size()), "6789abcdef");
+
+    /* A write that doesn't fit leaves the buffer as it was */
+    EXPECT_FALSE(buffer.Write(filler.data(), PAGE_SIZE));
+    EXPECT_EQ(buffer.GetSize(), 10u);
+}
+
+TEST(Basic, PriceLadder)
+{
+    std::array<int, 8> levels{};
+    Exchange::PriceLadder<int> asks(Side::SELL);
+    Exchange::PriceLadder<int> bids(Side::BUY);
+
+    /* The best level is the lowest ask and the highest bid, the next one moves away from it */
+    asks.Insert(105, &levels[0]);
+    asks.Insert(101, &levels[1]);
+    asks.Insert(103, &levels[2]);
+    EXPECT_EQ(asks.GetBest(), &levels[1]);
+    EXPECT_EQ(asks.GetNext(101), &levels[2]);
+    EXPECT_EQ(asks.GetNext(103), &levels[0]);
+    EXPECT_EQ(asks.GetNext(105), nullptr);
+
+    bids.Insert(95, &levels[3]);
+    bids.Insert(99, &levels[4]);
+    EXPECT_EQ(bids.GetBest(), &levels[4]);
+    EXPECT_EQ(bids.GetNext(99), &levels[3]);
+
+    asks.Erase(101);
+    EXPECT_EQ(asks.Get(101), nullptr);
+    EXPECT_EQ(asks.GetBest(), &levels[2]);
+
+    /* Prices that leave the window move it, the levels already there stay where they are */
+    const auto recenters = asks.GetNumRecenters();
+    asks.Insert(103 + ME_PRICE_LADDER_SIZE - 1, &levels[5]);
+    EXPECT_GT(asks.GetNumRecenters(), recenters);
+    EXPECT_EQ(asks.GetBest(), &levels[2]);
+    EXPECT_EQ(asks.Get(105), &levels[0]);
+    EXPECT_EQ(asks.GetNext(105), &levels[5]);
+
+    /* Erasing every level leaves an empty ladder, even far from where it started */
+    asks.Erase(103);
+    asks.Erase(105);
+    asks.Erase(103 + ME_PRICE_LADDER_SIZE - 1);
+    EXPECT_TRUE(asks.IsEmpty());
+    asks.Insert(1, &levels[6]);
+    EXPECT_EQ(asks.GetBest(), &levels[6]);
+}
+
+TEST(Basic, ClientOrderMap)
+{
+    Exchange::ClientOrderMap map(64);
+    EXPECT_EQ(map.GetCapacity(), 128);
+
+    /* Any client order id is accepted, not only small ones */
+    map.Insert(1, 1'000'000'007, 5);
+    map.Insert(2, 1'000'000'007, 6);
+    EXPECT_EQ(map.Find(1, 1'000'000'007), 5);
+    EXPECT_EQ(map.Find(2, 1'000'000'007), 6);
+    EXPECT_EQ(map.Find(3, 1'000'000'007), OrderIndex_INVALID);
+
+    map.Insert(1, 1'000'000'007, 7);
+    EXPECT_EQ(map.Find(1, 1'000'000'007), 7);
+    EXPECT_EQ(map.GetSize(), 2);
+
+    EXPECT_TRUE(map.Erase(1, 1'000'000'007));
+    EXPECT_FALSE(map.Erase(1, 1'000'000'007));
+    EXPECT_EQ(map.Find(2, 1'000'000'007), 6);
+
+    /* Random inserts and erases at the highest load factor, checked against a std::map */
+    std::map<std::pair<ClientId, OrderId>, OrderIndex> expected;
+    expected[{2, 1'000'000'007}] = 6;
+    std::mt19937_64 random(42);
+    for (OrderIndex i = 0; i < 100'000; ++i)
+    {
+        const auto clientId = static_cast<ClientId>(random() % 4);
+        const auto clientOrderId = static_cast<OrderId>(random() % 256);
+        if (expected.size() < 64 && random() % 2 == 0)
+        {
+            map.Insert(clientId, clientOrderId, i);
+            expected[{clientId, clientOrderId}] = i;
+        }
+        else
+        {
+            EXPECT_EQ(map.Erase(clientId, clientOrderId), expected.erase({clientId, clientOrderId}) == 1);
+        }
+    }
+    EXPECT_EQ(map.GetSize(), expected.size());
+    for (auto const &[key, orderIndex] : expected)
+    {
+        EXPECT_EQ(map.Find(key.first, key.second), orderIndex);
+    }
+}
+
+/* A matching engine fed by hand, with everything the last request produced */
+struct TestMatchingEngine
+{
+    Exchange::MEClientRequestQueue requestQueue{ME_MAX_CLIENT_UPDATES};
+    Exchange::MEClientResponseQueue responseQueue{ME_MAX_CLIENT_UPDATES};
+    Exchange::MEMarketUpdateQueue marketUpdateQueue{ME_MAX_MARKET_UPDATES};
+    Exchange::MatchingEngine engine{&requestQueue, &responseQueue, &marketUpdateQueue};
+
+    std::vector<std::string> responses;
+    std::vector<std::string> marketUpdates;
+
+    void Process(Exchange::MEClientRequest request)
+    {
+        engine.ProcessClientRequest(&request);
+        responses = Drain(responseQueue);
+        marketUpdates = Drain(marketUpdateQueue);
+    }
+
+    template <typename T> static std::vector<std::string> Drain(SafeQueue<T> &queue)
+    {
+        std::vector<std::string> outputs;
+        for (auto span = queue.GetNextReadSpan(queue.GetCapacity()); !span.empty();
+             span = queue.GetNextReadSpan(queue.GetCapacity()))
+        {
+            for (auto const &output : span)
+            {
+                outputs.push_back(output.ToString());
+            }
+            queue.UpdateReadIndex(span.size());
+        }
+        return outputs;
+    }
+};
+
+/* Compared as strings, so a mismatch shows every field */
+template <typename T> std::vector<std::string> ToStrings(std::vector<T> const &outputs)
+{
+    std::vector<std::string> strings;
+    for (auto const &output : outputs)
+    {
+        strings.push_back(output.ToString());
+    }
+    return strings;
+}
+
+using Responses = std::vector<Exchange::MEClientResponse>;
+using MarketUpdates = std::vector<Exchange::MEMarketUpdate>;
+
+TEST(Basic, MatchingFarPrice)
+{
+    using Exchange::ClientRequestType;
+    using Exchange::ClientResponseType;
+    using Exchange::MarketUpdateType;
+    constexpr Price FAR = 10'000 + 2 * ME_PRICE_LADDER_SIZE;
+
+    TestMatchingEngine engine;
+    engine.Process({ClientRequestType::NEW, 1, 0, 1, Side::BUY, 10'000, 10});
+
+    /* A bid that can't share the ladder with the resting one is refused without touching the book */
+    engine.Process({ClientRequestType::NEW, 2, 0, 2, Side::BUY, FAR, 10});
+    EXPECT_EQ(engine.responses, ToStrings<Exchange::MEClientResponse>(
+                                    {{ClientResponseType::INVALID, 2, 0, 2, OrderId_INVALID, Side::BUY, FAR, 0, 10}}));
+    EXPECT_TRUE(engine.marketUpdates.empty());
+
+    /* So is moving the resting bid there */
+    engine.Process({ClientRequestType::MODIFY, 1, 0, 1, Side::BUY, FAR, 10});
+    EXPECT_EQ(engine.responses,
+              ToStrings<Exchange::MEClientResponse>(
+                  {{ClientResponseType::MODIFY_REJECTED, 1, 0, 1, 0, Side::BUY, FAR, Quantity_INVALID, 10}}));
+    EXPECT_TRUE(engine.marketUpdates.empty());
+
+    /* The book carries on, with the bid where it was */
+    engine.Process({ClientRequestType::NEW, 2, 0, 3, Side::SELL, 10'000, 10});
+    EXPECT_EQ(engine.responses, ToStrings<Exchange::MEClientResponse>({
+                                    {ClientResponseType::ACCEPTED, 2, 0, 3, 1, Side::SELL, 10'000, 0, 10},
+                                    {ClientResponseType::FILLED, 2, 0, 3, 1, Side::SELL, 10'000, 10, 0},
+                                    {ClientResponseType::FILLED, 1, 0, 1, 0, Side::BUY, 10'000, 10, 0},
+                                }));
+    EXPECT_EQ(engine.marketUpdates, ToStrings<Exchange::MEMarketUpdate>({
+                                        {MarketUpdateType::TRADE, 0, 0, Side::SELL, 10'000, Priority_INVALID, 10, 2},
+                                        {MarketUpdateType::CANCEL, 0, 0, Side::BUY, 10'000, 1, 0, 3},
+                                    }));
+
+    /* An empty ladder takes any price */
+    engine.Process({ClientRequestType::NEW, 2, 0, 4, Side::BUY, FAR, 10});
+    ASSERT_EQ(engine.responses.size(), 1);
+    EXPECT_EQ(engine.responses[0], (Exchange::MEClientResponse{ClientResponseType::ACCEPTED, 2, 0, 4, 2, Side::BUY, FAR,
+                                                               0, 10})
+                                       .ToString());
+
+    /* A bid far through the asks trades all it can, it never has to rest */
+    constexpr Price FAR_LOW = 10'000 - 2 * ME_PRICE_LADDER_SIZE;
+    TestMatchingEngine crossing;
+    crossing.Process({ClientRequestType::NEW, 1, 0, 1, Side::BUY, 10'000, 10});
+    crossing.Process({ClientRequestType::NEW, 1, 0, 2, Side::SELL, 10'001, 10});
+    crossing.Process({ClientRequestType::NEW, 1, 0, 3, Side::SELL, 10'002, 10});
+    crossing.Process({ClientRequestType::NEW, 2, 0, 1, Side::BUY, FAR, 10});
+    EXPECT_EQ(crossing.responses, ToStrings<Exchange::MEClientResponse>({
+                                      {ClientResponseType::ACCEPTED, 2, 0, 1, 3, Side::BUY, FAR, 0, 10},
+                                      {ClientResponseType::FILLED, 2, 0, 1, 3, Side::BUY, 10'001, 10, 0},
+                                      {ClientResponseType::FILLED, 1, 0, 2, 1, Side::SELL, 10'001, 10, 0},
+                                  }));
+
+    /* What is left of an ask that can't share the ladder with the other asks is cancelled instead of resting */
+    crossing.Process({ClientRequestType::NEW, 2, 0, 2, Side::SELL, FAR_LOW, 15});
+    EXPECT_EQ(crossing.responses,
+              ToStrings<Exchange::MEClientResponse>({
+                  {ClientResponseType::ACCEPTED, 2, 0, 2, 4, Side::SELL, FAR_LOW, 0, 15},
+                  {ClientResponseType::FILLED, 2, 0, 2, 4, Side::SELL, 10'000, 10, 5},
+                  {ClientResponseType::FILLED, 1, 0, 1, 0, Side::BUY, 10'000, 10, 0},
+                  {ClientResponseType::CANCELED, 2, 0, 2, 4, Side::SELL, FAR_LOW, Quantity_INVALID, 5},
+              }));
+    EXPECT_EQ(crossing.marketUpdates, ToStrings<Exchange::MEMarketUpdate>({
+                                          {MarketUpdateType::TRADE, 0, 0, Side::SELL, 10'000, Priority_INVALID, 10, 6},
+                                          {MarketUpdateType::CANCEL, 0, 0, Side::BUY, 10'000, 1, 0, 7},
+                                      }));
+}
+
+TEST(Basic, MatchingFullBook)
+{
+    using Exchange::ClientRequestType;
+    using Exchange::ClientResponseType;
+    using R = Exchange::MEClientResponse;
+    constexpr Price LOW = 1'000;
+    constexpr Price HIGH = LOW + ME_MAX_PRICE_LEVELS - 1;
+
+    /* One bid on every level the book has */
+    TestMatchingEngine engine;
+    OrderId clientOrderId = 0;
+    for (Price price = LOW; price <= HIGH; ++price)
+    {
+        engine.Process({ClientRequestType::NEW, 1, 0, ++clientOrderId, Side::BUY, price, 1});
+        ASSERT_EQ(engine.responses.size(), 1);
+    }
+
+    /* A new level is refused, an order on a level already there is not */
+    engine.Process({ClientRequestType::NEW, 2, 0, 1, Side::SELL, HIGH + 1, 1});
+    EXPECT_EQ(engine.responses,
+              ToStrings<R>({{ClientResponseType::INVALID, 2, 0, 1, OrderId_INVALID, Side::SELL, HIGH + 1, 0, 1}}));
+    EXPECT_TRUE(engine.marketUpdates.empty());
+    engine.Process({ClientRequestType::NEW, 2, 0, 2, Side::BUY, LOW, 1});
+    EXPECT_EQ(engine.responses, ToStrings<R>({{ClientResponseType::ACCEPTED, 2, 0, 2, ME_MAX_PRICE_LEVELS, Side::BUY,
+                                               LOW, 0, 1}}));
+
+    /* A bid sharing its level can't move to a new one and stays where it was, the reject says so with its market id.
+     * One alone on its level can move */
+    engine.Process({ClientRequestType::MODIFY, 1, 0, 1, Side::BUY, LOW - 1, 1});
+    EXPECT_EQ(engine.responses, ToStrings<R>({{ClientResponseType::MODIFY_REJECTED, 1, 0, 1, 0, Side::BUY, LOW - 1,
+                                               Quantity_INVALID, 1}}));
+    EXPECT_TRUE(engine.marketUpdates.empty());
+    engine.Process({ClientRequestType::CANCEL, 1, 0, 1, Side::BUY, LOW, 1});
+    EXPECT_EQ(engine.responses[0], (R{ClientResponseType::CANCELED, 1, 0, 1, 0, Side::BUY, LOW, Quantity_INVALID,
+                                      Quantity_INVALID})
+                                       .ToString());
+    engine.Process({ClientRequestType::MODIFY, 1, 0, 2, Side::BUY, LOW - 1, 1});
+    EXPECT_EQ(engine.responses,
+              ToStrings<R>({{ClientResponseType::MODIFIED, 1, 0, 2, 1, Side::BUY, LOW - 1, 0, 1}}));
+
+    /* Fill up the order store on an existing level, then new orders are refused whatever their price */
+    OrderId marketOrderId = ME_MAX_PRICE_LEVELS + 1;
+    for (u32 i = ME_MAX_PRICE_LEVELS; i < ME_MAX_ORDER_IDS; ++i)
+    {
+        engine.Process({ClientRequestType::NEW, 3, 0, i, Side::BUY, HIGH, 1});
+        ASSERT_EQ(engine.responses,
+                  ToStrings<R>({{ClientResponseType::ACCEPTED, 3, 0, i, marketOrderId++, Side::BUY, HIGH, 0, 1}}));
+    }
+    engine.Process({ClientRequestType::NEW, 2, 0, 3, Side::BUY, HIGH, 1});
+    EXPECT_EQ(engine.responses,
+              ToStrings<R>({{ClientResponseType::INVALID, 2, 0, 3, OrderId_INVALID, Side::BUY, HIGH, 0, 1}}));
+    EXPECT_TRUE(engine.marketUpdates.empty());
+
+    /* A move gives its own order back first, so a full store doesn't stop one to a level already there */
+    engine.Process({ClientRequestType::MODIFY, 3, 0, ME_MAX_PRICE_LEVELS, Side::BUY, LOW + 5, 1});
+    EXPECT_EQ(engine.responses, ToStrings<R>({{ClientResponseType::MODIFIED, 3, 0, ME_MAX_PRICE_LEVELS,
+                                               ME_MAX_PRICE_LEVELS + 1, Side::BUY, LOW + 5, 0, 1}}));
+
+    /* Except for an order that fills in full, it only takes orders off the book */
+    engine.Process({ClientRequestType::NEW, 4, 0, 1, Side::SELL, LOW, 1});
+    EXPECT_EQ(engine.responses, ToStrings<R>({
+                                    {ClientResponseType::ACCEPTED, 4, 0, 1, marketOrderId, Side::SELL, LOW, 0, 1},
+                                    {ClientResponseType::FILLED, 4, 0, 1, marketOrderId, Side::SELL, HIGH, 1, 0},
+                                    {ClientResponseType::FILLED, 1, 0, ME_MAX_PRICE_LEVELS, ME_MAX_PRICE_LEVELS - 1,
+                                     Side::BUY, HIGH, 1, 0},
+                                }));
+    ++marketOrderId;
+
+    /* Moves still work, and so does the book once an order is gone */
+    engine.Process({ClientRequestType::MODIFY, 1, 0, 3, Side::BUY, LOW - 2, 1});
+    EXPECT_EQ(engine.responses,
+              ToStrings<R>({{ClientResponseType::MODIFIED, 1, 0, 3, 2, Side::BUY, LOW - 2, 0, 1}}));
+    engine.Process({ClientRequestType::CANCEL, 1, 0, 4, Side::BUY, LOW + 3, 1});
+    engine.Process({ClientRequestType::NEW, 2, 0, 4, Side::BUY, HIGH, 1});
+    EXPECT_EQ(engine.responses,
+              ToStrings<R>({{ClientResponseType::ACCEPTED, 2, 0, 4, marketOrderId, Side::BUY, HIGH, 0, 1}}));
+}
+
+TEST(Basic, MatchingSweep)
+{
+    using Exchange::ClientRequestType;
+    using Exchange::ClientResponseType;
+    using Exchange::MarketUpdateType;
+    using R = Exchange::MEClientResponse;
+    using U = Exchange::MEMarketUpdate;
+
+    /* Asks of client 1: two orders at 101, then 102 and 103 */
+    TestMatchingEngine engine;
+    engine.Process({ClientRequestType::NEW, 1, 0, 1, Side::SELL, 101, 10});
+    engine.Process({ClientRequestType::NEW, 1, 0, 2, Side::SELL, 101, 5});
+    engine.Process({ClientRequestType::NEW, 1, 0, 3, Side::SELL, 102, 10});
+    engine.Process({ClientRequestType::NEW, 1, 0, 4, Side::SELL, 103, 10});
+
+    /* Fills the first order at 101 and part of the second, in the order they came */
+    engine.Process({ClientRequestType::NEW, 2, 0, 10, Side::BUY, 101, 12});
+    EXPECT_EQ(engine.responses, ToStrings<R>({
+                                    {ClientResponseType::ACCEPTED, 2, 0, 10, 4, Side::BUY, 101, 0, 12},
+                                    {ClientResponseType::FILLED, 2, 0, 10, 4, Side::BUY, 101, 10, 2},
+                                    {ClientResponseType::FILLED, 1, 0, 1, 0, Side::SELL, 101, 10, 0},
+                                    {ClientResponseType::FILLED, 2, 0, 10, 4, Side::BUY, 101, 2, 0},
+                                    {ClientResponseType::FILLED, 1, 0, 2, 1, Side::SELL, 101, 2, 3},
+                                }));
+    EXPECT_EQ(engine.marketUpdates, ToStrings<U>({
+                                        {MarketUpdateType::TRADE, 0, 0, Side::BUY, 101, Priority_INVALID, 10, 5},
+                                        {MarketUpdateType::CANCEL, 0, 0, Side::SELL, 101, 1, 0, 6},
+                                        {MarketUpdateType::TRADE, 1, 0, Side::BUY, 101, Priority_INVALID, 2, 7},
+                                        {MarketUpdateType::MODIFY, 1, 0, Side::SELL, 101, 2, 3, 8},
+                                    }));
+
+    /* Sweeps what is left at 101 and all of 102, stops before 103 and rests the rest at its limit */
+    engine.Process({ClientRequestType::NEW, 2, 0, 11, Side::BUY, 102, 20});
+    EXPECT_EQ(engine.responses, ToStrings<R>({
+                                    {ClientResponseType::ACCEPTED, 2, 0, 11, 5, Side::BUY, 102, 0, 20},
+                                    {ClientResponseType::FILLED, 2, 0, 11, 5, Side::BUY, 101, 3, 17},
+                                    {ClientResponseType::FILLED, 1, 0, 2, 1, Side::SELL, 101, 3, 0},
+                                    {ClientResponseType::FILLED, 2, 0, 11, 5, Side::BUY, 102, 10, 7},
+                                    {ClientResponseType::FILLED, 1, 0, 3, 2, Side::SELL, 102, 10, 0},
+                                }));
+    EXPECT_EQ(engine.marketUpdates, ToStrings<U>({
+                                        {MarketUpdateType::TRADE, 1, 0, Side::BUY, 101, Priority_INVALID, 3, 9},
+                                        {MarketUpdateType::CANCEL, 1, 0, Side::SELL, 101, 2, 0, 10},
+                                        {MarketUpdateType::TRADE, 2, 0, Side::BUY, 102, Priority_INVALID, 10, 11},
+                                        {MarketUpdateType::CANCEL, 2, 0, Side::SELL, 102, 1, 0, 12},
+                                        {MarketUpdateType::ADD, 5, 0, Side::BUY, 102, 1, 7, 13},
+                                    }));
+
+    /* The rested bid trades at its own price, the ask at 103 is still there */
+    engine.Process({ClientRequestType::NEW, 3, 0, 20, Side::SELL, 102, 7});
+    EXPECT_EQ(engine.responses, ToStrings<R>({
+                                    {ClientResponseType::ACCEPTED, 3, 0, 20, 6, Side::SELL, 102, 0, 7},
+                                    {ClientResponseType::FILLED, 3, 0, 20, 6, Side::SELL, 102, 7, 0},
+                                    {ClientResponseType::FILLED, 2, 0, 11, 5, Side::BUY, 102, 7, 0},
+                                }));
+    engine.Process({ClientRequestType::NEW, 3, 0, 21, Side::BUY, 103, 10});
+    EXPECT_EQ(engine.marketUpdates, ToStrings<U>({
+                                        {MarketUpdateType::TRADE, 3, 0, Side::BUY, 103, Priority_INVALID, 10, 16},
+                                        {MarketUpdateType::CANCEL, 3, 0, Side::SELL, 103, 1, 0, 17},
+                                    }));
+}
+
+TEST(Basic, MatchingModify)
+{
+    using Exchange::ClientRequestType;
+    using Exchange::ClientResponseType;
+    using Exchange::MarketUpdateType;
+    using R = Exchange::MEClientResponse;
+    using U = Exchange::MEMarketUpdate;
+
+    /* Three bids of client 1 at 100 and an ask of client 2 at 105 */
+    TestMatchingEngine engine;
+    engine.Process({ClientRequestType::NEW, 1, 0, 1, Side::BUY, 100, 10});
+    engine.Process({ClientRequestType::NEW, 1, 0, 2, Side::BUY, 100, 10});
+    engine.Process({ClientRequestType::NEW, 1, 0, 3, Side::BUY, 100, 10});
+    engine.Process({ClientRequestType::NEW, 2, 0, 4, Side::SELL, 105, 5});
+
+    /* Less at the same price is changed in place */
+    engine.Process({ClientRequestType::MODIFY, 1, 0, 1, Side::BUY, 100, 4});
+    EXPECT_EQ(engine.responses, ToStrings<R>({{ClientResponseType::MODIFIED, 1, 0, 1, 0, Side::BUY, 100, 0, 4}}));
+    EXPECT_EQ(engine.marketUpdates, ToStrings<U>({{MarketUpdateType::MODIFY, 0, 0, Side::BUY, 100, 1, 4, 5}}));
+
+    /* More goes to the back of the level */
+    engine.Process({ClientRequestType::MODIFY, 1, 0, 2, Side::BUY, 100, 15});
+    EXPECT_EQ(engine.responses, ToStrings<R>({{ClientResponseType::MODIFIED, 1, 0, 2, 1, Side::BUY, 100, 0, 15}}));
+    EXPECT_EQ(engine.marketUpdates, ToStrings<U>({{MarketUpdateType::REPLACE, 1, 0, Side::BUY, 100, 4, 15, 6}}));
+
+    /* A sell fills the first bid, which kept its place, then the third one, now ahead of the second */
+    engine.Process({ClientRequestType::NEW, 3, 0, 30, Side::SELL, 100, 6});
+    EXPECT_EQ(engine.responses, ToStrings<R>({
+                                    {ClientResponseType::ACCEPTED, 3, 0, 30, 4, Side::SELL, 100, 0, 6},
+                                    {ClientResponseType::FILLED, 3, 0, 30, 4, Side::SELL, 100, 4, 2},
+                                    {ClientResponseType::FILLED, 1, 0, 1, 0, Side::BUY, 100, 4, 0},
+                                    {ClientResponseType::FILLED, 3, 0, 30, 4, Side::SELL, 100, 2, 0},
+                                    {ClientResponseType::FILLED, 1, 0, 3, 2, Side::BUY, 100, 2, 8},
+                                }));
+
+    /* A new price moves the order too */
+    engine.Process({ClientRequestType::MODIFY, 1, 0, 3, Side::BUY, 99, 8});
+    EXPECT_EQ(engine.responses, ToStrings<R>({{ClientResponseType::MODIFIED, 1, 0, 3, 2, Side::BUY, 99, 0, 8}}));
+    EXPECT_EQ(engine.marketUpdates, ToStrings<U>({{MarketUpdateType::REPLACE, 2, 0, Side::BUY, 99, 1, 8, 11}}));
+
+    /* Moved across the book it trades like a new order and rests what is left, under its market order id */
+    engine.Process({ClientRequestType::MODIFY, 1, 0, 2, Side::BUY, 105, 15});
+    EXPECT_EQ(engine.responses, ToStrings<R>({
+                                    {ClientResponseType::MODIFIED, 1, 0, 2, 1, Side::BUY, 105, 0, 15},
+                                    {ClientResponseType::FILLED, 1, 0, 2, 1, Side::BUY, 105, 5, 10},
+                                    {ClientResponseType::FILLED, 2, 0, 4, 3, Side::SELL, 105, 5, 0},
+                                }));
+    EXPECT_EQ(engine.marketUpdates, ToStrings<U>({
+                                        {MarketUpdateType::TRADE, 3, 0, Side::BUY, 105, Priority_INVALID, 5, 12},
+                                        {MarketUpdateType::CANCEL, 3, 0, Side::SELL, 105, 1, 0, 13},
+                                        {MarketUpdateType::REPLACE, 1, 0, Side::BUY, 105, 1, 10, 14},
+                                    }));
+
+    /* Unknown order ids are rejected without a market id, so the client takes the order as gone. So are other clients'
+     * orders */
+    engine.Process({ClientRequestType::MODIFY, 1, 0, 99, Side::BUY, 100, 5});
+    EXPECT_EQ(engine.responses, ToStrings<R>({{ClientResponseType::MODIFY_REJECTED, 1, 0, 99, OrderId_INVALID,
+                                               Side::BUY, 100, Quantity_INVALID, 5}}));
+    EXPECT_TRUE(engine.marketUpdates.empty());
+    engine.Process({ClientRequestType::MODIFY, 2, 0, 3, Side::BUY, 100, 5});
+    EXPECT_EQ(engine.responses, ToStrings<R>({{ClientResponseType::MODIFY_REJECTED, 2, 0, 3, OrderId_INVALID,
+                                               Side::BUY, 100, Quantity_INVALID, 5}}));
+    EXPECT_TRUE(engine.marketUpdates.empty());
+}
+
+TEST(Basic, MatchingMassCancel)
+{
+    using Exchange::ClientRequestType;
+    using Exchange::ClientResponseType;
+    using Exchange::MarketUpdateType;
+    using R = Exchange::MEClientResponse;
+    using U = Exchange::MEMarketUpdate;
+
+    /* Clients 1 and 2 on both sides of ticker 0 and on ticker 1 */
+    TestMatchingEngine engine;
+    engine.Process({ClientRequestType::NEW, 1, 0, 1, Side::BUY, 100, 10});
+    engine.Process({ClientRequestType::NEW, 1, 0, 2, Side::SELL, 110, 10});
+    engine.Process({ClientRequestType::NEW, 2, 0, 3, Side::BUY, 100, 10});
+    engine.Process({ClientRequestType::NEW, 1, 1, 4, Side::BUY, 50, 10});
+    engine.Process({ClientRequestType::NEW, 2, 1, 5, Side::SELL, 60, 10});
+
+    /* One ticker: only client 1's orders there go, newest first, with one response for the book */
+    engine.Process({ClientRequestType::MASS_CANCEL, 1, 0, OrderId_INVALID, Side::INVALID});
+    EXPECT_EQ(engine.responses,
+              ToStrings<R>({{ClientResponseType::MASS_CANCELED, 1, 0, OrderId_INVALID, OrderId_INVALID, Side::INVALID,
+                             Price_INVALID, Quantity_INVALID, Quantity_INVALID}}));
+    EXPECT_EQ(engine.marketUpdates, ToStrings<U>({
+                                        {MarketUpdateType::CANCEL, 1, 0, Side::SELL, 110, 1, 10, 4},
+                                        {MarketUpdateType::CANCEL, 0, 0, Side::BUY, 100, 1, 10, 5},
+                                    }));
+
+    /* Every ticker, as sent for a client that disconnected: client 2's orders go, one response per book */
+    engine.Process({ClientRequestType::MASS_CANCEL, 2, TickerId_INVALID, OrderId_INVALID, Side::INVALID});
+    std::vector<R> expected;
+    for (TickerId tickerId = 0; tickerId < ME_MAX_TICKERS; ++tickerId)
+    {
+        expected.push_back({ClientResponseType::MASS_CANCELED, 2, tickerId, OrderId_INVALID, OrderId_INVALID,
+                            Side::INVALID, Price_INVALID, Quantity_INVALID, Quantity_INVALID});
+    }
+    EXPECT_EQ(engine.responses, ToStrings(expected));
+    EXPECT_EQ(engine.marketUpdates, ToStrings<U>({
+                                        {MarketUpdateType::CANCEL, 2, 0, Side::BUY, 100, 2, 10, 6},
+                                        {MarketUpdateType::CANCEL, 1, 1, Side::SELL, 60, 1, 10, 3},
+                                    }));
+
+    /* Client 1's order on ticker 1 is still there */
+    engine.Process({ClientRequestType::NEW, 3, 1, 6, Side::SELL, 50, 10});
+    EXPECT_EQ(engine.marketUpdates, ToStrings<U>({
+                                        {MarketUpdateType::TRADE, 0, 1, Side::SELL, 50, Priority_INVALID, 10, 4},
+                                        {MarketUpdateType::CANCEL, 0, 1, Side::BUY, 50, 1, 0, 5},
+                                    }));
+}
+
+TEST(Basic, MatchingStopWithFullOutput)
+{
+    using Exchange::ClientRequestType;
+
+    /* Nobody reads the responses, so the engine fills their queue and waits for room until it is stopped */
+    Exchange::MEClientRequestQueue requestQueue{ME_MAX_CLIENT_UPDATES};
+    Exchange::MEClientResponseQueue responseQueue{4};
+    Exchange::MEMarketUpdateQueue marketUpdateQueue{ME_MAX_MARKET_UPDATES};
+    Exchange::MatchingEngine engine{&requestQueue, &responseQueue, &marketUpdateQueue};
+    engine.Start();
+
+    for (OrderId orderId = 1; orderId <= 8; ++orderId)
+    {
+        *requestQueue.GetNextWriteTo() = {ClientRequestType::NEW, 1, 0, orderId, Side::BUY, 100, 1};
+        requestQueue.UpdateWriteIndex();
+    }
+    while (responseQueue.GetSize() != responseQueue.GetCapacity())
+    {
+        std::this_thread::yield();
+    }
+
+    engine.Stop();
+    EXPECT_EQ(responseQueue.GetSize(), responseQueue.GetCapacity());
+}
+
+TEST(Basic, FIFOSequencerShards)
+{
+    QuickLogger logger("fifo_sequencer_test.log");
+    auto shardConfig = Exchange::ShardConfig::RoundRobin(2);
+    shardConfig.tickerToShard[3] = 0;
+
+    Exchange::MEClientRequestQueue shard0(16), shard1(16);
+    Exchange::FIFOSequencer sequencer({&shard0, &shard1}, shardConfig, &logger);
+
+    /* Each shard gets only its tickers, in receive time order */
+    const std::array<std::pair<Nanos, TickerId>, 5> received = {{{50, 1}, {10, 3}, {40, 0}, {20, 1}, {30, 2}}};
+    for (auto [recvTime, tickerId] : received)
+    {
+        Exchange::MEClientRequest request;
+        request.type = Exchange::ClientRequestType::NEW;
+        request.tickerId = tickerId;
+        request.orderId = recvTime;
+        sequencer.AddClientRequest(recvTime, request);
+    }
+    sequencer.SequenceAndPublish();
+
+    auto orderIds = [](Exchange::MEClientRequestQueue &queue) {
+        std::vector<OrderId> orderIds;
+        for (auto &request : queue.GetNextReadSpan(queue.GetCapacity()))
+        {
+            orderIds.push_back(request.orderId);
+        }
+        return orderIds;
+    };
+    EXPECT_EQ(orderIds(shard0), (std::vector<OrderId>{10, 30, 40}));
+    EXPECT_EQ(orderIds(shard1), (std::vector<OrderId>{20, 50}));
+}
+
+TEST(Basic, FIFOSequencerFullShard)
+{
+    QuickLogger logger("fifo_sequencer_test.log");
+    const auto shardConfig = Exchange::ShardConfig::RoundRobin(2);
+    Exchange::MEClientRequestQueue shard0(4), shard1(64);
+    Exchange::FIFOSequencer sequencer({&shard0, &shard1}, shardConfig, &logger);
+
+    /* Shard 0 holds a few requests only: the batch waits for its reader instead of overwriting what it hasn't read */
+    constexpr OrderId numRequests = 40;
+    for (OrderId orderId = 0; orderId < numRequests; ++orderId)
+    {
+        Exchange::MEClientRequest request;
+        request.type = Exchange::ClientRequestType::NEW;
+        request.tickerId = orderId % 2;
+        request.orderId = orderId;
+        sequencer.AddClientRequest(orderId, request);
+    }
+
+    std::vector<OrderId> readByShard0;
+    std::thread reader([&]() {
+        while (readByShard0.size() < numRequests / 2)
+        {
+            auto requests = shard0.GetNextReadSpan(shard0.GetCapacity());
+            for (auto &request : requests)
+            {
+                readByShard0.push_back(request.orderId);
+            }
+            shard0.UpdateReadIndex(requests.size());
+        }
+    });
+    sequencer.SequenceAndPublish();
+    reader.join();
+
+    std::vector<OrderId> expected0, expected1, readByShard1;
+    for (OrderId orderId = 0; orderId < numRequests; ++orderId)
+    {
+        (orderId % 2 == 0 ? expected0 : expected1).push_back(orderId);
+    }
+    for (auto &request : shard1.GetNextReadSpan(shard1.GetCapacity()))
+    {
+        readByShard1.push_back(request.orderId);
+    }
+    EXPECT_EQ(readByShard0, expected0);
+    EXPECT_EQ(readByShard1, expected1);
+}
+
+TEST(Basic, FIFOSequencerFullShardCrossing)
+{
+    using Exchange::ClientRequestType;
+    using Exchange::ClientResponseType;
+
+    QuickLogger logger("fifo_sequencer_test.log");
+    Exchange::MEClientRequestQueue requests(ME_MAX_CLIENT_UPDATES);
+    Exchange::MEClientResponseQueue responses(ME_MAX_CLIENT_UPDATES);
+    Exchange::MEMarketUpdateQueue marketUpdates(ME_MAX_MARKET_UPDATES);
+    Exchange::MatchingEngine engine(&requests, &responses, &marketUpdates);
+    engine.Start();
+
+    std::map<ClientResponseType, u32> numResponses;
+    auto drain = [&]() {
+        auto responseSpan = responses.GetNextReadSpan(responses.GetCapacity());
+        for (auto const &response : responseSpan)
+        {
+            ++numResponses[response.type];
+        }
+        responses.UpdateReadIndex(responseSpan.size());
+        marketUpdates.UpdateReadIndex(marketUpdates.GetNextReadSpan(marketUpdates.GetCapacity()).size());
+    };
+
+    /* Every other order fills the one before it, so the shard answers with more responses than its queue holds long
+     * before it has read a queue of requests. The sequencer takes them away while it waits for room */
+    Exchange::FIFOSequencer sequencer({&requests}, Exchange::ShardConfig::RoundRobin(1), &logger);
+    sequencer.waitCallback = drain;
+    constexpr u32 numOrders = 4 * ME_MAX_CLIENT_UPDATES;
+    for (OrderId orderId = 0; orderId < numOrders; ++orderId)
+    {
+        sequencer.AddClientRequest(orderId, {ClientRequestType::NEW, 1, 0, orderId,
+                                             orderId % 2 == 0 ? Side::BUY : Side::SELL, 100, 1});
+    }
+    sequencer.SequenceAndPublish();
+
+    while (numResponses[ClientResponseType::FILLED] < numOrders)
+    {
+        drain();
+    }
+    engine.Stop();
+    EXPECT_EQ(numResponses[ClientResponseType::ACCEPTED], numOrders);
+    EXPECT_EQ(numResponses[ClientResponseType::FILLED], numOrders);
+}
+
+TEST(Basic, FIFOSequencerMerge)
+{
+    QuickLogger logger("fifo_sequencer_test.log");
+    const auto shardConfig = Exchange::ShardConfig::RoundRobin(1);
+    Exchange::MEClientRequestQueue shard(ME_MAX_PENDING_REQUESTS);
+    Exchange::FIFOSequencer sequencer({&shard}, shardConfig, &logger);
+
+    auto sequenced = [&shard]() {
+        std::vector<OrderId> orderIds;
+        for (auto requests = shard.GetNextReadSpan(shard.GetCapacity()); !requests.empty();
+             requests = shard.GetNextReadSpan(shard.GetCapacity()))
+        {
+            for (auto &request : requests)
+            {
+                orderIds.push_back(request.orderId);
+            }
+            shard.UpdateReadIndex(requests.size());
+        }
+        return orderIds;
+    };
+
+    /* Interleaved runs of several clients, with ties between them, frames sharing a recv time and one client whose
+     * requests come out of order. The merge must give what a stable sort on the recv time gives */
+    std::mt19937 random(7);
+    std::vector<std::pair<Nanos, OrderId>> expected;
+    std::array<Nanos, 16> lastRecvTime{};
+    for (OrderId orderId = 0; orderId < 500; ++orderId)
+    {
+        const auto clientId = static_cast<ClientId>(random() % lastRecvTime.size());
+        auto recvTime = lastRecvTime[clientId] + static_cast<Nanos>(random() % 3);
+        if (clientId == 5)
+        {
+            recvTime = static_cast<Nanos>(random() % 1000);
+        }
+        lastRecvTime[clientId] = recvTime;
+
+        Exchange::MEClientRequest request;
+        request.type = Exchange::ClientRequestType::NEW;
+        request.clientId = clientId;
+        request.tickerId = 0;
+        request.orderId = orderId;
+        sequencer.AddClientRequest(recvTime, request);
+        expected.push_back({recvTime, orderId});
+    }
+    sequencer.SequenceAndPublish();
+
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](auto const &lhs, auto const &rhs) { return lhs.first < rhs.first; });
+    std::vector<OrderId> expectedOrderIds;
+    for (auto [recvTime, orderId] : expected)
+    {
+        expectedOrderIds.push_back(orderId);
+    }
+    EXPECT_EQ(sequenced(), expectedOrderIds);
+
+    /* A request doesn't wait longer than the bound for older ones: the batch goes out before a too recent one joins */
+    Exchange::MEClientRequest request;
+    request.type = Exchange::ClientRequestType::NEW;
+    request.tickerId = 0;
+    request.orderId = 1;
+    sequencer.AddClientRequest(1000, request);
+    request.orderId = 2;
+    sequencer.AddClientRequest(1000 + ME_SEQUENCER_MAX_WAIT_US * NANOS_TO_MICROS - 1, request);
+    EXPECT_TRUE(sequenced().empty());
+    request.orderId = 3;
+    sequencer.AddClientRequest(1000 + ME_SEQUENCER_MAX_WAIT_US * NANOS_TO_MICROS, request);
+    EXPECT_EQ(sequenced(), (std::vector<OrderId>{1, 2}));
+    sequencer.SequenceAndPublish();
+    EXPECT_EQ(sequenced(), (std::vector<OrderId>{3}));
+
+    /* Nor behind more than ME_MAX_PENDING_REQUESTS others */
+    for (u32 i = 0; i <= ME_MAX_PENDING_REQUESTS; ++i)
+    {
+        request.orderId = i;
+        sequencer.AddClientRequest(2000, request);
+    }
+    EXPECT_EQ(sequenced().size(), ME_MAX_PENDING_REQUESTS);
+    sequencer.SequenceAndPublish();
+    EXPECT_EQ(sequenced(), (std::vector<OrderId>{ME_MAX_PENDING_REQUESTS}));
+}
+
+TEST(Basic, OrderEntryFrame)
+{
+    /* The wire format: a 9 byte header, then the messages back to back */
+    EXPECT_EQ(sizeof(Exchange::OMFrameHeader), 9);
+    EXPECT_EQ(offsetof(Exchange::OMFrameHeader, numMessages), 8);
+    EXPECT_EQ(sizeof(Exchange::MEClientRequest), 30);
+    EXPECT_EQ(Exchange::GetFrameSize<Exchange::MEClientRequest>(3), 9 + 3 * 30);
+
+    std::vector<char> stream;
+    auto appendFrame = [&](u64 sequenceNumber, std::vector<Exchange::MEClientRequest> const &requests) {
+        const Exchange::OMFrameHeader header{sequenceNumber, static_cast<u8>(requests.size())};
+        auto bytes = reinterpret_cast<char const *>(&header);
+        stream.insert(stream.end(), bytes, bytes + sizeof(header));
+        bytes = reinterpret_cast<char const *>(requests.data());
+        stream.insert(stream.end(), bytes, bytes + requests.size() * sizeof(Exchange::MEClientRequest));
+    };
+
+    std::vector<Exchange::MEClientRequest> quotes;
+    for (TickerId tickerId = 0; tickerId < 3; ++tickerId)
+    {
+        quotes.push_back({Exchange::ClientRequestType::NEW, 7, tickerId, 100 + tickerId, Side::BUY, 50, 10});
+    }
+    appendFrame(1, quotes);
+    appendFrame(2, {{Exchange::ClientRequestType::CANCEL, 7, 1, 101, Side::BUY, 50, 10}});
+    const auto completeSize = stream.size();
+    /* The next frame is only partly there */
+    appendFrame(3, quotes);
+    stream.resize(stream.size() - 1);
+
+    std::vector<std::pair<u64, std::vector<OrderId>>> frames;
+    auto onFrame = [&](Exchange::OMFrameHeader const &header, std::span<Exchange::MEClientRequest const> requests) {
+        std::vector<OrderId> orderIds;
+        for (auto const &request : requests)
+        {
+            EXPECT_EQ(request.clientId, 7);
+            orderIds.push_back(request.orderId);
+        }
+        frames.emplace_back(header.sequenceNumber, orderIds);
+    };
+
+    bool malformed = true;
+    auto consumed = Exchange::ParseFrames<Exchange::MEClientRequest>(stream.data(), stream.size(), malformed, onFrame);
+    EXPECT_FALSE(malformed);
+    EXPECT_EQ(consumed, completeSize);
+    ASSERT_EQ(frames.size(), 2);
+    EXPECT_EQ(frames[0], (std::pair<u64, std::vector<OrderId>>{1, {100, 101, 102}}));
+    EXPECT_EQ(frames[1], (std::pair<u64, std::vector<OrderId>>{2, {101}}));
+
+    /* A header announcing more messages than a frame can carry stops the parse */
+    frames.clear();
+    stream.resize(completeSize);
+    appendFrame(3, quotes);
+    stream[completeSize + offsetof(Exchange::OMFrameHeader, numMessages)] = ME_MAX_FRAME_MESSAGES + 1;
+    consumed = Exchange::ParseFrames<Exchange::MEClientRequest>(stream.data(), stream.size(), malformed, onFrame);
+    EXPECT_TRUE(malformed);
+    EXPECT_EQ(consumed, completeSize);
+    EXPECT_EQ(frames.size(), 2);
+}
+
+TEST(Basic, Journal)
+{
+    const std::string directory = "journal_test";
+    std::filesystem::remove_all(directory);
+
+    auto makeRequest = [](OrderId orderId) {
+        return Exchange::MEClientRequest{Exchange::ClientRequestType::NEW, 3, static_cast<TickerId>(orderId % 4),
+                                         orderId, Side::BUY, 100 + orderId, 10};
+    };
+    auto orderIds = [](Exchange::MEClientRequestQueue &queue) {
+        std::vector<OrderId> orderIds;
+        for (auto &request : queue.GetNextReadSpan(queue.GetCapacity()))
+        {
+            orderIds.push_back(request.orderId);
+        }
+        return orderIds;
+    };
+
+    QuickLogger logger("journal_test.log");
+    const auto shardConfig = Exchange::ShardConfig::RoundRobin(2);
+    Exchange::MEClientRequestQueue shard0(256), shard1(256);
+    {
+        /* Segments of a page hold 87 records, 200 requests take three of them */
+        Exchange::Journal journal(directory, PAGE_SIZE);
+        Exchange::FIFOSequencer sequencer({&shard0, &shard1}, shardConfig, &logger, &journal);
+        journal.Start();
+        for (OrderId orderId = 0; orderId < 200; ++orderId)
+        {
+            sequencer.AddClientRequest(static_cast<Nanos>(orderId), makeRequest(orderId));
+            if (orderId % 50 == 49)
+            {
+                sequencer.SequenceAndPublish();
+            }
+        }
+        journal.Stop();
+        EXPECT_EQ(journal.GetNextSequenceNumber(), 201);
+    }
+    EXPECT_EQ(Exchange::JournalReader::ListSegments(directory).size(), 3);
+
+    /* The next run carries on after the last record */
+    {
+        Exchange::Journal journal(directory, PAGE_SIZE);
+        EXPECT_EQ(journal.GetNextSequenceNumber(), 201);
+        Exchange::FIFOSequencer sequencer({&shard0, &shard1}, shardConfig, &logger, &journal);
+        sequencer.AddClientRequest(1000, makeRequest(200));
+        sequencer.SequenceAndPublish();
+    }
+
+    Exchange::JournalReader reader(directory);
+    u64 numRecords = 0;
+    for (auto record = reader.Next(); record != nullptr; record = reader.Next())
+    {
+        EXPECT_EQ(record->sequenceNumber, numRecords + 1);
+        EXPECT_EQ(record->request.orderId, numRecords);
+        ++numRecords;
+    }
+    EXPECT_EQ(numRecords, 201);
+    EXPECT_EQ(reader.GetNextSequenceNumber(), 202);
+
+    /* Replaying sends every shard the same requests in the same order */
+    Exchange::MEClientRequestQueue replayed0(256), replayed1(256);
+    Exchange::FIFOSequencer replayer({&replayed0, &replayed1}, shardConfig, &logger);
+    Exchange::JournalReader replayReader(directory);
+    for (auto record = replayReader.Next(); record != nullptr; record = replayReader.Next())
+    {
+        EXPECT_TRUE(replayer.TryRoute(record->request));
+    }
+    EXPECT_EQ(orderIds(replayed0), orderIds(shard0));
+    EXPECT_EQ(orderIds(replayed1), orderIds(shard1));
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST(Basic, Checkpoint)
+{
+    const std::string directory = "checkpoint_test";
+    std::filesystem::remove_all(directory);
+
+    struct Engine
+    {
+        Exchange::MEClientRequestQueue requests{1024};
+        Exchange::MEClientResponseQueue responses{1024};
+        Exchange::MEMarketUpdateQueue marketUpdates{1024};
+        Exchange::MatchingEngine engine{&requests, &responses, &marketUpdates};
+
+        /* Everything the engine sent since the last call */
+        std::vector<std::string> Process(std::vector<Exchange::MEClientRequest> requestsToProcess)
+        {
+            for (auto &request : requestsToProcess)
+            {
+                engine.ProcessClientRequest(&request);
+            }
+            std::vector<std::string> outputs;
+            for (auto &response : responses.GetNextReadSpan(responses.GetCapacity()))
+            {
+                outputs.push_back(response.ToString());
+            }
+            responses.UpdateReadIndex(responses.GetSize());
+            for (auto &marketUpdate : marketUpdates.GetNextReadSpan(marketUpdates.GetCapacity()))
+            {
+                outputs.push_back(marketUpdate.ToString());
+            }
+            marketUpdates.UpdateReadIndex(marketUpdates.GetSize());
+            return outputs;
+        }
+    };
+    using Exchange::ClientRequestType;
+
+    /* Several clients on several levels of both sides of two tickers, with a modify reordering a level */
+    Engine original;
+    std::vector<Exchange::MEClientRequest> setup;
+    for (OrderId orderId = 0; orderId < 12; ++orderId)
+    {
+        const auto clientId = static_cast<ClientId>(orderId % 3);
+        const auto tickerId = static_cast<TickerId>(orderId % 2);
+        const auto side = orderId % 4 < 2 ? Side::BUY : Side::SELL;
+        const Price price = side == Side::BUY ? 100 - orderId % 3 : 110 + orderId % 3;
+        setup.push_back({ClientRequestType::NEW, clientId, tickerId, orderId, side, price, 10});
+    }
+    setup.push_back({ClientRequestType::MODIFY, 0, 0, 0, Side::BUY, 100, 5});
+    const auto setupOutputs = original.Process(setup);
+    const auto numOrderAdds = std::count_if(setupOutputs.begin(), setupOutputs.end(), [](auto const &output) {
+        return output.find("MEMarketUpdate") != std::string::npos && output.find("ADD") != std::string::npos;
+    });
+    EXPECT_GT(numOrderAdds, 0);
+
+    {
+        Exchange::CheckpointWriter writer(directory, 1, 1);
+        original.engine.SetCheckpointWriter(&writer);
+        original.Process({{ClientRequestType::CHECKPOINT, ClientId_INVALID, TickerId_INVALID, 14}});
+        writer.Stop();
+        EXPECT_EQ(writer.GetLastSequenceNumber(), 14);
+        original.engine.SetCheckpointWriter(nullptr);
+    }
+
+    Engine restored;
+    const auto path = Exchange::FindLatestCheckpoint(directory);
+    ASSERT_FALSE(path.empty());
+    const auto info = Exchange::ReadCheckpoint(path, [&](TickerId tickerId) {
+        return restored.engine.GetOrderBook(tickerId);
+    });
+    EXPECT_EQ(info.sequenceNumber, 14);
+    EXPECT_EQ(info.orders.size(), 12);
+    restored.Process({});
+
+    /* Both engines now answer the same requests the same way: fills in the same priority and market order ids, mass
+     * cancels walking the client's orders in the same order */
+    const std::vector<Exchange::MEClientRequest> followUp = {
+        {ClientRequestType::NEW, 5, 0, 100, Side::SELL, 98, 40},
+        {ClientRequestType::NEW, 5, 1, 101, Side::BUY, 112, 25},
+        {ClientRequestType::MASS_CANCEL, 1, TickerId_INVALID, OrderId_INVALID, Side::INVALID},
+        {ClientRequestType::CANCEL, 2, 1, 5},
+        {ClientRequestType::NEW, 4, 0, 102, Side::BUY, 101, 10},
+    };
+    const auto expected = original.Process(followUp);
+    EXPECT_FALSE(expected.empty());
+    EXPECT_EQ(restored.Process(followUp), expected);
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST(Basic, MarketDataReplay)
+{
+    const std::string directory = "market_data_replay_test";
+    std::filesystem::remove_all(directory);
+    QuickLogger logger("market_data_replay_test.log");
+    using Exchange::ClientRequestType;
+
+    struct Shard
+    {
+        Shard(Exchange::ShardConfig const &shardConfig, u32 shard)
+            : engine(&requests, &responses, &marketUpdates, shardConfig, shard)
+        {
+        }
+
+        Exchange::MEClientRequestQueue requests{ME_MAX_PENDING_REQUESTS};
+        Exchange::MEClientResponseQueue responses{ME_MAX_CLIENT_UPDATES};
+        Exchange::MEMarketUpdateQueue marketUpdates{ME_MAX_MARKET_UPDATES};
+        Exchange::MatchingEngine engine;
+    };
+    struct Shards
+    {
+        explicit Shards(u32 numShards) : shardConfig(Exchange::ShardConfig::RoundRobin(numShards))
+        {
+            for (u32 shard = 0; shard < numShards; ++shard)
+            {
+                shards.push_back(std::make_unique<Shard>(shardConfig, shard));
+            }
+        }
+
+        std::vector<Exchange::MEClientRequestQueue *> GetRequestQueues()
+        {
+            std::vector<Exchange::MEClientRequestQueue *> queues;
+            for (auto &shard : shards)
+            {
+                queues.push_back(&shard->requests);
+            }
+            return queues;
+        }
+
+        /* Matches the requests the shards were sent, all of a shard's before the next shard's or one of every shard in
+         * turn, and keeps the market updates of every ticker */
+        void Match(bool shardByShard)
+        {
+            for (bool pending = true; pending;)
+            {
+                pending = false;
+                for (auto &shard : shards)
+                {
+                    while (shard->requests.GetSize() != 0)
+                    {
+                        auto request = *shard->requests.GetNextRead();
+                        shard->requests.UpdateReadIndex();
+                        shard->engine.ProcessClientRequest(&request);
+                        Collect(*shard);
+                        pending = true;
+                        if (!shardByShard)
+                        {
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        void Collect(Shard &shard)
+        {
+            for (auto responses = shard.responses.GetNextReadSpan(ME_MAX_CLIENT_UPDATES); !responses.empty();
+                 responses = shard.responses.GetNextReadSpan(ME_MAX_CLIENT_UPDATES))
+            {
+                shard.responses.UpdateReadIndex(responses.size());
+            }
+            for (auto updates = shard.marketUpdates.GetNextReadSpan(ME_MAX_MARKET_UPDATES); !updates.empty();
+                 updates = shard.marketUpdates.GetNextReadSpan(ME_MAX_MARKET_UPDATES))
+            {
+                for (auto &update : updates)
+                {
+                    auto &tickerUpdates = marketUpdates[update.tickerId];
+                    EXPECT_EQ(update.tickerSequenceNumber, tickerUpdates.size() + 1);
+                    tickerUpdates.push_back(update.ToString());
+                }
+                shard.marketUpdates.UpdateReadIndex(updates.size());
+            }
+        }
+
+        Exchange::ShardConfig shardConfig;
+        std::vector<std::unique_ptr<Shard>> shards;
+        std::map<TickerId, std::vector<std::string>> marketUpdates;
+    };
+
+    /* New orders crossing each other on four tickers, with cancels and modifies of earlier ones */
+    std::mt19937 random(11);
+    std::vector<Exchange::MEClientRequest> requests;
+    for (OrderId orderId = 1; orderId <= 400; ++orderId)
+    {
+        const Price price = 95 + random() % 11;
+        const Quantity quantity = 1 + random() % 20;
+        if (!requests.empty() && random() % 4 == 0)
+        {
+            auto const &earlier = requests[random() % requests.size()];
+            requests.push_back({random() % 2 ? ClientRequestType::CANCEL : ClientRequestType::MODIFY, earlier.clientId,
+                                earlier.tickerId, earlier.orderId, earlier.side, price, quantity});
+            continue;
+        }
+        requests.push_back({ClientRequestType::NEW, static_cast<ClientId>(random() % 4),
+                            static_cast<TickerId>(random() % 4), orderId, random() % 2 ? Side::BUY : Side::SELL, price,
+                            quantity});
+    }
+
+    /* Sequenced and journaled, then matched by two shards */
+    Shards live(2);
+    {
+        Exchange::Journal journal(directory, PAGE_SIZE);
+        Exchange::FIFOSequencer sequencer(live.GetRequestQueues(), live.shardConfig, &logger, &journal);
+        journal.Start();
+        for (u32 i = 0; i < requests.size(); ++i)
+        {
+            sequencer.AddClientRequest(static_cast<Nanos>(i), requests[i]);
+        }
+        sequencer.SequenceAndPublish();
+        journal.Stop();
+    }
+    live.Match(true);
+    EXPECT_EQ(live.marketUpdates.size(), 4);
+
+    /* Replaying the journal numbers every update of a ticker the same, however the shards interleave and whatever
+     * their number */
+    for (u32 numShards : {2, 1, 3})
+    {
+        Shards replayed(numShards);
+        Exchange::FIFOSequencer replayer(replayed.GetRequestQueues(), replayed.shardConfig, &logger);
+        Exchange::JournalReader reader(directory);
+        for (auto record = reader.Next(); record != nullptr; record = reader.Next())
+        {
+            EXPECT_TRUE(replayer.TryRoute(record->request));
+        }
+        replayed.Match(false);
+        EXPECT_EQ(replayed.marketUpdates, live.marketUpdates) << numShards << " shard(s)";
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST(Basic, OrderServerIOThreads)
+{
+    QuickLogger logger("order_server_test.log");
+    const auto shardConfig = Exchange::ShardConfig::RoundRobin(2);
+    Exchange::ShardedMatchingEngine engine(shardConfig);
+    auto marketUpdates = engine.GetMarketUpdateQueues();
+    engine.Start();
+    Exchange::OrderServer orderServer(engine.GetClientRequestQueues(), shardConfig, engine.GetClientResponseQueues(),
+                                      "lo", 6971, "", 1, 2);
+    orderServer.Start();
+
+    struct Client
+    {
+        TCPSocket *socket;
+        u64 nextResponseSequenceNumber = 1;
+        std::vector<Exchange::MEClientResponse> responses;
+    };
+    auto connect = [&](ClientId clientId) {
+        auto client = std::make_unique<Client>(new TCPSocket(logger));
+        EXPECT_GE(client->socket->Connect("127.0.0.1", "lo", 6971, false), 0);
+        client->socket->recvCallback = [client = client.get(), clientId](TCPSocket *socket, Nanos) {
+            auto received = socket->recvBuffer.GetReadSpan();
+            bool malformed = false;
+            const auto consumed = Exchange::ParseFrames<Exchange::MEClientResponse>(
+                received.data(), received.size(), malformed,
+                [&](Exchange::OMFrameHeader const &header, std::span<Exchange::MEClientResponse const> responses) {
+                    EXPECT_EQ(header.sequenceNumber, client->nextResponseSequenceNumber++);
+                    client->responses.insert(client->responses.end(), responses.begin(), responses.end());
+                });
+            EXPECT_FALSE(malformed);
+            socket->recvBuffer.UpdateReadIndex(consumed);
+        };
+        return client;
+    };
+    auto send = [](Client &client, u64 sequenceNumber, Exchange::MEClientRequest const &request) {
+        Exchange::SendFrame(*client.socket, sequenceNumber, std::span<Exchange::MEClientRequest const>(&request, 1));
+        client.socket->RecvAndSend();
+    };
+    std::vector<Exchange::MEMarketUpdate> cancels;
+    auto poll = [&](std::vector<std::unique_ptr<Client>> &clients, auto done) {
+        for (u32 i = 0; i < 500 && !done(); ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            for (auto &client : clients)
+            {
+                client->socket->RecvAndSend();
+            }
+            for (auto queue : marketUpdates)
+            {
+                const auto updates = queue->GetNextReadSpan(queue->GetCapacity());
+                std::copy_if(updates.begin(), updates.end(), std::back_inserter(cancels), [](auto const &update) {
+                    return update.type == Exchange::MarketUpdateType::CANCEL;
+                });
+                queue->UpdateReadIndex(updates.size());
+            }
+        }
+    };
+
+    /* The connections land on either thread, each client gets its own responses back whichever it is */
+    constexpr u32 numClients = 16;
+    std::vector<std::unique_ptr<Client>> clients;
+    for (ClientId clientId = 0; clientId < numClients; ++clientId)
+    {
+        clients.push_back(connect(clientId));
+    }
+    for (u64 sequenceNumber = 1; sequenceNumber <= 3; ++sequenceNumber)
+    {
+        for (ClientId clientId = 0; clientId < numClients; ++clientId)
+        {
+            send(*clients[clientId], sequenceNumber,
+                 {Exchange::ClientRequestType::NEW, clientId, clientId % ME_MAX_TICKERS, sequenceNumber, Side::BUY,
+                  100 - clientId, 1});
+        }
+    }
+    auto allAnswered = [&]() {
+        return std::all_of(clients.begin(), clients.end(), [](auto &client) { return client->responses.size() == 3; });
+    };
+    poll(clients, allAnswered);
+    ASSERT_TRUE(allAnswered());
+    for (ClientId clientId = 0; clientId < numClients; ++clientId)
+    {
+        for (u64 i = 0; i < 3; ++i)
+        {
+            auto const &response = clients[clientId]->responses[i];
+            EXPECT_EQ(response.type, Exchange::ClientResponseType::ACCEPTED);
+            EXPECT_EQ(response.clientId, clientId);
+            EXPECT_EQ(response.clientOrderId, i + 1);
+        }
+    }
+
+    /* A second session for a client that is logged in is refused, whichever thread it lands on */
+    std::vector<std::unique_ptr<Client>> duplicates;
+    duplicates.push_back(connect(0));
+    send(*duplicates[0], 1, {Exchange::ClientRequestType::NEW, 0, 0, 10, Side::BUY, 90, 1});
+    poll(duplicates, [&]() { return !duplicates[0]->responses.empty(); });
+    EXPECT_TRUE(duplicates[0]->responses.empty());
+
+    /* Once the first session is gone its orders are cancelled, and only those: client 8 shares ticker 0 */
+    delete clients[0]->socket;
+    clients.erase(clients.begin());
+    poll(clients, [&]() { return cancels.size() >= 3; });
+    u32 extraPolls = 0;
+    poll(clients, [&]() { return ++extraPolls > 10; });
+    ASSERT_EQ(cancels.size(), 3);
+    for (auto const &cancel : cancels)
+    {
+        EXPECT_EQ(cancel.tickerId, 0);
+        EXPECT_EQ(cancel.side, Side::BUY);
+        EXPECT_EQ(cancel.price, 100);
+    }
+
+    /* The client can then log in again */
+    clients.insert(clients.begin(), connect(0));
+    send(*clients[0], 1, {Exchange::ClientRequestType::NEW, 0, 0, 20, Side::BUY, 90, 1});
+    poll(clients, [&]() { return !clients[0]->responses.empty(); });
+    ASSERT_EQ(clients[0]->responses.size(), 1);
+    EXPECT_EQ(clients[0]->responses[0].clientOrderId, 20);
+    EXPECT_EQ(clients[0]->nextResponseSequenceNumber, 2);
+
+    for (auto &client : clients)
+    {
+        delete client->socket;
+    }
+    delete duplicates[0]->socket;
+    orderServer.Stop();
+    engine.Stop();
+}
+
+TEST(Basic, OrderServerBurst)
+{
+    QuickLogger logger("order_server_test.log");
+    const auto shardConfig = Exchange::ShardConfig::RoundRobin(1);
+    Exchange::ShardedMatchingEngine engine(shardConfig);
+    auto marketUpdates = engine.GetMarketUpdateQueues();
+    engine.Start();
+    Exchange::OrderServer orderServer(engine.GetClientRequestQueues(), shardConfig, engine.GetClientResponseQueues(),
+                                      "lo", 6972);
+    orderServer.Start();
+
+    TCPSocket socket(logger);
+    ASSERT_GE(socket.Connect("127.0.0.1", "lo", 6972, false), 0);
+    u64 nextResponseSequenceNumber = 1;
+    u32 numFilled = 0;
+    socket.recvCallback = [&](TCPSocket *socket, Nanos) {
+        auto received = socket->recvBuffer.GetReadSpan();
+        bool malformed = false;
+        const auto consumed = Exchange::ParseFrames<Exchange::MEClientResponse>(
+            received.data(), received.size(), malformed,
+            [&](Exchange::OMFrameHeader const &header, std::span<Exchange::MEClientResponse const> responses) {
+                EXPECT_EQ(header.sequenceNumber, nextResponseSequenceNumber++);
+                numFilled += std::count_if(responses.begin(), responses.end(), [](auto const &response) {
+                    return response.type == Exchange::ClientResponseType::FILLED;
+                });
+            });
+        EXPECT_FALSE(malformed);
+        socket->recvBuffer.UpdateReadIndex(consumed);
+    };
+    auto poll = [&]() {
+        socket.RecvAndSend();
+        for (auto queue : marketUpdates)
+        {
+            queue->UpdateReadIndex(queue->GetNextReadSpan(queue->GetCapacity()).size());
+        }
+    };
+
+    /* Orders filling each other, sent far faster than they are answered: the I/O thread, the sequencer and the shard
+     * all find their output queues full while they still have more to hand over */
+    constexpr u32 numFrames = 4 * ME_MAX_CLIENT_UPDATES / ME_MAX_FRAME_MESSAGES;
+    std::array<Exchange::MEClientRequest, ME_MAX_FRAME_MESSAGES> requests;
+    OrderId orderId = 0;
+    for (u64 sequenceNumber = 1; sequenceNumber <= numFrames; ++sequenceNumber)
+    {
+        for (auto &request : requests)
+        {
+            request = {Exchange::ClientRequestType::NEW, 0, 0, orderId, orderId % 2 == 0 ? Side::BUY : Side::SELL,
+                       100, 1};
+            ++orderId;
+        }
+        Exchange::SendFrame(socket, sequenceNumber, std::span<Exchange::MEClientRequest const>(requests));
+        poll();
+    }
+
+    for (u32 i = 0; i < 5000 && numFilled < orderId; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        poll();
+    }
+    EXPECT_EQ(numFilled, orderId);
+
+    socket.Destroy();
+    orderServer.Stop();
+    engine.Stop();
+}
+
 TEST(Basic, SafeQueueExample)
 {
     struct MyStruct
@@ -102,6 +1477,174 @@ TEST(Basic, SafeQueueExample)
     ct->join();
 }
 
+TEST(Basic, SafeQueueWrapAround)
+{
+    SafeQueue<u64> queue(50);
+    EXPECT_EQ(queue.GetCapacity(), 64u);
+    EXPECT_EQ(queue.GetNextRead(), nullptr);
+
+    u64 nextRead = 0;
+    for (u64 i = 0; i < 1000; ++i)
+    {
+        *queue.GetNextWriteTo() = i;
+        queue.UpdateWriteIndex();
+
+        if (queue.GetSize() == queue.GetCapacity())
+        {
+            /* Drain the whole queue once it's full */
+            for (auto value = queue.GetNextRead(); value; value = queue.GetNextRead())
+            {
+                EXPECT_EQ(*value, nextRead++);
+                queue.UpdateReadIndex();
+            }
+            EXPECT_EQ(queue.GetSize(), 0u);
+        }
+    }
+    EXPECT_EQ(queue.GetSize(), 1000u - nextRead);
+}
+
+TEST(Basic, SafeQueueBatch)
+{
+    SafeQueue<u64> queue(16);
+
+    /* Move the indices so that the batch wraps around the end of the ring */
+    for (u64 i = 0; i < 10; ++i)
+    {
+        *queue.GetNextWriteTo() = i;
+        queue.UpdateWriteIndex();
+        queue.UpdateReadIndex(queue.GetNextReadSpan(1).size());
+    }
+
+    for (u64 i = 0; i < 12; ++i)
+    {
+        *queue.GetNextWriteTo(i) = 100 + i;
+    }
+    EXPECT_EQ(queue.GetSize(), 0u);
+    EXPECT_EQ(queue.GetNextWriteSpan(12).size(), 6u);
+
+    queue.UpdateWriteIndex(12);
+    EXPECT_EQ(queue.GetSize(), 12u);
+
+    auto firstPart = queue.GetNextReadSpan(32);
+    ASSERT_EQ(firstPart.size(), 6u);
+    EXPECT_EQ(firstPart.front(), 100u);
+    queue.UpdateReadIndex(firstPart.size());
+
+    auto secondPart = queue.GetNextReadSpan(32);
+    ASSERT_EQ(secondPart.size(), 6u);
+    EXPECT_EQ(secondPart.back(), 111u);
+    queue.UpdateReadIndex(secondPart.size());
+
+    EXPECT_TRUE(queue.GetNextReadSpan(32).empty());
+}
+
+TEST(Basic, SafeQueueBounded)
+{
+    SafeQueue<u64> queue(8);
+
+    for (u64 i = 0; i < 8; ++i)
+    {
+        auto nextWrite = queue.TryGetNextWriteTo();
+        ASSERT_NE(nextWrite, nullptr);
+        *nextWrite = i;
+        queue.UpdateWriteIndex();
+    }
+    EXPECT_EQ(queue.TryGetNextWriteTo(), nullptr);
+    EXPECT_EQ(queue.TryGetNextWriteTo(), nullptr);
+    EXPECT_EQ(queue.GetFullEvents(), 1u);
+    EXPECT_EQ(queue.GetHighWaterMark(), 8u);
+
+    queue.UpdateReadIndex(queue.GetNextReadSpan(3).size());
+    EXPECT_NE(queue.TryGetNextWriteTo(2), nullptr);
+    EXPECT_EQ(queue.TryGetNextWriteTo(3), nullptr);
+    EXPECT_EQ(queue.TryGetNextWriteTo(3), nullptr);
+    EXPECT_EQ(queue.GetFullEvents(), 2u);
+    EXPECT_EQ(queue.GetHighWaterMark(), 8u);
+}
+
+TEST(Basic, MPSCQueueExample)
+{
+    constexpr u32 numProducers = 4;
+    constexpr u64 messagesPerProducer = 1000;
+
+    struct Message
+    {
+        u32 producerId;
+        u64 sequence;
+    };
+    MPSCQueue<Message> queue(64);
+
+    auto produceFunction = [&](u32 producerId) {
+        for (u64 i = 0; i < messagesPerProducer; ++i)
+        {
+            auto nextWrite = queue.GetNextWriteTo();
+            *nextWrite = {producerId, i};
+            queue.UpdateWriteIndex(nextWrite);
+        }
+    };
+
+    std::array<u32, numProducers> producerIds = {0, 1, 2, 3};
+    std::vector<std::unique_ptr<std::thread>> producers;
+    for (u32 i = 0; i < numProducers; ++i)
+    {
+        producers.push_back(CreateAndStartThread(-1, "Producer", produceFunction, producerIds[i]));
+    }
+
+    std::array<u64, numProducers> nextExpected{};
+    for (u64 received = 0; received < numProducers * messagesPerProducer;)
+    {
+        auto nextRead = queue.GetNextRead();
+        if (nextRead == nullptr)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        /* Messages from one producer must keep their order */
+        EXPECT_EQ(nextRead->sequence, nextExpected[nextRead->producerId]++);
+        queue.UpdateReadIndex();
+        ++received;
+    }
+
+    for (auto &producer : producers)
+    {
+        producer->join();
+    }
+    EXPECT_EQ(queue.GetSize(), 0u);
+    EXPECT_EQ(queue.GetNextRead(), nullptr);
+}
+
+TEST(Basic, MPSCQueueBounded)
+{
+    MPSCQueue<u64> queue(8);
+
+    for (u64 i = 0; i < 8; ++i)
+    {
+        auto nextWrite = queue.TryGetNextWriteTo();
+        ASSERT_NE(nextWrite, nullptr);
+        *nextWrite = i;
+        queue.UpdateWriteIndex(nextWrite);
+    }
+    EXPECT_EQ(queue.TryGetNextWriteTo(), nullptr);
+    EXPECT_EQ(queue.TryGetNextWriteTo(), nullptr);
+    EXPECT_EQ(queue.GetFullEvents(), 1u);
+
+    for (u64 i = 0; i < 3; ++i)
+    {
+        ASSERT_NE(queue.GetNextRead(), nullptr);
+        queue.UpdateReadIndex();
+    }
+    for (u64 i = 0; i < 3; ++i)
+    {
+        auto nextWrite = queue.TryGetNextWriteTo();
+        ASSERT_NE(nextWrite, nullptr);
+        queue.UpdateWriteIndex(nextWrite);
+    }
+    EXPECT_EQ(queue.TryGetNextWriteTo(), nullptr);
+    EXPECT_EQ(queue.TryGetNextWriteTo(), nullptr);
+    EXPECT_EQ(queue.GetFullEvents(), 2u);
+}
+
 TEST(Basic, Time)
 {
     std::string currentTime;
@@ -110,6 +1653,38 @@ TEST(Basic, Time)
     SHOWINFO(GetCurrentNanos());
 }
 
+TEST(Basic, TSCClock)
+{
+    /* The calibrated clock stays close to the realtime clock it's anchored to. Calibrating takes longer than that */
+    TSCClock::Instance();
+    const auto systemNanos =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    EXPECT_LT(std::abs(GetCurrentNanos() - systemNanos), NANOS_TO_MILLIS);
+
+    const auto start = GetCurrentTicks();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const auto end = GetCurrentTicks();
+    const auto elapsed = TicksToDuration(end - start);
+    EXPECT_GE(elapsed, 19 * NANOS_TO_MILLIS);
+    EXPECT_LT(elapsed, 200 * NANOS_TO_MILLIS);
+    EXPECT_LE(std::abs(TicksToNanos(end) - TicksToNanos(start) - elapsed), 1);
+
+    /* Reanchoring doesn't move the clock by more than the measurement noise, and never takes it backwards */
+    const auto before = TicksToNanos(end);
+    const auto last = GetCurrentNanos();
+    TSCClock::Instance().Reanchor();
+    EXPECT_LT(std::abs(TicksToNanos(end) - before), NANOS_TO_MILLIS);
+    EXPECT_GE(GetCurrentNanos(), last);
+    for (int i = 0; i < 3; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        const auto previous = GetCurrentNanos();
+        TSCClock::Instance().Reanchor();
+        EXPECT_GE(GetCurrentNanos(), previous);
+    }
+}
+
 TEST(Basic, Logger)
 {
     {
@@ -128,6 +1703,92 @@ TEST(Basic, Logger)
     }
 }
 
+TEST(Basic, BinaryLogger)
+{
+    enum class Color : u8
+    {
+        RED = 2
+    };
+    {
+        QuickLogger logger("output.bin", {}, LogOutput::BINARY);
+        logger.LogFormat<"Order {} of {} at {} ({})\n">(42u, std::string("client"), 1.5, Color::RED);
+        logger.Log("Plain ", -7, ' ', 'x', '\n');
+    }
+
+    std::ifstream fin("output.bin", std::ios::binary);
+    ASSERT_TRUE(fin.is_open());
+    std::vector<char> contents((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    ASSERT_GE(contents.size(), LOG_FILE_MAGIC.size());
+    EXPECT_TRUE(std::equal(LOG_FILE_MAGIC.begin(), LOG_FILE_MAGIC.end(), contents.begin()));
+
+    std::ostringstream text;
+    LogRecordDecoder decoder;
+    const auto size = contents.size() - LOG_FILE_MAGIC.size();
+    EXPECT_EQ(decoder.Decode(reinterpret_cast<std::byte const *>(contents.data()) + LOG_FILE_MAGIC.size(), size, text,
+                             false),
+              size);
+    EXPECT_EQ(text.str(), "Order 42 of client at 1.5 (2)\nPlain -7 x\n");
+}
+
+TEST(Basic, LogServiceLanes)
+{
+    constexpr u32 numLines = 1000;
+    {
+        QuickLogger first("lane_first.txt");
+        QuickLogger second("lane_second.txt");
+
+        auto writeLines = [&](QuickLogger *logger) {
+            for (u32 i = 0; i < numLines; ++i)
+            {
+                logger->LogFormat<"line {}\n">(i);
+            }
+        };
+        std::array<QuickLogger *, 2> lanes = {&first, &second};
+        auto firstThread = CreateAndStartThread(-1, "FirstLane", writeLines, lanes[0]);
+        auto secondThread = CreateAndStartThread(-1, "SecondLane", writeLines, lanes[1]);
+        firstThread->join();
+        secondThread->join();
+    }
+
+    for (auto path : {"lane_first.txt", "lane_second.txt"})
+    {
+        std::ifstream fin(path);
+        std::string line;
+        u32 numRead = 0;
+        while (std::getline(fin, line))
+        {
+            EXPECT_EQ(line, "line " + std::to_string(numRead++));
+        }
+        EXPECT_EQ(numRead, numLines);
+    }
+}
+
+TEST(Basic, LogLevels)
+{
+    u32 evaluations = 0;
+    auto expensive = [&] {
+        ++evaluations;
+        return std::string("expensive");
+    };
+
+    {
+        QuickLogger logger("levels.txt");
+        logger.SetLevel(LogLevel::WARNING);
+        QLOG_INFO(logger, "Dropped {}\n", expensive());
+        QLOG_WARNING(logger, "Kept {}\n", expensive());
+        EXPECT_EQ(evaluations, 1u);
+
+        SetShowLevel(LogLevel::ERROR);
+        SHOWWARNING("Dropped ", expensive());
+        EXPECT_EQ(evaluations, 1u);
+        SetShowLevel(LogLevel::TRACE);
+    }
+
+    std::ifstream fin("levels.txt");
+    std::string contents((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(contents, "Kept expensive\n");
+}
+
 TEST(Basic, SocketUtils)
 {
     SHOWINFO(GetIFaceIP("ens160"));
@@ -138,10 +1799,11 @@ TEST(Basic, SimpleTest)
     QuickLogger logger("server.txt");
 
     auto tcpServerRecvCallback = [&](TCPSocket *socket, Nanos time) {
-        logger.Log("tcpServerRecvCallback(): socket = ", socket->socket, "; length = ", socket->nextRecvIndex,
+        auto received = socket->recvBuffer.GetReadSpan();
+        logger.Log("tcpServerRecvCallback(): socket = ", socket->socket, "; length = ", received.size(),
                    "; time = ", time, '\n');
-        std::string reply = "TCPServer received msg: " + std::string(socket->recvBuffer.data(), socket->nextRecvIndex);
-        socket->nextRecvIndex = 0;
+        std::string reply = "TCPServer received msg: " + std::string(received.data(), received.size());
+        socket->recvBuffer.UpdateReadIndex(received.size());
 
         socket->Send(reply.data(), reply.size());
     };
@@ -149,8 +1811,9 @@ TEST(Basic, SimpleTest)
     auto tcpServerRecvFinishedCallback = [&]() { logger.Log("tcpServerRecvFinishedCallback()\n"); };
 
     auto tcpClientRecvCallback = [&](TCPSocket *socket, Nanos time) {
-        std::string recvMsg = std::string(socket->recvBuffer.data(), socket->nextRecvIndex);
-        socket->nextRecvIndex = 0;
+        auto received = socket->recvBuffer.GetReadSpan();
+        std::string recvMsg = std::string(received.data(), received.size());
+        socket->recvBuffer.UpdateReadIndex(received.size());
         logger.Log("tcpClientRecvCallback(): socket = ", socket->socket, "; length = ", recvMsg.size(),
                    "; msg = ", recvMsg, '\n');
     };
@@ -200,3 +1863,203 @@ TEST(Basic, SimpleTest)
         logger.Log("~~~~~~ Iter number ", itr, "\n");
     }
 }
+
+TEST(Basic, TCPServerDisconnect)
+{
+    constexpr std::size_t BUFFER_SIZE = 64 * 1024;
+    QuickLogger logger("tcp_disconnect.txt");
+
+    TCPServer server(logger);
+    server.socketBufferSize = BUFFER_SIZE;
+    std::vector<TCPSocket *> disconnected;
+    TCPSocket *received = nullptr;
+    bool recvFinished = false;
+    server.recvCallback = [&](TCPSocket *socket, Nanos) {
+        received = socket;
+        socket->recvBuffer.Clear();
+    };
+    server.disconnectCallback = [&](TCPSocket *socket) { disconnected.push_back(socket); };
+    server.recvFinishedCallback = [&]() { recvFinished = true; };
+    server.Listen("lo", 6970);
+
+    /* Connects a client and returns the server's end of it, once the client's first byte made it there */
+    auto connect = [&](TCPSocket &client) {
+        received = nullptr;
+        client.Connect("127.0.0.1", "lo", 6970, false);
+        client.Send("x", 1);
+        client.RecvAndSend();
+        for (u32 i = 0; i < 100 && received == nullptr; ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            server.Poll();
+            server.RecvAndSend();
+        }
+        return received;
+    };
+
+    auto client = new TCPSocket(logger, {}, BUFFER_SIZE);
+    auto serverSocket = connect(*client);
+    ASSERT_NE(serverSocket, nullptr);
+    EXPECT_EQ(server.GetNumConnections(), 1);
+
+    /* Closing the client makes the server report and drop its end */
+    delete client;
+    for (u32 i = 0; i < 100 && disconnected.empty(); ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        server.Poll();
+        server.RecvAndSend();
+    }
+    ASSERT_EQ(disconnected.size(), 1);
+    EXPECT_EQ(disconnected[0], serverSocket);
+    EXPECT_EQ(server.GetNumConnections(), 0);
+    EXPECT_TRUE(recvFinished);
+
+    /* The next connection gets the closed one's socket back from the pool */
+    TCPSocket nextClient(logger, {}, BUFFER_SIZE);
+    EXPECT_EQ(connect(nextClient), serverSocket);
+    EXPECT_EQ(server.GetNumConnections(), 1);
+}
+
+TEST(Basic, TCPServerFullRecvBuffer)
+{
+    constexpr std::size_t BUFFER_SIZE = 4096;
+    QuickLogger logger("tcp_full_recv.txt");
+
+    /* The callback leaves what it is given, it is consumed later */
+    TCPServer server(logger);
+    server.socketBufferSize = BUFFER_SIZE;
+    TCPSocket *serverSocket = nullptr;
+    server.recvCallback = [&](TCPSocket *socket, Nanos) { serverSocket = socket; };
+    server.Listen("lo", 6973);
+
+    TCPSocket client(logger, {}, 4 * BUFFER_SIZE);
+    ASSERT_GE(client.Connect("127.0.0.1", "lo", 6973, false), 0);
+    const std::string sent(3 * BUFFER_SIZE, 'x');
+    client.Send(sent.data(), sent.size());
+    client.RecvAndSend();
+
+    /* The server's end fills its buffer and has more waiting in the kernel */
+    for (u32 i = 0; i < 100; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        server.Poll();
+        server.RecvAndSend();
+    }
+    ASSERT_NE(serverSocket, nullptr);
+    ASSERT_TRUE(serverSocket->recvBuffer.GetWriteSpan().empty());
+
+    /* Nothing new arrives, so there is no new event: the socket must still be read once there is room */
+    std::size_t numReceived = 0;
+    for (u32 i = 0; i < 100 && numReceived < sent.size(); ++i)
+    {
+        numReceived += serverSocket->recvBuffer.GetSize();
+        serverSocket->recvBuffer.Clear();
+        server.Poll();
+        server.RecvAndSend();
+    }
+    EXPECT_EQ(numReceived, sent.size());
+}
+
+TEST(Basic, TCPSocketPartialSend)
+{
+    QuickLogger logger("tcp_partial_send.txt");
+
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+    const int kernelBufferSize = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &kernelBufferSize, sizeof(kernelBufferSize));
+    setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &kernelBufferSize, sizeof(kernelBufferSize));
+
+    TCPSocket sender(logger, {}, 64 * 1024);
+    TCPSocket receiver(logger, {}, 64 * 1024);
+    sender.socket = fds[0];
+    receiver.socket = fds[1];
+
+    std::string received;
+    receiver.recvCallback = [&](TCPSocket *socket, Nanos) {
+        auto data = socket->recvBuffer.GetReadSpan();
+        received.append(data.data(), data.size());
+        socket->recvBuffer.UpdateReadIndex(data.size());
+    };
+
+    /* Far more than the kernel takes while nobody reads. The bytes sent in place are overwritten right after each
+     * flush, what the kernel didn't take must have been copied */
+    std::string expected;
+    std::string payload;
+    for (u32 i = 0; i < 32; ++i)
+    {
+        const u32 header = i;
+        payload.assign(1000, static_cast<char>('a' + i % 26));
+        sender.Send(&header, sizeof(header));
+        sender.SendInPlace(payload.data(), payload.size());
+        sender.Flush();
+        expected.append(reinterpret_cast<char const *>(&header), sizeof(header));
+        expected += payload;
+        payload.assign(payload.size(), 'X');
+    }
+    EXPECT_GT(sender.GetSendQueueSize(), 0u);
+    EXPECT_GT(sender.GetSendQueueHighWaterMark(), 0u);
+
+    for (u32 i = 0; i < 1000 && received.size() < expected.size(); ++i)
+    {
+        receiver.Recv();
+        sender.Flush();
+    }
+    EXPECT_EQ(received, expected);
+    EXPECT_EQ(sender.GetSendQueueSize(), 0u);
+}
+
+TEST(Basic, TCPSocketPartialSendFullRing)
+{
+    constexpr std::size_t BUFFER_SIZE = 64 * 1024;
+    QuickLogger logger("tcp_partial_send.txt");
+
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+    const int kernelBufferSize = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &kernelBufferSize, sizeof(kernelBufferSize));
+    setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &kernelBufferSize, sizeof(kernelBufferSize));
+
+    TCPSocket sender(logger, {}, BUFFER_SIZE);
+    TCPSocket receiver(logger, {}, BUFFER_SIZE);
+    sender.socket = fds[0];
+    receiver.socket = fds[1];
+
+    std::string received;
+    receiver.recvCallback = [&](TCPSocket *socket, Nanos) {
+        auto data = socket->recvBuffer.GetReadSpan();
+        received.append(data.data(), data.size());
+        socket->recvBuffer.UpdateReadIndex(data.size());
+    };
+
+    /* Copies pile up in the send ring while nobody reads, until it is more than half full */
+    std::string expected;
+    std::string chunk;
+    for (u32 i = 0; sender.GetSendQueueSize() < BUFFER_SIZE * 5 / 8; ++i)
+    {
+        chunk.assign(1000, static_cast<char>('a' + i % 26));
+        sender.Send(chunk.data(), chunk.size());
+        sender.Flush();
+        expected += chunk;
+    }
+
+    /* Bytes sent in place then only need room for themselves, what the ring holds stays where it is in the stream */
+    std::string payload(BUFFER_SIZE / 4, 'Z');
+    const u32 header = 42;
+    sender.SendInPlace(payload.data(), payload.size());
+    sender.Send(&header, sizeof(header));
+    sender.Flush();
+    expected += payload;
+    expected.append(reinterpret_cast<char const *>(&header), sizeof(header));
+    payload.assign(payload.size(), 'X');
+    EXPECT_GT(sender.GetSendQueueSize(), BUFFER_SIZE / 2);
+
+    for (u32 i = 0; i < 1000 && received.size() < expected.size(); ++i)
+    {
+        receiver.Recv();
+        sender.Flush();
+    }
+    EXPECT_EQ(received, expected);
+    EXPECT_EQ(sender.GetSendQueueSize(), 0u);
+}
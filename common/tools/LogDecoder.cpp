@@ -0,0 +1,42 @@
+#include "common/BinaryLog.h"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+/* Turns a log written with LogOutput::BINARY back into text, every line prefixed by its timestamp in nanoseconds */
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <binary log>\n";
+        return 1;
+    }
+
+    std::ifstream input(argv[1], std::ios::binary);
+    if (!input.is_open())
+    {
+        std::cerr << "Could not open " << argv[1] << '\n';
+        return 1;
+    }
+
+    std::vector<char> contents((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    if (contents.size() < LOG_FILE_MAGIC.size() ||
+        !std::equal(LOG_FILE_MAGIC.begin(), LOG_FILE_MAGIC.end(), contents.begin()))
+    {
+        std::cerr << argv[1] << " is not a binary log\n";
+        return 1;
+    }
+
+    const auto records = reinterpret_cast<std::byte const *>(contents.data()) + LOG_FILE_MAGIC.size();
+    const auto size = contents.size() - LOG_FILE_MAGIC.size();
+
+    LogRecordDecoder decoder;
+    const auto consumed = decoder.Decode(records, size, std::cout, true);
+    if (consumed != size)
+    {
+        std::cerr << "Ignored " << size - consumed << " bytes of a truncated record at the end of the log\n";
+    }
+    return 0;
+}
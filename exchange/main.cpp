@@ -3,7 +3,7 @@
 #include "Logger.h"
 #include "exchange/market_data/MarketDataPublisher.h"
 #include "exchange/matcher/MEOrderBook.h"
-#include "exchange/matcher/MatchingEngine.h"
+#include "exchange/matcher/ShardedMatchingEngine.h"
 #include "exchange/order_server/ClientRequest.h"
 #include "exchange/order_server/ClientResponse.h"
 #include "exchange/order_server/OrderServer.h"
@@ -11,7 +11,7 @@
 #include <cstdlib>
 
 QuickLogger *gLogger = nullptr;
-Exchange::MatchingEngine *gMatchingEngine = nullptr;
+Exchange::ShardedMatchingEngine *gMatchingEngine = nullptr;
 Exchange::MarketDataPublisher *gMarketDataPublisher = nullptr;
 Exchange::OrderServer *gOrderServer;
 
@@ -61,33 +61,67 @@ extern "C" void InterruptHandler(int signal)
     exit(EXIT_SUCCESS);
 }
 
-int main()
+/* A count from the command line between 1 and max, 0 when the argument isn't one */
+static u32 ParseCount(char const *argument, u32 max)
+{
+    char *end = nullptr;
+    const auto count = std::strtoul(argument, &end, 10);
+    return end != argument && *end == '\0' && count >= 1 && count <= max ? static_cast<u32>(count) : 0;
+}
+
+int main(int argc, char **argv)
 {
     signal(SIGINT, InterruptHandler);
     signal(SIGABRT, InterruptHandler);
 
-    Exchange::MEClientRequestQueue clientRequests(ME_MAX_CLIENT_UPDATES);
-    Exchange::MEClientResponseQueue clientResponses(ME_MAX_CLIENT_UPDATES);
-    Exchange::MEMarketUpdateQueue marketUpdates(ME_MAX_MARKET_UPDATES);
-    gLogger = new QuickLogger("exchange.logs");
+    LogService::SetCore(HOUSEKEEPING_CORE);
 
-    gLogger->Log("Starting the matching engine\n");
-    gMatchingEngine = new Exchange::MatchingEngine(&clientRequests, &clientResponses, &marketUpdates);
+    /* The tickers are dealt round robin to the matching threads, one unless given on the command line */
+    const u32 numMatchingShards = argc > 1 ? ParseCount(argv[1], ME_MAX_MATCHING_SHARDS) : 1;
+    /* The client connections are spread over the order server's I/O threads, one unless given after the shards */
+    const u32 numOrderEntryThreads = argc > 2 ? ParseCount(argv[2], ME_MAX_ORDER_ENTRY_THREADS) : 1;
+    if (numMatchingShards == 0 || numOrderEntryThreads == 0)
+    {
+        SHOWERROR("Usage: ", argv[0], " [matching shards, 1 to ", ME_MAX_MATCHING_SHARDS, "] [I/O threads, 1 to ",
+                  ME_MAX_ORDER_ENTRY_THREADS, "]");
+        return EXIT_FAILURE;
+    }
+    const auto shardConfig = Exchange::ShardConfig::RoundRobin(numMatchingShards);
+
+    /* Fault in the queues between the threads up front, the first orders shouldn't pay for it */
+    const auto memoryOptions = MemoryOptions::LowLatency();
+    gLogger = new QuickLogger("exchange.logs", memoryOptions);
+
+    /* A restart picks the books up from the latest checkpoint in the journal directory, the order server then replays
+       only the requests journaled after it */
+    const std::string journalDirectory = "exchange_journal";
+
+    gLogger->Log("Starting the matching engine with ", numMatchingShards, " shard(s)\n");
+    gMatchingEngine = new Exchange::ShardedMatchingEngine(shardConfig, memoryOptions);
+    const auto checkpoint = gMatchingEngine->LoadCheckpoint(journalDirectory);
+    gLogger->Log("Restored ", checkpoint.orders.size(), " order(s) from the checkpoint before journal record ",
+                 checkpoint.sequenceNumber, "\n");
+    gMatchingEngine->EnableCheckpoints(journalDirectory, checkpoint.nextMarketDataSequenceNumber);
     gMatchingEngine->Start();
 
     const std::string marketDataPublisherIface = "lo";
     const std::string snapshotPublicIp = "233.252.14.1", incrementalPublicIp = "233.252.14.3";
     const i32 snapshotPublicPort = 20000, incrementalPublicPort = 20001;
     gLogger->Log("Starting the market data publisher\n");
-    gMarketDataPublisher =
-        new Exchange::MarketDataPublisher(&marketUpdates, marketDataPublisherIface, snapshotPublicIp,
-                                          snapshotPublicPort, incrementalPublicIp, incrementalPublicPort);
+    gMarketDataPublisher = new Exchange::MarketDataPublisher(gMatchingEngine->GetMarketUpdateQueues(),
+                                                             marketDataPublisherIface, snapshotPublicIp,
+                                                             snapshotPublicPort, incrementalPublicIp,
+                                                             incrementalPublicPort);
+    gMarketDataPublisher->Restore(checkpoint.nextMarketDataSequenceNumber, checkpoint.orders);
     gMarketDataPublisher->Start();
 
     const std::string orderServerIface = "lo";
     const int orderServerPort = 12345;
-    gLogger->Log("Starting the order server\n");
-    gOrderServer = new Exchange::OrderServer(&clientRequests, &clientResponses, orderServerIface, orderServerPort);
+    gLogger->Log("Starting the order server with ", numOrderEntryThreads, " I/O thread(s)\n");
+    gOrderServer = new Exchange::OrderServer(gMatchingEngine->GetClientRequestQueues(), shardConfig,
+                                             gMatchingEngine->GetClientResponseQueues(), orderServerIface,
+                                             orderServerPort, journalDirectory, checkpoint.sequenceNumber,
+                                             numOrderEntryThreads);
     gOrderServer->Start();
 
     while (true)
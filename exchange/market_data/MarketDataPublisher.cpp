@@ -6,11 +6,11 @@
 
 namespace Exchange
 {
-MarketDataPublisher::MarketDataPublisher(MEMarketUpdateQueue *marketUpdateQueue, std::string const &iface,
-                                         std::string const &snapshotIp, i32 snapshotPort,
+MarketDataPublisher::MarketDataPublisher(std::vector<MEMarketUpdateQueue *> const &marketUpdateQueues,
+                                         std::string const &iface, std::string const &snapshotIp, i32 snapshotPort,
                                          std::string const &incrementalIp, i32 incrementalPort)
-    : mLogger("exchange_market_data_publisher.log"), mMulticastSocket(&mLogger), mMarketUpdateQueue(marketUpdateQueue),
-      mSnapshotQueue(ME_MAX_MARKET_UPDATES), mShouldStop(true)
+    : mLogger("exchange_market_data_publisher.log"), mMulticastSocket(&mLogger),
+      mMarketUpdateQueues(marketUpdateQueues), mSnapshotQueue(ME_MAX_MARKET_UPDATES), mShouldStop(true)
 {
     CHECK_FATAL(mMulticastSocket.Init(incrementalIp, iface, incrementalPort, false),
                 "Unable to initialize multicast socket");
@@ -32,35 +32,59 @@ void MarketDataPublisher::Start()
     mSnapshotSynthesizer->Start();
 }
 
+void MarketDataPublisher::Restore(u64 nextSequenceNumber, std::span<MEMarketUpdate const> orders)
+{
+    mNextSequenceNumber = nextSequenceNumber;
+    mSnapshotSynthesizer->Restore(nextSequenceNumber - 1, orders);
+}
+
 void MarketDataPublisher::Run()
 {
     while (!mShouldStop)
     {
-        while (mMarketUpdateQueue->GetSize() != 0)
+        /* The shards' updates share one stream of sequence numbers, in whatever order they are drained. Each ticker
+           is matched by a single shard, so its updates keep their order and the numbers its book gave them */
+        for (auto marketUpdateQueue : mMarketUpdateQueues)
         {
-            auto marketUpdate = mMarketUpdateQueue->GetNextRead();
-
-            mLogger.Log("Sending market update: ", marketUpdate->ToString(), "\n");
+            PublishMarketUpdates(marketUpdateQueue);
+        }
 
-            /* Send the market update */
-            mMulticastSocket.Send(&mNextSequenceNumber, sizeof(mNextSequenceNumber));
-            mMulticastSocket.Send(&marketUpdate, sizeof(MEMarketUpdate));
+        mMulticastSocket.RecvAndSend();
+    }
+}
 
-            /* Update read index for the market update queue */
-            mMarketUpdateQueue->UpdateReadIndex();
+void MarketDataPublisher::PublishMarketUpdates(MEMarketUpdateQueue *marketUpdateQueue)
+{
+    /* Drain the burst the matching engine published and forward it to the snapshot queue in one go */
+    auto marketUpdates = marketUpdateQueue->GetNextReadSpan(ME_MAX_MARKET_UPDATES);
+    for (u32 i = 0; i < marketUpdates.size(); ++i)
+    {
+        auto &marketUpdate = marketUpdates[i];
 
-            /* Also save this to the snapshot queue */
-            auto nextWrite = mSnapshotQueue.GetNextWriteTo();
-            nextWrite->sequenceNumber = mNextSequenceNumber;
-            nextWrite->marketUpdate = *marketUpdate;
+        QLOG_TRACE(mLogger, "Sending market update: {}\n", marketUpdate.ToString());
 
-            /* Update the write index */
-            mSnapshotQueue.UpdateWriteIndex();
+        /* Send the market update */
+        mMulticastSocket.Send(&mNextSequenceNumber, sizeof(mNextSequenceNumber));
+        mMulticastSocket.Send(&marketUpdate, sizeof(MEMarketUpdate));
 
-            mNextSequenceNumber++;
+        /* Also save this to the snapshot queue. The synthesizer has to see every update, so wait for it if it fell
+           behind */
+        auto nextWrite = mSnapshotQueue.TryGetNextWriteTo(i);
+        while (nextWrite == nullptr) [[unlikely]]
+        {
+            nextWrite = mSnapshotQueue.TryGetNextWriteTo(i);
         }
+        nextWrite->sequenceNumber = mNextSequenceNumber;
+        nextWrite->marketUpdate = marketUpdate;
 
-        mMulticastSocket.RecvAndSend();
+        mNextSequenceNumber++;
+    }
+
+    if (!marketUpdates.empty())
+    {
+        /* Update the read index for the market update queue and the write index for the snapshot queue */
+        marketUpdateQueue->UpdateReadIndex(marketUpdates.size());
+        mSnapshotQueue.UpdateWriteIndex(marketUpdates.size());
     }
 }
 
@@ -70,5 +94,9 @@ void MarketDataPublisher::Stop()
     mRunningThread->join();
 
     mSnapshotSynthesizer->Stop();
+
+    mLogger.Log("Snapshot queue: capacity = ", mSnapshotQueue.GetCapacity(),
+                "; high water mark = ", mSnapshotQueue.GetHighWaterMark(),
+                "; full events = ", mSnapshotQueue.GetFullEvents(), "\n");
 }
 } // namespace Exchange
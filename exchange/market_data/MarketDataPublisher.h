@@ -5,13 +5,18 @@
 #include "MarketUpdate.h"
 #include "Types.h"
 #include "exchange/market_data/SnapshotSynthesizer.h"
+#include <span>
+#include <vector>
+
 namespace Exchange
 {
 class MarketDataPublisher
 {
 public:
-    MarketDataPublisher(MEMarketUpdateQueue *marketUpdateQueue, std::string const &iface, std::string const &snapshotIp,
-                        i32 snapshotPort, std::string const &incrementalIp, i32 incrementalPort);
+    /* Takes the market update queue of every matching shard */
+    MarketDataPublisher(std::vector<MEMarketUpdateQueue *> const &marketUpdateQueues, std::string const &iface,
+                        std::string const &snapshotIp, i32 snapshotPort, std::string const &incrementalIp,
+                        i32 incrementalPort);
     ~MarketDataPublisher();
 
     MarketDataPublisher() = delete;
@@ -23,8 +28,13 @@ public:
     void Start();
     void Stop();
 
+    /* Carries on from a checkpoint: the next update published gets nextSequenceNumber and the snapshots start with the
+     * restored orders. Must come before Start */
+    void Restore(u64 nextSequenceNumber, std::span<MEMarketUpdate const> orders);
+
 private:
     void Run();
+    void PublishMarketUpdates(MEMarketUpdateQueue *marketUpdateQueue);
 
 private:
     u64 mNextSequenceNumber = 1;
@@ -32,7 +42,7 @@ private:
 
     MCastSocket mMulticastSocket;
 
-    MEMarketUpdateQueue *mMarketUpdateQueue;
+    std::vector<MEMarketUpdateQueue *> mMarketUpdateQueues;
 
     MPDMarketUpdateQueue mSnapshotQueue;
 
@@ -36,6 +36,8 @@ void SnapshotSynthesizer::AddToSnapshot(MPDMarketUpdate *marketUpdateMPD)
         CHECK_FATAL(order == nullptr, "Received: ", marketUpdate.ToString(),
                     " but order already exists: ", order->ToString(), "\n");
         orders[marketUpdate.orderId] = mMarketUpdatesPool.Allocate(marketUpdate);
+        CHECK_FATAL(orders[marketUpdate.orderId] != nullptr, "No more room in the snapshot for ",
+                    marketUpdate.ToString());
 
         break;
     }
@@ -49,6 +51,16 @@ void SnapshotSynthesizer::AddToSnapshot(MPDMarketUpdate *marketUpdateMPD)
         order->price = marketUpdate.price;
         break;
     }
+    case MarketUpdateType::REPLACE: {
+        auto order = orders[marketUpdate.orderId];
+        CHECK_FATAL(order != nullptr, "Received: ", marketUpdate.ToString(), " but order does not exist\n");
+        CHECK_FATAL(order->side == marketUpdate.side, "Expecting existing order to match new one");
+
+        order->price = marketUpdate.price;
+        order->priority = marketUpdate.priority;
+        order->quantity = marketUpdate.quantity;
+        break;
+    }
     case MarketUpdateType::CANCEL: {
         auto order = orders[marketUpdate.orderId];
         CHECK_FATAL(order != nullptr, "Received: ", marketUpdate.ToString(), " but order does not exist\n");
@@ -73,6 +85,21 @@ void SnapshotSynthesizer::AddToSnapshot(MPDMarketUpdate *marketUpdateMPD)
     mLastSequenceIncrementalNumber = marketUpdateMPD->sequenceNumber;
 }
 
+void SnapshotSynthesizer::Restore(u64 lastSequenceNumber, std::span<MEMarketUpdate const> orders)
+{
+    for (auto const &order : orders)
+    {
+        CHECK_FATAL(order.type == MarketUpdateType::ADD, "Restoring from ", order.ToString());
+        CHECK_FATAL(order.tickerId < ME_MAX_TICKERS && order.orderId < ME_MAX_ORDER_IDS, "No room in the snapshot for ",
+                    order.ToString());
+        auto &slot = mOrdersByTickers[order.tickerId][order.orderId];
+        CHECK_FATAL(slot == nullptr, "Restored order ", order.ToString(), " already exists");
+        slot = mMarketUpdatesPool.Allocate(order);
+        CHECK_FATAL(slot != nullptr, "No more room in the snapshot for ", order.ToString());
+    }
+    mLastSequenceIncrementalNumber = lastSequenceNumber;
+}
+
 void SnapshotSynthesizer::Start()
 {
     mShouldStop = false;
@@ -90,19 +117,23 @@ void SnapshotSynthesizer::Run()
 {
     while (!mShouldStop)
     {
-        while (mSnapshotQueue->GetSize() != 0)
+        auto marketUpdates = mSnapshotQueue->GetNextReadSpan(ME_MAX_MARKET_UPDATES);
+        for (auto &marketUpdate : marketUpdates)
         {
-            auto marketUpdate = mSnapshotQueue->GetNextRead();
-            mLogger.Log("Processing: ", marketUpdate->ToString(), "\n");
+            QLOG_TRACE(mLogger, "Processing: {}\n", marketUpdate.ToString());
 
-            AddToSnapshot(marketUpdate);
+            AddToSnapshot(&marketUpdate);
+        }
 
-            mSnapshotQueue->UpdateReadIndex();
+        if (!marketUpdates.empty())
+        {
+            mSnapshotQueue->UpdateReadIndex(marketUpdates.size());
         }
 
-        if (GetCurrentNanos() - mLastSnapshotTime > 60 * NANOS_TO_SECS)
+        const auto now = GetCurrentTicks();
+        if (TicksToDuration(now - mLastSnapshotTicks) > 60 * NANOS_TO_SECS)
         {
-            mLastSnapshotTime = GetCurrentNanos();
+            mLastSnapshotTicks = now;
             PublishSnapshot();
         }
     }
@@ -144,7 +175,7 @@ void SnapshotSynthesizer::PublishSnapshot()
                     marketUpdate.marketUpdate = *order;
                 }
 
-                mLogger.Log("Sending new update: ", clearMarketUpdate.ToString(), "\n");
+                QLOG_TRACE(mLogger, "Sending new update: {}\n", clearMarketUpdate.ToString());
 
                 mSnapshotSocket.Send(&marketUpdate, sizeof(marketUpdate));
                 mSnapshotSocket.RecvAndSend();
@@ -6,6 +6,7 @@
 #include "MarketUpdate.h"
 #include "MemoryPool.h"
 #include "TimeUtils.h"
+#include <span>
 #include <thread>
 
 namespace Exchange
@@ -26,6 +27,10 @@ public:
     void Start();
     void Stop();
 
+    /* Starts from the orders of a checkpoint, the first incremental update to come is lastSequenceNumber + 1. Must
+     * come before Start */
+    void Restore(u64 lastSequenceNumber, std::span<MEMarketUpdate const> orders);
+
 private:
     void Run();
 
@@ -45,7 +50,7 @@ private:
     std::array<std::array<MEMarketUpdate *, ME_MAX_ORDER_IDS>, ME_MAX_TICKERS> mOrdersByTickers;
 
     u64 mLastSequenceIncrementalNumber = 0;
-    Nanos mLastSnapshotTime = 0;
+    Ticks mLastSnapshotTicks = 0;
 
     MemoryPool<MEMarketUpdate> mMarketUpdatesPool;
 
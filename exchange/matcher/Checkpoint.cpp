@@ -0,0 +1,241 @@
+#include "Checkpoint.h"
+#include "Check.h"
+#include "ThreadUtils.h"
+#include "TimeUtils.h"
+#include "exchange/matcher/MEOrderBook.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <unistd.h>
+
+namespace
+{
+constexpr char CHECKPOINT_PREFIX[] = "checkpoint_";
+constexpr char CHECKPOINT_SUFFIX[] = ".bin";
+
+auto GetCheckpointPath(std::string const &directory, u64 sequenceNumber) -> std::string
+{
+    /* Zero padded, so the names sort like the sequence numbers */
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s%020llu%s", CHECKPOINT_PREFIX, static_cast<unsigned long long>(sequenceNumber),
+                  CHECKPOINT_SUFFIX);
+    return directory + "/" + name;
+}
+
+void WriteAll(int fd, void const *data, std::size_t size, std::string const &path)
+{
+    auto bytes = static_cast<char const *>(data);
+    while (size > 0)
+    {
+        const auto written = write(fd, bytes, size);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        CHECK_FATAL(written > 0, "Unable to write checkpoint ", path, ": ", strerror(errno));
+        bytes += written;
+        size -= static_cast<std::size_t>(written);
+    }
+}
+
+/* The headers are copied out, the packed records are used in place */
+template <typename T> T ReadHeader(char const *&cursor, char const *end, std::string const &path)
+{
+    CHECK_FATAL(static_cast<std::size_t>(end - cursor) >= sizeof(T), "Checkpoint ", path, " is truncated");
+    T header;
+    std::memcpy(&header, cursor, sizeof(T));
+    cursor += sizeof(T);
+    return header;
+}
+
+template <typename T>
+std::span<T const> ReadRecords(char const *&cursor, char const *end, u32 count, std::string const &path)
+{
+    static_assert(alignof(T) == 1, "Records are read in place, they must be packed");
+    CHECK_FATAL(static_cast<std::size_t>(end - cursor) >= count * sizeof(T), "Checkpoint ", path, " is truncated");
+    std::span<T const> records(reinterpret_cast<T const *>(cursor), count);
+    cursor += count * sizeof(T);
+    return records;
+}
+} // namespace
+
+namespace Exchange
+{
+CheckpointWriter::CheckpointWriter(std::string const &directory, u32 numShards, u64 nextMarketDataSequenceNumber)
+    : mDirectory(directory), mNumShards(numShards), mNextMarketDataSequenceNumber(nextMarketDataSequenceNumber),
+      mLogger("exchange_checkpoint.log")
+{
+    CHECK_FATAL(mNumShards > 0 && mNumShards <= ME_MAX_MATCHING_SHARDS, "Invalid number of shards ", mNumShards);
+
+    std::error_code error;
+    std::filesystem::create_directories(mDirectory, error);
+    CHECK_FATAL(!error, "Unable to create checkpoint directory ", mDirectory, ": ", error.message());
+
+    /* Room for full books, so a shard never allocates while it checkpoints */
+    const auto maxBookSize = sizeof(CheckpointBook) + ME_MAX_ORDER_IDS * sizeof(CheckpointOrder) +
+                             ME_MAX_NUM_CLIENTS * sizeof(CheckpointClient);
+    for (u32 shard = 0; shard < mNumShards; ++shard)
+    {
+        mParts[shard].data.reserve(ME_MAX_TICKERS * maxBookSize);
+    }
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    Stop();
+}
+
+void CheckpointWriter::Start()
+{
+    mShouldStop = false;
+    mRunningThread = CreateAndStartThread(HOUSEKEEPING_CORE, "Exchange/Checkpoint", [this]() { Run(); });
+    CHECK_FATAL(mRunningThread != nullptr, "Unable to start the checkpoint thread");
+}
+
+void CheckpointWriter::Stop()
+{
+    mShouldStop = true;
+    if (mRunningThread && mRunningThread->joinable())
+    {
+        mRunningThread->join();
+    }
+    mRunningThread.reset();
+
+    TryWrite();
+}
+
+std::vector<char> &CheckpointWriter::BeginShard(u32 shard)
+{
+    auto &part = mParts[shard];
+    /* Only waits when checkpoints are requested faster than they are written */
+    while (part.sequenceNumber.load(std::memory_order_acquire) != 0)
+        ;
+
+    part.data.clear();
+    return part.data;
+}
+
+void CheckpointWriter::EndShard(u32 shard, u64 sequenceNumber, u32 numBooks, u64 numMarketUpdates)
+{
+    auto &part = mParts[shard];
+    part.numBooks = numBooks;
+    part.numMarketUpdates = numMarketUpdates;
+    part.sequenceNumber.store(sequenceNumber, std::memory_order_release);
+}
+
+void CheckpointWriter::Run()
+{
+    while (!mShouldStop)
+    {
+        /* Checkpoints are minutes apart, there's no point in spinning for them */
+        if (!TryWrite())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+bool CheckpointWriter::TryWrite()
+{
+    /* A shard can't start the next checkpoint before this one is written, so the shards are all either at the same
+       checkpoint or still on their way to it */
+    CheckpointHeader header;
+    header.sequenceNumber = mParts[0].sequenceNumber.load(std::memory_order_acquire);
+    header.nextMarketDataSequenceNumber = mNextMarketDataSequenceNumber;
+    for (u32 shard = 0; shard < mNumShards; ++shard)
+    {
+        auto const &part = mParts[shard];
+        if (header.sequenceNumber == 0 || part.sequenceNumber.load(std::memory_order_acquire) != header.sequenceNumber)
+        {
+            return false;
+        }
+        header.numBooks += part.numBooks;
+        header.nextMarketDataSequenceNumber += part.numMarketUpdates;
+    }
+
+    /* Written aside and renamed, so a checkpoint file is always complete */
+    const auto start = GetCurrentNanos();
+    const auto path = GetCheckpointPath(mDirectory, header.sequenceNumber);
+    const auto temporaryPath = path + ".tmp";
+    const int fd = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CHECK_FATAL(fd >= 0, "Unable to create checkpoint ", temporaryPath, ": ", strerror(errno));
+
+    WriteAll(fd, &header, sizeof(header), temporaryPath);
+    std::size_t size = sizeof(header);
+    for (u32 shard = 0; shard < mNumShards; ++shard)
+    {
+        auto const &data = mParts[shard].data;
+        WriteAll(fd, data.data(), data.size(), temporaryPath);
+        size += data.size();
+    }
+    CHECK_FATAL(fsync(fd) == 0, "Unable to sync checkpoint ", temporaryPath, ": ", strerror(errno));
+    close(fd);
+    CHECK_FATAL(std::rename(temporaryPath.c_str(), path.c_str()) == 0, "Unable to rename checkpoint ", temporaryPath,
+                ": ", strerror(errno));
+
+    for (u32 shard = 0; shard < mNumShards; ++shard)
+    {
+        mParts[shard].sequenceNumber.store(0, std::memory_order_release);
+    }
+    mLastSequenceNumber.store(header.sequenceNumber, std::memory_order_release);
+
+    mLogger.Log("Wrote checkpoint ", path, ": ", header.numBooks, " book(s), ", size, " bytes in ",
+                GetCurrentNanos() - start, " ns\n");
+    return true;
+}
+
+std::string FindLatestCheckpoint(std::string const &directory)
+{
+    std::string latest;
+    std::error_code error;
+    for (auto const &entry : std::filesystem::directory_iterator(directory, error))
+    {
+        const auto name = entry.path().filename().string();
+        if (name.starts_with(CHECKPOINT_PREFIX) && name.ends_with(CHECKPOINT_SUFFIX))
+        {
+            latest = std::max(latest, entry.path().string());
+        }
+    }
+    return latest;
+}
+
+CheckpointInfo ReadCheckpoint(std::string const &path, std::function<MEOrderBook *(TickerId)> const &getOrderBook)
+{
+    std::ifstream file(path, std::ios::binary);
+    CHECK_FATAL(file.is_open(), "Unable to open checkpoint ", path);
+    const std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    auto cursor = data.data();
+    const auto end = data.data() + data.size();
+
+    const auto header = ReadHeader<CheckpointHeader>(cursor, end, path);
+    CHECK_FATAL(header.magic == CheckpointHeader::MAGIC, path, " is not a checkpoint");
+    CHECK_FATAL(header.version == CheckpointHeader::VERSION, "Checkpoint ", path, " has version ", header.version);
+
+    CheckpointInfo info;
+    info.sequenceNumber = header.sequenceNumber;
+    info.nextMarketDataSequenceNumber = header.nextMarketDataSequenceNumber;
+    for (u32 i = 0; i < header.numBooks; ++i)
+    {
+        const auto book = ReadHeader<CheckpointBook>(cursor, end, path);
+        const auto orders = ReadRecords<CheckpointOrder>(cursor, end, book.numOrders, path);
+        const auto clients = ReadRecords<CheckpointClient>(cursor, end, book.numClients, path);
+
+        auto orderBook = getOrderBook(book.tickerId);
+        CHECK_FATAL(orderBook != nullptr, "Checkpoint ", path, " has a book for unknown ticker ", book.tickerId);
+        orderBook->ReadCheckpoint(book, orders, clients, info.orders);
+    }
+    CHECK_FATAL(cursor == end, "Checkpoint ", path, " has ", end - cursor, " bytes after its last book");
+
+    return info;
+}
+
+} // namespace Exchange
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "Limits.h"
+#include "Logger.h"
+#include "MarketUpdate.h"
+#include "Types.h"
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Exchange
+{
+/* A checkpoint is the state of every book at one point of the sequenced request stream: the requests journaled before
+ * sequenceNumber have all been applied and none of the ones after. Restarting from it only takes the journal from
+ * sequenceNumber on.
+ * The file is a CheckpointHeader followed by every book: a CheckpointBook, its orders in price-time priority (bids from
+ * the best price down, then asks the same way) and the heads of its clients' order lists. */
+
+struct CheckpointHeader
+{
+    static constexpr u64 MAGIC = 0x54504b4348454d45ull;
+    static constexpr u32 VERSION = 2;
+
+    u64 magic = MAGIC;
+    u32 version = VERSION;
+    u32 numBooks = 0;
+    u64 sequenceNumber = 1;
+    /* The market data publisher numbers every update the shards published before the checkpoint */
+    u64 nextMarketDataSequenceNumber = 1;
+};
+
+struct CheckpointBook
+{
+    TickerId tickerId = TickerId_INVALID;
+    u32 numOrders = 0;
+    u32 numClients = 0;
+    OrderId nextMarketOrderId = 0;
+    /* The ticker's numbering of its market updates carries on from there */
+    u64 nextMarketDataSequenceNumber = 1;
+};
+
+#pragma pack(push, 1)
+
+struct CheckpointOrder
+{
+    OrderId marketOrderId = OrderId_INVALID;
+    OrderId clientOrderId = OrderId_INVALID;
+    Price price = Price_INVALID;
+    Priority priority = Priority_INVALID;
+    Quantity quantity = Quantity_INVALID;
+    ClientId clientId = ClientId_INVALID;
+    /* Position in the book's orders of the next order in the client's list, so mass cancels walk it the same way */
+    u32 nextClientOrder = NO_ORDER;
+    Side side = Side::INVALID;
+
+    static constexpr u32 NO_ORDER = ~u32(0);
+};
+
+struct CheckpointClient
+{
+    ClientId clientId = ClientId_INVALID;
+    u32 firstOrder = CheckpointOrder::NO_ORDER;
+};
+
+#pragma pack(pop)
+
+/* What a restart needs besides the books */
+struct CheckpointInfo
+{
+    u64 sequenceNumber = 1;
+    u64 nextMarketDataSequenceNumber = 1;
+    /* An ADD for every restored order, to seed the snapshot synthesizer with */
+    std::vector<MEMarketUpdate> orders;
+};
+
+/* Writes the checkpoints the matching shards produce. Each shard serializes its books into a buffer of its own when
+ * it reaches the checkpoint request, between two requests, and goes on matching. This thread writes the file once
+ * every shard has handed its part over */
+class CheckpointWriter
+{
+public:
+    CheckpointWriter(std::string const &directory, u32 numShards, u64 nextMarketDataSequenceNumber);
+    ~CheckpointWriter();
+
+    CheckpointWriter() = delete;
+    CheckpointWriter(const CheckpointWriter &) = delete;
+    CheckpointWriter(const CheckpointWriter &&) = delete;
+    CheckpointWriter &operator=(const CheckpointWriter &) = delete;
+    CheckpointWriter &operator=(const CheckpointWriter &&) = delete;
+
+    void Start();
+    /* Writes a checkpoint every shard has already handed over */
+    void Stop();
+
+    /* Called by the shard's matching thread. The buffer is free once the previous checkpoint has been written, which
+     * normally happened long before */
+    std::vector<char> &BeginShard(u32 shard);
+    /* numMarketUpdates counts every market update the shard published since the process started */
+    void EndShard(u32 shard, u64 sequenceNumber, u32 numBooks, u64 numMarketUpdates);
+
+    /* Sequence number of the last checkpoint written, 0 before the first */
+    u64 GetLastSequenceNumber() const
+    {
+        return mLastSequenceNumber.load(std::memory_order_acquire);
+    }
+
+private:
+    void Run();
+    bool TryWrite();
+
+private:
+    struct alignas(64) ShardPart
+    {
+        std::vector<char> data;
+        u32 numBooks = 0;
+        u64 numMarketUpdates = 0;
+        /* Set by the shard when data holds a checkpoint, cleared by the writer once it is written */
+        std::atomic<u64> sequenceNumber = 0;
+    };
+
+    std::string mDirectory;
+    u32 mNumShards;
+    u64 mNextMarketDataSequenceNumber;
+    std::array<ShardPart, ME_MAX_MATCHING_SHARDS> mParts;
+
+    std::atomic<u64> mLastSequenceNumber = 0;
+
+    QuickLogger mLogger;
+
+    volatile bool mShouldStop = true;
+    std::unique_ptr<std::thread> mRunningThread;
+};
+
+class MEOrderBook;
+
+/* Path of the most recent checkpoint of the directory, empty if there is none */
+std::string FindLatestCheckpoint(std::string const &directory);
+
+/* Restores every book of the checkpoint into getOrderBook(tickerId), which must be empty */
+CheckpointInfo ReadCheckpoint(std::string const &path, std::function<MEOrderBook *(TickerId)> const &getOrderBook);
+
+} // namespace Exchange
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "Check.h"
+#include "MappedMemory.h"
+#include "OrderStore.h"
+#include "Types.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace Exchange
+{
+/* Resting orders of a book by (client id, client order id).
+ * Open addressing with Robin Hood hashing: an entry that is further from its home slot than the one it meets takes
+ * that slot and the displaced entry moves on, so probe lengths stay short and even. Erasing shifts the following
+ * entries back by one instead of leaving a tombstone. Slots are 16 bytes, four per cache line, and the table is sized
+ * for the orders that can rest in the book at a load factor of at most one half, whatever ids the clients pick. */
+class ClientOrderMap
+{
+public:
+    explicit ClientOrderMap(std::size_t maxOrders, MemoryOptions const &memoryOptions = {})
+        : mSlots(std::bit_ceil(std::max<std::size_t>(2 * maxOrders, 2)), Slot(), memoryOptions),
+          mMask(mSlots.size() - 1)
+    {
+    }
+
+    ClientOrderMap() = delete;
+    ClientOrderMap(ClientOrderMap const &) = delete;
+    ClientOrderMap(ClientOrderMap &&) = delete;
+
+    ClientOrderMap &operator=(ClientOrderMap const &) = delete;
+    ClientOrderMap &operator=(ClientOrderMap &&) = delete;
+
+public:
+    /* Returns OrderIndex_INVALID when the client has no such order resting */
+    OrderIndex Find(ClientId clientId, OrderId clientOrderId) const
+    {
+        const auto position = FindPosition(clientId, clientOrderId);
+        return position == NOT_FOUND ? OrderIndex_INVALID : mSlots[position].orderIndex;
+    }
+
+    /* Like the arrays this replaces, an id that is already in use is pointed at the new order */
+    void Insert(ClientId clientId, OrderId clientOrderId, OrderIndex orderIndex)
+    {
+        Slot entry{clientOrderId, clientId, orderIndex};
+        auto position = Home(clientId, clientOrderId);
+        std::size_t distance = 0;
+        bool displaced = false;
+        while (true)
+        {
+            auto &slot = mSlots[position];
+            if (slot.IsEmpty())
+            {
+                slot = entry;
+                CHECK_FATAL(++mSize <= mSlots.size() / 2, "Client order map is over its load factor");
+                return;
+            }
+            if (!displaced && slot.clientId == clientId && slot.clientOrderId == clientOrderId)
+            {
+                slot.orderIndex = orderIndex;
+                return;
+            }
+
+            const auto slotDistance = Distance(slot, position);
+            if (slotDistance < distance)
+            {
+                std::swap(entry, slot);
+                distance = slotDistance;
+                displaced = true;
+            }
+            position = (position + 1) & mMask;
+            ++distance;
+        }
+    }
+
+    /* Returns false when there was nothing to erase */
+    bool Erase(ClientId clientId, OrderId clientOrderId)
+    {
+        auto position = FindPosition(clientId, clientOrderId);
+        if (position == NOT_FOUND)
+        {
+            return false;
+        }
+
+        /* Pull back the entries that follow until one is already in its home slot */
+        auto next = (position + 1) & mMask;
+        while (!mSlots[next].IsEmpty() && Distance(mSlots[next], next) != 0)
+        {
+            mSlots[position] = mSlots[next];
+            position = next;
+            next = (next + 1) & mMask;
+        }
+        mSlots[position] = Slot();
+        --mSize;
+        return true;
+    }
+
+    std::size_t GetSize() const
+    {
+        return mSize;
+    }
+
+    std::size_t GetCapacity() const
+    {
+        return mSlots.size();
+    }
+
+private:
+    struct alignas(16) Slot
+    {
+        OrderId clientOrderId = OrderId_INVALID;
+        ClientId clientId = ClientId_INVALID;
+        OrderIndex orderIndex = OrderIndex_INVALID;
+
+        bool IsEmpty() const
+        {
+            return orderIndex == OrderIndex_INVALID;
+        }
+    };
+    static_assert(sizeof(Slot) == 16, "Four slots per cache line");
+
+    static constexpr std::size_t NOT_FOUND = ~std::size_t(0);
+
+    /* Client order ids are usually sequential, so the key is mixed with the finalizer of MurmurHash3 */
+    std::size_t Home(ClientId clientId, OrderId clientOrderId) const
+    {
+        u64 hash = clientOrderId ^ (static_cast<u64>(clientId) * 0x9e3779b97f4a7c15ull);
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdull;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ull;
+        hash ^= hash >> 33;
+        return hash & mMask;
+    }
+
+    std::size_t Distance(Slot const &slot, std::size_t position) const
+    {
+        return (position - Home(slot.clientId, slot.clientOrderId)) & mMask;
+    }
+
+    std::size_t FindPosition(ClientId clientId, OrderId clientOrderId) const
+    {
+        auto position = Home(clientId, clientOrderId);
+        for (std::size_t distance = 0;; ++distance)
+        {
+            auto const &slot = mSlots[position];
+            /* An entry closer to its home than we are to ours means the key would have been placed before it */
+            if (slot.IsEmpty() || Distance(slot, position) < distance)
+            {
+                return NOT_FOUND;
+            }
+            if (slot.clientId == clientId && slot.clientOrderId == clientOrderId)
+            {
+                return position;
+            }
+            position = (position + 1) & mMask;
+        }
+    }
+
+private:
+    std::vector<Slot, MappedAllocator<Slot>> mSlots;
+    std::size_t mMask;
+    std::size_t mSize = 0;
+};
+
+} // namespace Exchange
@@ -1,41 +1,29 @@
 #pragma once
 
 #include "Limits.h"
+#include "OrderStore.h"
 #include "Types.h"
 
-#include <array>
 #include <sstream>
 #include <string>
 
 namespace Exchange
 {
+/* Who an order belongs to and how it's reported. Matching walks the order's HotOrder and only reads this for the orders
+ * it fills or cancels */
 struct MEOrder
 {
     TickerId tickerId = TickerId_INVALID;
     ClientId clientId = ClientId_INVALID;
     OrderId clientOrderId = OrderId_INVALID;
     OrderId marketOrderId = OrderId_INVALID;
-    Side side = Side::INVALID;
-    Price price = Price_INVALID;
-    Quantity quantity = Quantity_INVALID;
-    Priority priority = Priority_INVALID;
+    /* The orders of a client in a book form a list, so that they can all be cancelled without searching for them */
+    OrderIndex prevClientOrder = OrderIndex_INVALID;
+    OrderIndex nextClientOrder = OrderIndex_INVALID;
 
-    MEOrder *nextOrder = nullptr;
-    MEOrder *prevOrder = nullptr;
-
-    MEOrder() = default;
-    MEOrder(TickerId tickerId, ClientId clientId, OrderId clientOrderId, OrderId marketOrderId, Side side, Price price,
-            Quantity quantity, Priority priority, MEOrder *previousOrder, MEOrder *nextOrder)
-        : tickerId(tickerId), clientId(clientId), clientOrderId(clientOrderId), marketOrderId(marketOrderId),
-          side(side), price(price), quantity(quantity), priority(priority), nextOrder(nextOrder),
-          prevOrder(previousOrder)
-    {
-    }
-
-    inline auto ToString(u32 indent = 0) -> std::string
+    inline auto ToString(HotOrder const &hot, u32 indent = 0) const -> std::string
     {
         std::string indentString(indent, '\t');
-        std::string nullString = "NULL";
         std::stringstream ss;
 
         ss << indentString << "MEOrder {\n";
@@ -43,56 +31,18 @@ struct MEOrder
         ss << indentString << "\tclientId: " << ClientIdToString(clientId) << "\n";
         ss << indentString << "\tclientOrderId: " << OrderIdToString(clientOrderId) << "\n";
         ss << indentString << "\tmarketOrderId: " << OrderIdToString(marketOrderId) << "\n";
-        ss << indentString << "\tside: " << SideToString(side) << "\n";
-        ss << indentString << "\tprice: " << PriceToString(price) << "\n";
-        ss << indentString << "\tquantity: " << QuantityToString(quantity) << "\n";
-        ss << indentString << "\tpriority: " << PriorityToString(priority) << "\n";
-        ss << indentString << "\tprevOrder: " << ((prevOrder != nullptr) ? prevOrder->ToString(indent + 1) : nullString)
-           << "\n";
-        ss << indentString << "\tnextOrder: " << ((nextOrder != nullptr) ? nextOrder->ToString(indent + 1) : nullString)
-           << "\n";
+        ss << indentString << "\tside: " << SideToString(hot.side) << "\n";
+        ss << indentString << "\tprice: " << PriceToString(hot.price) << "\n";
+        ss << indentString << "\tquantity: " << QuantityToString(hot.quantity) << "\n";
+        ss << indentString << "\tpriority: " << PriorityToString(hot.priority) << "\n";
         ss << indentString << "}";
 
         return ss.str();
     }
 };
 
-using OrderHashMap = std::array<MEOrder *, ME_MAX_ORDER_IDS>;
-using ClientOrderHashMap = std::array<OrderHashMap, ME_MAX_NUM_CLIENTS>;
-
-struct MEOrdersAtPrice
-{
-    Side side = Side::INVALID;
-    Price price = Price_INVALID;
-
-    MEOrder *firstOrder = nullptr;
-
-    MEOrdersAtPrice *nextEntry = nullptr;
-    MEOrdersAtPrice *prevEntry = nullptr;
-
-    MEOrdersAtPrice() = default;
-
-    MEOrdersAtPrice(Side side, Price price, MEOrder *firstOrder, MEOrdersAtPrice *nextEntry,
-                    MEOrdersAtPrice *previousEntry)
-        : side(side), price(price), firstOrder(firstOrder), nextEntry(nextEntry), prevEntry(previousEntry)
-    {
-    }
-
-    auto ToString() const
-    {
-        std::stringstream ss;
-        ss << "MEOrdersAtPrice {\n"
-           << "\tside:" << SideToString(side) << "\n"
-           << "\tprice:" << PriceToString(price) << "\n"
-           << "\tfirst_me_order:" << (firstOrder ? firstOrder->ToString(1) : "null") << "\n"
-           << "\tprev:" << PriceToString(prevEntry ? prevEntry->price : Price_INVALID) << "\n"
-           << "\tnext:" << PriceToString(nextEntry ? nextEntry->price : Price_INVALID) << "\n"
-           << "}";
-
-        return ss.str();
-    }
-};
+using MEOrderStore = OrderStore<MEOrder>;
 
-using OrdersAtPriceHashMap = std::array<MEOrdersAtPrice *, ME_MAX_PRICE_LEVELS>;
+using MEOrdersAtPrice = OrderLevel;
 
-} // namespace Exchange
\ No newline at end of file
+} // namespace Exchange
@@ -7,389 +7,603 @@
 #include "exchange/matcher/MatchingEngine.h"
 #include "exchange/order_server/ClientResponse.h"
 
+#include <cstring>
+
 namespace Exchange
 {
-MEOrderBook::MEOrderBook(TickerId tickerId, QuickLogger *logger, MatchingEngine *matchingEngine)
-    : mMatchingEngine(matchingEngine), mOrdersAtPricePool(ME_MAX_PRICE_LEVELS), mOrdersPool(ME_MAX_ORDER_IDS),
-      mTickerId(tickerId), mLogger(logger)
+MEOrderBook::MEOrderBook(TickerId tickerId, QuickLogger *logger, MatchingEngine *matchingEngine,
+                         MemoryOptions const &memoryOptions)
+    : mMatchingEngine(matchingEngine), mClientOrders(ME_MAX_ORDER_IDS, memoryOptions),
+      mOrdersAtPricePool(ME_MAX_PRICE_LEVELS, memoryOptions), mBids(Side::BUY), mAsks(Side::SELL),
+      mOrders(ME_MAX_ORDER_IDS, memoryOptions), mTickerId(tickerId),
+      mCheckpointPositions(ME_MAX_ORDER_IDS), mLogger(logger)
 {
-    mOrdersAtPrice.fill(nullptr);
+    mClientOrderLists.fill(OrderIndex_INVALID);
 }
 
 MEOrderBook::~MEOrderBook()
 {
     mLogger->Log("Destroying orderbook for ticker", mTickerId, "\n");
     mMatchingEngine = nullptr;
-    mAsksByPrice = nullptr;
-    mBidsByPrice = nullptr;
-    for (auto &it : mClientIdToOrderId)
-    {
-        it.fill(nullptr);
-    }
 }
 
 void MEOrderBook::Match(ClientId clientId, TickerId tickerId, Side side, OrderId clientOrderId,
-                        OrderId newMartkerOrderId, MEOrder *order, Quantity &leavesQuantity)
+                        OrderId newMartkerOrderId, OrderIndex orderIndex, MEOrdersAtPrice *ordersAtPrice,
+                        Quantity &leavesQuantity)
 {
-    auto fillQuantity = std::min(leavesQuantity, order->quantity);
+    auto &order = mOrders.Hot(orderIndex);
+    auto const &info = mOrders.Cold(orderIndex);
+    auto fillQuantity = std::min(leavesQuantity, order.quantity);
 
     leavesQuantity -= fillQuantity;
-    order->quantity -= fillQuantity;
-
-    {
-        /* Send a response to both clients about the filled order */
-        mClientResponse.type = ClientResponseType::FILLED;
-        mClientResponse.clientId = clientId;
-        mClientResponse.clientOrderId = clientOrderId;
-        mClientResponse.marketOrderId = newMartkerOrderId;
-        mClientResponse.executed_quantity = fillQuantity;
-        mClientResponse.leaves_quantity = leavesQuantity;
-        mClientResponse.price = order->price;
-        mClientResponse.side = side;
-        mClientResponse.tickerId = tickerId;
-        mMatchingEngine->SendClientResponse(&mClientResponse);
-
-        mClientResponse.type = ClientResponseType::FILLED;
-        mClientResponse.clientId = order->clientId;
-        mClientResponse.clientOrderId = order->clientOrderId;
-        mClientResponse.marketOrderId = order->marketOrderId;
-        mClientResponse.executed_quantity = fillQuantity;
-        mClientResponse.leaves_quantity = leavesQuantity;
-        mClientResponse.price = order->price;
-        mClientResponse.side = side;
-        mClientResponse.tickerId = tickerId;
-        mMatchingEngine->SendClientResponse(&mClientResponse);
-    }
-
-    {
-        /* Send a response to the market */
-        mMarketUpdate.type = MarketUpdateType::TRADE;
-        mMarketUpdate.orderId = order->marketOrderId;
-        mMarketUpdate.price = order->price;
-        mMarketUpdate.priority = Priority_INVALID;
-        mMarketUpdate.side = side;
-        mMarketUpdate.tickerId = tickerId;
-        mMarketUpdate.quantity = fillQuantity;
-        mMatchingEngine->SendMarketUpdate(&mMarketUpdate);
-    }
-
-    if (order->quantity == 0)
-    {
-        RemoveOrder(order);
-
-        /* The order had been fully executed => send a market update and remove it */
-        mMarketUpdate.type = MarketUpdateType::CANCEL;
-        mMarketUpdate.orderId = order->marketOrderId;
-        mMarketUpdate.price = order->price;
-        mMarketUpdate.priority = Priority_INVALID;
-        mMarketUpdate.side = side;
-        mMarketUpdate.tickerId = tickerId;
-        mMarketUpdate.quantity = fillQuantity;
-        mMatchingEngine->SendMarketUpdate(&mMarketUpdate);
-    }
-    else
-    {
-        /* The order hadn't been fully executed => send a modify response */
-        mMarketUpdate.type = MarketUpdateType::MODIFY;
-        mMarketUpdate.orderId = order->marketOrderId;
-        mMarketUpdate.price = order->price;
-        mMarketUpdate.priority = Priority_INVALID;
-        mMarketUpdate.side = side;
-        mMarketUpdate.tickerId = tickerId;
-        mMarketUpdate.quantity = order->quantity;
-        mMatchingEngine->SendMarketUpdate(&mMarketUpdate);
-    }
+    order.quantity -= fillQuantity;
+    ordersAtPrice->totalQuantity -= fillQuantity;
+
+    /* Tell both clients about the fill */
+    *mMatchingEngine->NextClientResponse() = {.type = ClientResponseType::FILLED,
+                                              .clientId = clientId,
+                                              .tickerId = tickerId,
+                                              .clientOrderId = clientOrderId,
+                                              .marketOrderId = newMartkerOrderId,
+                                              .side = side,
+                                              .price = order.price,
+                                              .executed_quantity = fillQuantity,
+                                              .leaves_quantity = leavesQuantity};
+
+    *mMatchingEngine->NextClientResponse() = {.type = ClientResponseType::FILLED,
+                                              .clientId = info.clientId,
+                                              .tickerId = tickerId,
+                                              .clientOrderId = info.clientOrderId,
+                                              .marketOrderId = info.marketOrderId,
+                                              .side = order.side,
+                                              .price = order.price,
+                                              .executed_quantity = fillQuantity,
+                                              .leaves_quantity = order.quantity};
+
+    /* Tell the market about the trade and about what's left of the resting order */
+    AddMarketUpdate({.type = MarketUpdateType::TRADE,
+                     .orderId = info.marketOrderId,
+                     .tickerId = tickerId,
+                     .side = side,
+                     .price = order.price,
+                     .priority = Priority_INVALID,
+                     .quantity = fillQuantity});
+
+    AddMarketUpdate({.type = order.quantity == 0 ? MarketUpdateType::CANCEL : MarketUpdateType::MODIFY,
+                     .orderId = info.marketOrderId,
+                     .tickerId = tickerId,
+                     .side = order.side,
+                     .price = order.price,
+                     .priority = order.priority,
+                     .quantity = order.quantity});
 }
 
+/* Sweeps the opposite side from the best price down to the limit price, in price-time priority. The orders filled at a
+ * level are unlinked together once the walk leaves the level, and a level that is filled completely is removed in one
+ * step instead of order by order. The ladder hands out the next best level without walking any list */
 Quantity MEOrderBook::CheckForMatch(ClientId clientId, OrderId clientOrderId, TickerId tickerId, Side side, Price price,
                                     Quantity qty, OrderId marketOrderId)
 {
     auto leavesQuantity = qty;
+    auto &ladder = GetLadder(side == Side::BUY ? Side::SELL : Side::BUY);
 
-    if (side == Side::BUY)
+    while (leavesQuantity != 0 && !ladder.IsEmpty())
     {
-        while (leavesQuantity != 0 && mAsksByPrice != nullptr)
+        auto ordersAtPrice = ladder.GetBest();
+        if ((side == Side::BUY && price < ordersAtPrice->price) || (side == Side::SELL && price > ordersAtPrice->price))
+        {
+            break;
+        }
+
+        auto firstOrder = ordersAtPrice->firstOrder;
+        auto lastOrder = mOrders.Hot(firstOrder).prevOrder;
+        auto order = firstOrder;
+        u32 numFilled = 0;
+        bool levelFilled = false;
+        while (true)
         {
-            auto firstOrder = mAsksByPrice->firstOrder;
-            if (price < firstOrder->price)
+            Match(clientId, tickerId, side, clientOrderId, marketOrderId, order, ordersAtPrice, leavesQuantity);
+            if (mOrders.Hot(order).quantity != 0)
             {
                 break;
             }
-        }
-    }
-    else if (side == Side::SELL)
-    {
-        while (leavesQuantity != 0 && mBidsByPrice != nullptr)
-        {
-            auto firstOrder = mBidsByPrice->firstOrder;
-            if (price > firstOrder->price)
+
+            auto nextOrder = mOrders.Hot(order).nextOrder;
+            auto const &info = mOrders.Cold(order);
+            mClientOrders.Erase(info.clientId, info.clientOrderId);
+            UnlinkClientOrder(order);
+            mOrders.Deallocate(order);
+            ++numFilled;
+
+            if (order == lastOrder)
+            {
+                levelFilled = true;
+                break;
+            }
+            order = nextOrder;
+            if (leavesQuantity == 0)
             {
                 break;
             }
         }
+
+        if (levelFilled)
+        {
+            RemoveOrdersAtPrice(ordersAtPrice->side, ordersAtPrice->price);
+        }
+        else if (order != firstOrder)
+        {
+            /* order is the first one left at this level */
+            mOrders.Hot(order).prevOrder = lastOrder;
+            mOrders.Hot(lastOrder).nextOrder = order;
+            ordersAtPrice->firstOrder = order;
+            ordersAtPrice->numOrders -= numFilled;
+        }
     }
 
     return leavesQuantity;
 }
 
-Priority MEOrderBook::GetNextPriority(Price price)
+Priority MEOrderBook::GetNextPriority(Side side, Price price)
 {
-    auto ordersAtPrice = GetOrdersAtPrice(price);
+    auto ordersAtPrice = GetOrdersAtPrice(side, price);
     if (ordersAtPrice == nullptr)
     {
         return 1;
     }
-    return ordersAtPrice->firstOrder->prevOrder->priority + 1;
+    return mOrders.Hot(mOrders.Hot(ordersAtPrice->firstOrder).prevOrder).priority + 1;
+}
+
+void MEOrderBook::AddMarketUpdate(MEMarketUpdate const &marketUpdate)
+{
+    auto slot = mMatchingEngine->NextMarketUpdate();
+    *slot = marketUpdate;
+    slot->tickerSequenceNumber = mNextMarketDataSequenceNumber++;
 }
 
 void MEOrderBook::AddOrdersAtPrice(MEOrdersAtPrice *ordersAtPrice)
 {
-    auto priceIndex = PriceToIndex(ordersAtPrice->price);
-    CHECK_FATAL(mOrdersAtPrice[priceIndex] == nullptr, "Cannot add order at a price that is already used");
+    GetLadder(ordersAtPrice->side).Insert(ordersAtPrice->price, ordersAtPrice);
+}
 
-    mOrdersAtPrice[priceIndex] = ordersAtPrice;
+void MEOrderBook::AddOrder(OrderIndex orderIndex)
+{
+    PlaceOrder(orderIndex);
+    LinkClientOrder(orderIndex);
+}
 
-    auto headOfList = ordersAtPrice->side == Side::BUY ? mBidsByPrice : mAsksByPrice;
-    if (headOfList == nullptr) [[unlikely]]
+/* Queues the order at its level and indexes it, without putting it on its client's list */
+void MEOrderBook::PlaceOrder(OrderIndex orderIndex)
+{
+    auto const &order = mOrders.Hot(orderIndex);
+    auto ordersAtPrice = GetOrdersAtPrice(order.side, order.price);
+    if (ordersAtPrice == nullptr)
     {
-        (ordersAtPrice->side == Side::BUY ? mBidsByPrice : mAsksByPrice) = ordersAtPrice;
-        ordersAtPrice->prevEntry = ordersAtPrice->nextEntry = ordersAtPrice;
+        ordersAtPrice = mOrdersAtPricePool.Allocate(order.side, order.price);
+        CHECK_FATAL(ordersAtPrice != nullptr, "No more price levels available for ticker ", mTickerId);
+        AddOrdersAtPrice(ordersAtPrice);
     }
-    else
-    {
-        auto target = headOfList;
-        bool found = false;
-        do
-        {
-            bool shouldInsert = false;
-            if (ordersAtPrice->side == Side::SELL)
-            {
-                shouldInsert = (ordersAtPrice->price > target->price);
-            }
-            else
-            {
-                shouldInsert = (ordersAtPrice->price < target->price);
-            }
+    mOrders.PushBack(*ordersAtPrice, orderIndex);
 
-            if (shouldInsert)
-            {
-                auto prevEntry = target->prevEntry;
-
-                ordersAtPrice->prevEntry = prevEntry;
-                ordersAtPrice->nextEntry = target;
-
-                prevEntry->nextEntry = ordersAtPrice;
-                target->prevEntry = ordersAtPrice;
-
-                if (target == headOfList)
-                {
-                    /* Update the head of the list */
-                    (ordersAtPrice->side == Side::BUY ? mBidsByPrice : mAsksByPrice) = ordersAtPrice;
-                }
-
-                found = true;
-            }
-
-            target = target->nextEntry;
-
-        } while (target != headOfList && !found);
+    auto const &info = mOrders.Cold(orderIndex);
+    mClientOrders.Insert(info.clientId, info.clientOrderId, orderIndex);
+}
 
-        if (!found)
-        {
-            /* If a suitable position could not be found => put it at the back of the list */
-            auto prevEntry = headOfList->prevEntry;
-            ordersAtPrice->prevEntry = prevEntry;
-            ordersAtPrice->nextEntry = headOfList;
+void MEOrderBook::LinkClientOrder(OrderIndex orderIndex)
+{
+    auto &info = mOrders.Cold(orderIndex);
+    DCHECK_FATAL(info.clientId < ME_MAX_NUM_CLIENTS, "Client id ", info.clientId, " is out of range");
 
-            prevEntry->nextEntry = ordersAtPrice;
-            headOfList->prevEntry = ordersAtPrice;
-        }
+    auto &head = mClientOrderLists[info.clientId];
+    info.prevClientOrder = OrderIndex_INVALID;
+    info.nextClientOrder = head;
+    if (head != OrderIndex_INVALID)
+    {
+        mOrders.Cold(head).prevClientOrder = orderIndex;
     }
+    head = orderIndex;
 }
 
-void MEOrderBook::AddOrder(MEOrder *order)
+void MEOrderBook::UnlinkClientOrder(OrderIndex orderIndex)
 {
-    auto ordersAtPrice = GetOrdersAtPrice(order->price);
-    if (ordersAtPrice == nullptr)
+    auto const &info = mOrders.Cold(orderIndex);
+    if (info.prevClientOrder != OrderIndex_INVALID)
     {
-        order->nextOrder = nullptr;
-        order->prevOrder = nullptr;
-
-        auto newOrdersAtPrice = mOrdersAtPricePool.Allocate(order->side, order->price, order, nullptr, nullptr);
-        AddOrdersAtPrice(newOrdersAtPrice);
+        mOrders.Cold(info.prevClientOrder).nextClientOrder = info.nextClientOrder;
     }
     else
     {
-        auto firstOrder = ordersAtPrice->firstOrder;
-        firstOrder->prevOrder->nextOrder = order;
-        order->prevOrder = firstOrder->prevOrder;
-        order->nextOrder = firstOrder;
-        firstOrder->prevOrder = order;
+        mClientOrderLists[info.clientId] = info.nextClientOrder;
+    }
+    if (info.nextClientOrder != OrderIndex_INVALID)
+    {
+        mOrders.Cold(info.nextClientOrder).prevClientOrder = info.prevClientOrder;
     }
-
-    mClientIdToOrderId[order->clientId][order->clientOrderId] = order;
 }
 
 void MEOrderBook::Add(ClientId clientId, OrderId clientOrderId, TickerId tickerId, Side side, Price price, Quantity qty)
 {
-    auto newMarketOrderId = GenerateNewMarketOrderId();
-
+    /* An order that trades is taken whatever room its own side has, only what is left of it needs room to rest. One
+     * that doesn't would only rest, so it is refused up front */
+    if (!Crosses(side, price) && !CanRest(side, price)) [[unlikely]]
     {
-        /* Generate response to accept order */
-        mClientResponse.type = ClientResponseType::ACCEPTED;
-        mClientResponse.clientId = clientId;
-        mClientResponse.clientOrderId = clientOrderId;
-        mClientResponse.marketOrderId = newMarketOrderId;
-        mClientResponse.price = price;
-        mClientResponse.side = side;
-        mClientResponse.tickerId = tickerId;
-        mClientResponse.leaves_quantity = qty;
-        mClientResponse.executed_quantity = 0;
-
-        mMatchingEngine->SendClientResponse(&mClientResponse);
+        QLOG_WARNING(*mLogger, "Rejecting order {} of client {}: no room at price {} in the book of ticker {}\n",
+                     clientOrderId, clientId, price, mTickerId);
+        *mMatchingEngine->NextClientResponse() = {.type = ClientResponseType::INVALID,
+                                                  .clientId = clientId,
+                                                  .tickerId = tickerId,
+                                                  .clientOrderId = clientOrderId,
+                                                  .marketOrderId = OrderId_INVALID,
+                                                  .side = side,
+                                                  .price = price,
+                                                  .executed_quantity = 0,
+                                                  .leaves_quantity = qty};
+        return;
     }
 
+    auto newMarketOrderId = GenerateNewMarketOrderId();
+
+    /* Generate response to accept order */
+    *mMatchingEngine->NextClientResponse() = {.type = ClientResponseType::ACCEPTED,
+                                              .clientId = clientId,
+                                              .tickerId = tickerId,
+                                              .clientOrderId = clientOrderId,
+                                              .marketOrderId = newMarketOrderId,
+                                              .side = side,
+                                              .price = price,
+                                              .executed_quantity = 0,
+                                              .leaves_quantity = qty};
+
     Quantity leftQuantity = CheckForMatch(clientId, clientOrderId, tickerId, side, price, qty, newMarketOrderId);
 
     if (leftQuantity) [[likely]]
     {
-        Priority priority = GetNextPriority(price);
+        /* Matching only takes orders and levels off the other side, which leaves at least the room there was before */
+        if (!CanRest(side, price)) [[unlikely]]
+        {
+            QLOG_WARNING(*mLogger, "Cancelling the {} left of order {} of client {}: no room at price {} for {}\n",
+                         leftQuantity, clientOrderId, clientId, price, mTickerId);
+            *mMatchingEngine->NextClientResponse() = {.type = ClientResponseType::CANCELED,
+                                                      .clientId = clientId,
+                                                      .tickerId = tickerId,
+                                                      .clientOrderId = clientOrderId,
+                                                      .marketOrderId = newMarketOrderId,
+                                                      .side = side,
+                                                      .price = price,
+                                                      .executed_quantity = Quantity_INVALID,
+                                                      .leaves_quantity = leftQuantity};
+            return;
+        }
 
-        auto order = mOrdersPool.Allocate(tickerId, clientId, clientOrderId, newMarketOrderId, side, price,
-                                          leftQuantity, priority, nullptr, nullptr);
+        Priority priority = GetNextPriority(side, price);
+
+        auto order = mOrders.Allocate({.price = price, .priority = priority, .quantity = leftQuantity, .side = side},
+                                      {tickerId, clientId, clientOrderId, newMarketOrderId});
+        CHECK_FATAL(order != OrderIndex_INVALID, "No more orders available for ticker ", mTickerId);
         AddOrder(order);
 
-        SHOWINFO("Orderbook now: ", mBidsByPrice->ToString());
+        SHOWTRACE("Orderbook now: ", GetOrdersAtPrice(side, price)->ToString());
 
-        {
-            /* Generate response for market */
-            mMarketUpdate.orderId = newMarketOrderId;
-            mMarketUpdate.price = price;
-            mMarketUpdate.priority = priority;
-            mMarketUpdate.side = side;
-            mMarketUpdate.tickerId = tickerId;
-            mMarketUpdate.type = MarketUpdateType::ADD;
-            mMarketUpdate.quantity = leftQuantity;
-
-            mMatchingEngine->SendMarketUpdate(&mMarketUpdate);
-        }
+        /* Generate response for market */
+        AddMarketUpdate({.type = MarketUpdateType::ADD,
+                         .orderId = newMarketOrderId,
+                         .tickerId = tickerId,
+                         .side = side,
+                         .price = price,
+                         .priority = priority,
+                         .quantity = leftQuantity});
     }
 }
 
 void MEOrderBook::RemoveOrdersAtPrice(Side side, Price price)
 {
-    auto headOfList = (side == Side::BUY ? mBidsByPrice : mAsksByPrice);
-    auto ordersAtPrice = GetOrdersAtPrice(price);
+    auto &ladder = GetLadder(side);
+    auto ordersAtPrice = ladder.Get(price);
+    ladder.Erase(price);
+    mOrdersAtPricePool.Deallocate(ordersAtPrice);
+}
 
-    if (ordersAtPrice->nextEntry == ordersAtPrice) [[unlikely]]
+void MEOrderBook::RemoveOrder(OrderIndex orderIndex)
+{
+    auto const &order = mOrders.Hot(orderIndex);
+    auto ordersAtPrice = GetOrdersAtPrice(order.side, order.price);
+    mOrders.Unlink(*ordersAtPrice, orderIndex);
+    if (ordersAtPrice->numOrders == 0)
     {
-        (side == Side::BUY ? mBidsByPrice : mAsksByPrice) = nullptr;
+        RemoveOrdersAtPrice(order.side, order.price);
     }
-    else
-    {
-        const auto beforeEntry = ordersAtPrice->prevEntry;
-        const auto nextEntry = ordersAtPrice->nextEntry;
 
-        beforeEntry->nextEntry = nextEntry;
-        nextEntry->prevEntry = beforeEntry;
-
-        if (ordersAtPrice == headOfList)
-        {
-            (side == Side::BUY ? mBidsByPrice : mAsksByPrice) = ordersAtPrice->nextEntry;
-        }
+    auto const &info = mOrders.Cold(orderIndex);
+    mClientOrders.Erase(info.clientId, info.clientOrderId);
+    UnlinkClientOrder(orderIndex);
+    mOrders.Deallocate(orderIndex);
+}
 
-        ordersAtPrice->nextEntry = nullptr;
-        ordersAtPrice->prevEntry = nullptr;
+void MEOrderBook::Cancel(ClientId clientId, OrderId clientOrderId, TickerId tickerId)
+{
+    const auto orderIndex = mClientOrders.Find(clientId, clientOrderId);
+    if (orderIndex == OrderIndex_INVALID) [[unlikely]]
+    {
+        /* We need to send the client a response that we couldn't perform the action */
+        *mMatchingEngine->NextClientResponse() = {.type = ClientResponseType::CANCEL_REJECTED,
+                                                  .clientId = clientId,
+                                                  .tickerId = tickerId,
+                                                  .clientOrderId = clientOrderId,
+                                                  .marketOrderId = OrderId_INVALID,
+                                                  .side = Side::INVALID,
+                                                  .price = Price_INVALID,
+                                                  .executed_quantity = Quantity_INVALID,
+                                                  .leaves_quantity = Quantity_INVALID};
+        return;
     }
-    mOrdersAtPrice[PriceToIndex(price)] = nullptr;
-    mOrdersAtPricePool.Deallocate(ordersAtPrice);
+
+    /* We need to send the client a response that we managed to cancel the order
+       Also we need to notify the market */
+    auto const &exchangeOrder = mOrders.Hot(orderIndex);
+    *mMatchingEngine->NextClientResponse() = {.type = ClientResponseType::CANCELED,
+                                              .clientId = clientId,
+                                              .tickerId = tickerId,
+                                              .clientOrderId = clientOrderId,
+                                              .marketOrderId = mOrders.Cold(orderIndex).marketOrderId,
+                                              .side = exchangeOrder.side,
+                                              .price = exchangeOrder.price,
+                                              .executed_quantity = Quantity_INVALID,
+                                              .leaves_quantity = Quantity_INVALID};
+
+    AddMarketUpdate({.type = MarketUpdateType::CANCEL,
+                     .orderId = mOrders.Cold(orderIndex).marketOrderId,
+                     .tickerId = tickerId,
+                     .side = exchangeOrder.side,
+                     .price = exchangeOrder.price,
+                     .priority = exchangeOrder.priority,
+                     .quantity = exchangeOrder.quantity});
+
+    /* The order goes back to the pool, so it can only be removed once the updates had been filled */
+    RemoveOrder(orderIndex);
 }
 
-void MEOrderBook::RemoveOrder(MEOrder *order)
+/* A smaller quantity at the same price is changed in place and keeps the order's priority. Anything else moves the
+ * order in one step: it leaves its level, is matched at its new price like an incoming order and what is left of it
+ * goes to the back of its new level */
+void MEOrderBook::Modify(ClientId clientId, OrderId clientOrderId, TickerId tickerId, Side side, Price price,
+                         Quantity qty)
 {
-    auto ordersAtPrice = GetOrdersAtPrice(order->price);
-    if (ordersAtPrice->nextEntry == ordersAtPrice)
+    /* Checked with the order still in place, taking it out can only narrow the range of prices in use */
+    const auto orderIndex = mClientOrders.Find(clientId, clientOrderId);
+    if (orderIndex == OrderIndex_INVALID || price == Price_INVALID || qty == 0 || qty == Quantity_INVALID ||
+        !GetLadder(mOrders.Hot(orderIndex).side).Fits(price) || !HasRoomToMove(orderIndex, price)) [[unlikely]]
     {
-        /* This means there's only one order at this price => Remove all orders at price */
-        RemoveOrdersAtPrice(order->side, order->price);
+        /* The client finds its order by side, and tells a missing order from a refused one by the market id */
+        const auto marketOrderId =
+            orderIndex == OrderIndex_INVALID ? OrderId_INVALID : mOrders.Cold(orderIndex).marketOrderId;
+        *mMatchingEngine->NextClientResponse() = {.type = ClientResponseType::MODIFY_REJECTED,
+                                                  .clientId = clientId,
+                                                  .tickerId = tickerId,
+                                                  .clientOrderId = clientOrderId,
+                                                  .marketOrderId = marketOrderId,
+                                                  .side = side,
+                                                  .price = price,
+                                                  .executed_quantity = Quantity_INVALID,
+                                                  .leaves_quantity = qty};
+        return;
     }
-    else
+
+    /* Copied, the order is given back to the store if it moves */
+    const auto order = mOrders.Hot(orderIndex);
+    const auto marketOrderId = mOrders.Cold(orderIndex).marketOrderId;
+
+    *mMatchingEngine->NextClientResponse() = {.type = ClientResponseType::MODIFIED,
+                                              .clientId = clientId,
+                                              .tickerId = tickerId,
+                                              .clientOrderId = clientOrderId,
+                                              .marketOrderId = marketOrderId,
+                                              .side = order.side,
+                                              .price = price,
+                                              .executed_quantity = 0,
+                                              .leaves_quantity = qty};
+
+    if (price == order.price && qty <= order.quantity)
+    {
+        if (qty != order.quantity)
+        {
+            mOrders.SetQuantity(*GetOrdersAtPrice(order.side, price), orderIndex, qty);
+            AddMarketUpdate({.type = MarketUpdateType::MODIFY,
+                             .orderId = marketOrderId,
+                             .tickerId = tickerId,
+                             .side = order.side,
+                             .price = price,
+                             .priority = order.priority,
+                             .quantity = qty});
+        }
+        return;
+    }
+
+    RemoveOrder(orderIndex);
+    const auto leftQuantity = CheckForMatch(clientId, clientOrderId, tickerId, order.side, price, qty, marketOrderId);
+    if (leftQuantity == 0)
     {
-        const auto beforeOrder = order->prevOrder;
-        const auto nextOrder = order->nextOrder;
+        /* Filled completely on the way, the market still has the order where it was */
+        AddMarketUpdate({.type = MarketUpdateType::CANCEL,
+                         .orderId = marketOrderId,
+                         .tickerId = tickerId,
+                         .side = order.side,
+                         .price = order.price,
+                         .priority = order.priority,
+                         .quantity = order.quantity});
+        return;
+    }
 
-        beforeOrder->nextOrder = nextOrder;
-        nextOrder->prevOrder = beforeOrder;
+    const auto priority = GetNextPriority(order.side, price);
+    const auto newOrder =
+        mOrders.Allocate({.price = price, .priority = priority, .quantity = leftQuantity, .side = order.side},
+                         {tickerId, clientId, clientOrderId, marketOrderId});
+    CHECK_FATAL(newOrder != OrderIndex_INVALID, "No more orders available for ticker ", mTickerId);
+    AddOrder(newOrder);
+
+    AddMarketUpdate({.type = MarketUpdateType::REPLACE,
+                     .orderId = marketOrderId,
+                     .tickerId = tickerId,
+                     .side = order.side,
+                     .price = price,
+                     .priority = priority,
+                     .quantity = leftQuantity});
+}
 
-        if (ordersAtPrice->firstOrder == order)
+/* Walks the client's own list, so the cost depends on the client's orders and not on the depth of the book. The market
+ * gets a CANCEL per order, the client a single response */
+void MEOrderBook::MassCancel(ClientId clientId, Side side)
+{
+    auto orderIndex = clientId < ME_MAX_NUM_CLIENTS ? mClientOrderLists[clientId] : OrderIndex_INVALID;
+    while (orderIndex != OrderIndex_INVALID)
+    {
+        const auto nextOrderIndex = mOrders.Cold(orderIndex).nextClientOrder;
+        auto const &order = mOrders.Hot(orderIndex);
+        if (side == Side::INVALID || order.side == side)
         {
-            ordersAtPrice->firstOrder = nextOrder;
+            AddMarketUpdate({.type = MarketUpdateType::CANCEL,
+                             .orderId = mOrders.Cold(orderIndex).marketOrderId,
+                             .tickerId = mTickerId,
+                             .side = order.side,
+                             .price = order.price,
+                             .priority = order.priority,
+                             .quantity = order.quantity});
+            RemoveOrder(orderIndex);
         }
-
-        order->prevOrder = nullptr;
-        order->nextOrder = nullptr;
+        orderIndex = nextOrderIndex;
     }
 
-    mClientIdToOrderId[order->clientId][order->clientOrderId] = nullptr;
-    mOrdersPool.Deallocate(order);
+    *mMatchingEngine->NextClientResponse() = {.type = ClientResponseType::MASS_CANCELED,
+                                              .clientId = clientId,
+                                              .tickerId = mTickerId,
+                                              .clientOrderId = OrderId_INVALID,
+                                              .marketOrderId = OrderId_INVALID,
+                                              .side = side,
+                                              .price = Price_INVALID,
+                                              .executed_quantity = Quantity_INVALID,
+                                              .leaves_quantity = Quantity_INVALID};
 }
 
-void MEOrderBook::Cancel(ClientId clientId, OrderId clientOrderId, TickerId tickerId)
+/* Two walks over the levels: the first numbers the orders, so that the second can write each order's link to the next
+ * one of its client as a position in the checkpoint */
+void MEOrderBook::WriteCheckpoint(std::vector<char> &checkpoint)
 {
-    bool isCancellable = clientId < mClientIdToOrderId.size();
-    MEOrder *exchangeOrder = nullptr;
-    if (isCancellable) [[likely]]
+    auto forEachOrder = [this](auto &&function) {
+        for (auto side : {Side::BUY, Side::SELL})
+        {
+            auto &ladder = GetLadder(side);
+            for (auto level = ladder.GetBest(); level != nullptr; level = ladder.GetNext(level->price))
+            {
+                auto orderIndex = level->firstOrder;
+                do
+                {
+                    function(orderIndex);
+                    orderIndex = mOrders.Hot(orderIndex).nextOrder;
+                } while (orderIndex != level->firstOrder);
+            }
+        }
+    };
+
+    u32 numOrders = 0;
+    forEachOrder([&](OrderIndex orderIndex) { mCheckpointPositions[orderIndex] = numOrders++; });
+    auto toPosition = [this](OrderIndex orderIndex) {
+        return orderIndex == OrderIndex_INVALID ? CheckpointOrder::NO_ORDER : mCheckpointPositions[orderIndex];
+    };
+
+    u32 numClients = 0;
+    for (auto head : mClientOrderLists)
     {
-        auto &order = mClientIdToOrderId[clientId];
-        exchangeOrder = order.at(clientOrderId);
-        isCancellable = (exchangeOrder != nullptr);
+        numClients += head != OrderIndex_INVALID;
     }
 
-    if (!isCancellable) [[unlikely]]
+    const CheckpointBook book{.tickerId = mTickerId,
+                              .numOrders = numOrders,
+                              .numClients = numClients,
+                              .nextMarketOrderId = mNextOrderId,
+                              .nextMarketDataSequenceNumber = mNextMarketDataSequenceNumber};
+    auto offset = checkpoint.size();
+    checkpoint.resize(offset + sizeof(book) + numOrders * sizeof(CheckpointOrder) +
+                      numClients * sizeof(CheckpointClient));
+    std::memcpy(checkpoint.data() + offset, &book, sizeof(book));
+    offset += sizeof(book);
+
+    auto orders = reinterpret_cast<CheckpointOrder *>(checkpoint.data() + offset);
+    forEachOrder([&](OrderIndex orderIndex) {
+        auto const &order = mOrders.Hot(orderIndex);
+        auto const &info = mOrders.Cold(orderIndex);
+        *orders++ = {.marketOrderId = info.marketOrderId,
+                     .clientOrderId = info.clientOrderId,
+                     .price = order.price,
+                     .priority = order.priority,
+                     .quantity = order.quantity,
+                     .clientId = info.clientId,
+                     .nextClientOrder = toPosition(info.nextClientOrder),
+                     .side = order.side};
+    });
+
+    auto clients = reinterpret_cast<CheckpointClient *>(orders);
+    for (ClientId clientId = 0; clientId < ME_MAX_NUM_CLIENTS; ++clientId)
     {
-        /* We need to send the client a response that we couldn't perform the action */
-        mClientResponse.type = ClientResponseType::CANCEL_REJECTED;
-        mClientResponse.clientId = clientId;
-        mClientResponse.clientOrderId = clientOrderId;
-        mClientResponse.tickerId = tickerId;
-        mClientResponse.marketOrderId = OrderId_INVALID;
-        mClientResponse.executed_quantity = Quantity_INVALID;
-        mClientResponse.leaves_quantity = Quantity_INVALID;
-        mClientResponse.price = Price_INVALID;
-        mClientResponse.side = Side::INVALID;
+        if (mClientOrderLists[clientId] != OrderIndex_INVALID)
+        {
+            *clients++ = {.clientId = clientId, .firstOrder = toPosition(mClientOrderLists[clientId])};
+        }
     }
-    else
+}
+
+void MEOrderBook::ReadCheckpoint(CheckpointBook const &book, std::span<CheckpointOrder const> orders,
+                                 std::span<CheckpointClient const> clients, std::vector<MEMarketUpdate> &marketUpdates)
+{
+    CHECK_FATAL(mOrders.GetNumAllocated() == 0, "Checkpoint restored into the non-empty book of ticker ", mTickerId);
+    CHECK_FATAL(orders.size() <= mOrders.GetCapacity(), "Checkpoint of ticker ", mTickerId, " has ", orders.size(),
+                " orders, more than the book holds");
+    mNextOrderId = book.nextMarketOrderId;
+    mNextMarketDataSequenceNumber = book.nextMarketDataSequenceNumber;
+
+    /* The orders come in price-time priority, so queueing them in turn rebuilds every level as it was */
+    for (std::size_t position = 0; position < orders.size(); ++position)
     {
-        RemoveOrder(exchangeOrder);
+        auto const &order = orders[position];
+        CHECK_FATAL(order.clientId < ME_MAX_NUM_CLIENTS, "Checkpoint has an order of client ", order.clientId);
+        const auto orderIndex = mOrders.Allocate(
+            {.price = order.price, .priority = order.priority, .quantity = order.quantity, .side = order.side},
+            {mTickerId, order.clientId, order.clientOrderId, order.marketOrderId});
+        PlaceOrder(orderIndex);
+        mCheckpointPositions[position] = orderIndex;
+
+        marketUpdates.push_back({.type = MarketUpdateType::ADD,
+                                 .orderId = order.marketOrderId,
+                                 .tickerId = mTickerId,
+                                 .side = order.side,
+                                 .price = order.price,
+                                 .priority = order.priority,
+                                 .quantity = order.quantity});
+    }
 
-        /* We need to send the client a response that we managed to cancel the order
-           Also we need to notify the market */
+    auto toIndex = [&](u32 position) {
+        if (position == CheckpointOrder::NO_ORDER)
         {
-            mClientResponse.type = ClientResponseType::CANCELED;
-            mClientResponse.clientId = clientId;
-            mClientResponse.clientOrderId = clientOrderId;
-            mClientResponse.tickerId = tickerId;
-            mClientResponse.marketOrderId = exchangeOrder->marketOrderId;
-            mClientResponse.executed_quantity = Quantity_INVALID;
-            mClientResponse.leaves_quantity = Quantity_INVALID;
-            mClientResponse.price = exchangeOrder->price;
-            mClientResponse.side = exchangeOrder->side;
+            return OrderIndex_INVALID;
         }
+        CHECK_FATAL(position < orders.size(), "Checkpoint of ticker ", mTickerId, " links to order ", position);
+        return mCheckpointPositions[position];
+    };
 
+    /* Then the clients' lists, in the order they had */
+    for (std::size_t position = 0; position < orders.size(); ++position)
+    {
+        const auto orderIndex = mCheckpointPositions[position];
+        const auto nextOrderIndex = toIndex(orders[position].nextClientOrder);
+        mOrders.Cold(orderIndex).nextClientOrder = nextOrderIndex;
+        if (nextOrderIndex != OrderIndex_INVALID)
         {
-            mMarketUpdate.orderId = exchangeOrder->marketOrderId;
-            mMarketUpdate.price = exchangeOrder->price;
-            mMarketUpdate.priority = exchangeOrder->priority;
-            mMarketUpdate.side = exchangeOrder->side;
-            mMarketUpdate.quantity = exchangeOrder->quantity;
-            mMarketUpdate.tickerId = tickerId;
-            mMarketUpdate.type = MarketUpdateType::CANCEL;
-
-            mMatchingEngine->SendMarketUpdate(&mMarketUpdate);
+            mOrders.Cold(nextOrderIndex).prevClientOrder = orderIndex;
         }
     }
-
-    mMatchingEngine->SendClientResponse(&mClientResponse);
+    for (auto const &client : clients)
+    {
+        CHECK_FATAL(client.clientId < ME_MAX_NUM_CLIENTS, "Checkpoint has orders of client ", client.clientId);
+        mClientOrderLists[client.clientId] = toIndex(client.firstOrder);
+    }
 }
 
-} // namespace Exchange
\ No newline at end of file
+} // namespace Exchange
@@ -6,8 +6,14 @@
 #include "MarketUpdate.h"
 #include "MemoryPool.h"
 #include "Types.h"
+#include "exchange/matcher/Checkpoint.h"
+#include "exchange/matcher/ClientOrderMap.h"
+#include "exchange/matcher/PriceLadder.h"
 #include "exchange/order_server/ClientResponse.h"
 
+#include <span>
+#include <vector>
+
 namespace Exchange
 {
 
@@ -16,7 +22,8 @@ class MatchingEngine;
 class MEOrderBook
 {
 public:
-    MEOrderBook(TickerId tickerId, QuickLogger *logger, MatchingEngine *matchingEngine);
+    MEOrderBook(TickerId tickerId, QuickLogger *logger, MatchingEngine *matchingEngine,
+                MemoryOptions const &memoryOptions = {});
     ~MEOrderBook();
 
     OrderId GenerateNewMarketOrderId()
@@ -24,9 +31,9 @@ public:
         return mNextOrderId++;
     }
 
-    MEOrdersAtPrice *GetOrdersAtPrice(Price price)
+    MEOrdersAtPrice *GetOrdersAtPrice(Side side, Price price)
     {
-        return mOrdersAtPrice[PriceToIndex(price)];
+        return GetLadder(side).Get(price);
     }
 
     MEOrderBook() = delete;
@@ -37,46 +44,98 @@ public:
 
     void Add(ClientId clientId, OrderId clientOrderId, TickerId tickerId, Side side, Price price, Quantity qty);
     void Cancel(ClientId clientId, OrderId clientOrderId, TickerId tickerId);
+    void Modify(ClientId clientId, OrderId clientOrderId, TickerId tickerId, Side side, Price price, Quantity qty);
+    void MassCancel(ClientId clientId, Side side);
+
+    /* Appends the book to a checkpoint */
+    void WriteCheckpoint(std::vector<char> &checkpoint);
+    /* Rebuilds an empty book from its part of a checkpoint, adding an ADD for every order it restores to orders */
+    void ReadCheckpoint(CheckpointBook const &book, std::span<CheckpointOrder const> orders,
+                        std::span<CheckpointClient const> clients, std::vector<MEMarketUpdate> &marketUpdates);
 
 private:
     Quantity CheckForMatch(ClientId clientId, OrderId clientOrderId, TickerId tickerId, Side side, Price price,
                            Quantity qty, OrderId marketOrderId);
 
     void Match(ClientId clientId, TickerId tickerId, Side side, OrderId clientOrderId, OrderId newMartkerOrderId,
-               MEOrder *order, Quantity &leavesQuantity);
+               OrderIndex orderIndex, MEOrdersAtPrice *ordersAtPrice, Quantity &leavesQuantity);
+
+    Priority GetNextPriority(Side side, Price price);
 
-    Priority GetNextPriority(Price price);
+    void AddOrder(OrderIndex orderIndex);
+    void PlaceOrder(OrderIndex orderIndex);
+    void RemoveOrder(OrderIndex orderIndex);
 
-    void AddOrder(MEOrder *order);
-    void RemoveOrder(MEOrder *order);
+    void LinkClientOrder(OrderIndex orderIndex);
+    void UnlinkClientOrder(OrderIndex orderIndex);
+
+    /* Numbers the update in the order the book makes them and writes it to the shard's output queue */
+    void AddMarketUpdate(MEMarketUpdate const &marketUpdate);
 
     void AddOrdersAtPrice(MEOrdersAtPrice *ordersAtPrice);
     void RemoveOrdersAtPrice(Side side, Price price);
 
-    u32 PriceToIndex(Price price)
+    PriceLadder<MEOrdersAtPrice> &GetLadder(Side side)
+    {
+        return side == Side::BUY ? mBids : mAsks;
+    }
+
+    /* An order left to rest takes an order from the store, and a level from the pool if its price has none yet */
+    bool HasRoomFor(Side side, Price price)
+    {
+        return mOrders.GetNumAllocated() < mOrders.GetCapacity() &&
+               (GetOrdersAtPrice(side, price) != nullptr ||
+                mOrdersAtPricePool.GetNumAllocated() < mOrdersAtPricePool.GetCapacity());
+    }
+
+    /* Whether an order at price could rest, its price fitting in the side's ladder and the book having room for it */
+    bool CanRest(Side side, Price price)
     {
-        return price % ME_MAX_PRICE_LEVELS;
+        return GetLadder(side).Fits(price) && HasRoomFor(side, price);
+    }
+
+    /* Whether an order at price would trade with the best level of the other side */
+    bool Crosses(Side side, Price price)
+    {
+        auto best = GetLadder(side == Side::BUY ? Side::SELL : Side::BUY).GetBest();
+        if (best == nullptr)
+        {
+            return false;
+        }
+        return side == Side::BUY ? price >= best->price : price <= best->price;
+    }
+
+    /* A resting order moved to price gives its own order back first, so the store always has room for it. It needs a
+     * level only at a new price, and gives its own level back too if it was alone there */
+    bool HasRoomToMove(OrderIndex orderIndex, Price price)
+    {
+        auto const &order = mOrders.Hot(orderIndex);
+        return GetOrdersAtPrice(order.side, price) != nullptr ||
+               mOrdersAtPricePool.GetNumAllocated() < mOrdersAtPricePool.GetCapacity() ||
+               GetOrdersAtPrice(order.side, order.price)->numOrders == 1;
     }
 
 private:
     MatchingEngine *mMatchingEngine;
 
-    ClientOrderHashMap mClientIdToOrderId;
+    ClientOrderMap mClientOrders;
+    /* Most recent order of every client, heads of the lists threaded through the orders' prev/nextClientOrder */
+    std::array<OrderIndex, ME_MAX_NUM_CLIENTS> mClientOrderLists;
 
     MemoryPool<MEOrdersAtPrice> mOrdersAtPricePool;
-    MEOrdersAtPrice *mBidsByPrice = nullptr;
-    MEOrdersAtPrice *mAsksByPrice = nullptr;
-
-    OrdersAtPriceHashMap mOrdersAtPrice;
+    PriceLadder<MEOrdersAtPrice> mBids;
+    PriceLadder<MEOrdersAtPrice> mAsks;
 
-    MemoryPool<MEOrder> mOrdersPool;
+    MEOrderStore mOrders;
 
     TickerId mTickerId = TickerId_INVALID;
 
-    MEClientResponse mClientResponse;
-    MEMarketUpdate mMarketUpdate;
-
     OrderId mNextOrderId = 0;
+    /* Of the ticker's next market update */
+    u64 mNextMarketDataSequenceNumber = 1;
+
+    /* Maps between order indexes and positions in a checkpoint while one is written or read */
+    std::vector<u32> mCheckpointPositions;
 
     QuickLogger *mLogger;
 };
@@ -2,29 +2,64 @@
 #include "Check.h"
 #include "Logger.h"
 #include "ThreadUtils.h"
+#include "TimeUtils.h"
 #include "exchange/matcher/MEOrderBook.h"
 #include "exchange/order_server/ClientRequest.h"
 
 namespace Exchange
 {
 MatchingEngine::MatchingEngine(MEClientRequestQueue *clientRequests, MEClientResponseQueue *clientResponses,
-                               MEMarketUpdateQueue *marketUpdate)
-    : mClientRequests(clientRequests), mClientResponses(clientResponses), mMarketUpdate(marketUpdate),
-      mLogger("matching_engine.log")
+                               MEMarketUpdateQueue *marketUpdate, ShardConfig const &shardConfig, u32 shard,
+                               MemoryOptions const &memoryOptions)
+    : mClientRequests(clientRequests), mClientResponses(clientResponses), mMarketUpdate(marketUpdate), mShard(shard),
+      mCore(shardConfig.cores[shard]), mLogger("matching_engine_" + std::to_string(shard) + ".log")
 {
+    shardConfig.Validate();
     for (u32 i = 0; i < mOrderBook.size(); ++i)
     {
-        mOrderBook[i] = new MEOrderBook(i, &mLogger, this);
+        mOrderBook[i] = shardConfig.GetShard(i) == shard ? new MEOrderBook(i, &mLogger, this, memoryOptions) : nullptr;
     }
 }
 MatchingEngine::~MatchingEngine()
 {
     Stop();
+
+    for (auto &orderBook : mOrderBook)
+    {
+        delete orderBook;
+        orderBook = nullptr;
+    }
 }
 
 void MatchingEngine::ProcessClientRequest(MEClientRequest *request)
 {
-    auto orderBook = mOrderBook[request->tickerId];
+    if (request->type == ClientRequestType::CHECKPOINT) [[unlikely]]
+    {
+        WriteCheckpoint(request->orderId);
+        return;
+    }
+
+    if (request->type == ClientRequestType::MASS_CANCEL && request->tickerId == TickerId_INVALID)
+    {
+        /* Every shard gets this one and goes through the books it holds */
+        for (auto orderBook : mOrderBook)
+        {
+            if (orderBook != nullptr)
+            {
+                orderBook->MassCancel(request->clientId, request->side);
+            }
+        }
+        PublishOutputs();
+        return;
+    }
+
+    auto orderBook = GetOrderBook(request->tickerId);
+    if (orderBook == nullptr) [[unlikely]]
+    {
+        QLOG_ERROR(mLogger, "Request for ticker {} which is not handled by shard {}\n", request->tickerId, mShard);
+        return;
+    }
+
     switch (request->type)
     {
     case ClientRequestType::NEW:
@@ -34,36 +69,67 @@ void MatchingEngine::ProcessClientRequest(MEClientRequest *request)
     case ClientRequestType::CANCEL:
         orderBook->Cancel(request->clientId, request->orderId, request->tickerId);
         break;
+    case ClientRequestType::MODIFY:
+        orderBook->Modify(request->clientId, request->orderId, request->tickerId, request->side, request->price,
+                          request->quantity);
+        break;
+    case ClientRequestType::MASS_CANCEL:
+        orderBook->MassCancel(request->clientId, request->side);
+        break;
+    case ClientRequestType::CHECKPOINT:
     case ClientRequestType::INVALID:
-        mLogger.Log("Invalid client request received\n");
+        QLOG_ERROR(mLogger, "Invalid client request received\n");
         break;
     }
-}
 
-void MatchingEngine::SendClientResponse(MEClientResponse *response)
-{
-    auto *nextWrite = mClientResponses->GetNextWriteTo();
-    *nextWrite = std::move(*response);
-    mClientResponses->UpdateWriteIndex();
+    PublishOutputs();
 }
 
-void MatchingEngine::SendMarketUpdate(MEMarketUpdate *marketUpdate)
+/* Runs between two requests, so the books are consistent, and only copies them: writing the file is left to the
+ * checkpoint thread */
+void MatchingEngine::WriteCheckpoint(u64 sequenceNumber)
 {
-    auto *nextWrite = mMarketUpdate->GetNextWriteTo();
-    *nextWrite = std::move(*marketUpdate);
-    mMarketUpdate->UpdateWriteIndex();
+    if (mCheckpointWriter == nullptr)
+    {
+        QLOG_ERROR(mLogger, "Checkpoint {} requested but shard {} has nowhere to write it\n", sequenceNumber, mShard);
+        return;
+    }
+
+    const auto start = GetCurrentNanos();
+    auto &checkpoint = mCheckpointWriter->BeginShard(mShard);
+    u32 numBooks = 0;
+    for (auto orderBook : mOrderBook)
+    {
+        if (orderBook != nullptr)
+        {
+            orderBook->WriteCheckpoint(checkpoint);
+            ++numBooks;
+        }
+    }
+    mCheckpointWriter->EndShard(mShard, sequenceNumber, numBooks, mNumMarketUpdates);
+
+    QLOG_INFO(mLogger, "Checkpoint {} of {} book(s), {} bytes, took {} ns\n", sequenceNumber, numBooks,
+              checkpoint.size(), GetCurrentNanos() - start);
 }
 
 void MatchingEngine::Run()
 {
     while (mRunning)
     {
-        auto clientRequest = mClientRequests->GetNextRead();
-        if (clientRequest)
+        /* Drain whatever the sequencer published so far and release the slots with a single index update */
+        auto clientRequests = mClientRequests->GetNextReadSpan(ME_MAX_CLIENT_UPDATES);
+        for (auto &clientRequest : clientRequests)
         {
-            mLogger.Log("Processing request ", clientRequest->ToString(), '\n');
-            ProcessClientRequest(clientRequest);
-            mClientRequests->UpdateReadIndex();
+            QLOG_TRACE(mLogger,
+                       "Processing request: type {} client {} ticker {} order {} side {} price {} quantity {}\n",
+                       clientRequest.type, clientRequest.clientId, clientRequest.tickerId, clientRequest.orderId,
+                       clientRequest.side, clientRequest.price, clientRequest.quantity);
+            ProcessClientRequest(&clientRequest);
+        }
+
+        if (!clientRequests.empty())
+        {
+            mClientRequests->UpdateReadIndex(clientRequests.size());
         }
     }
 }
@@ -71,7 +137,8 @@ void MatchingEngine::Run()
 void MatchingEngine::Start()
 {
     mRunning = true;
-    mRunningThread = CreateAndStartThread(-1, "Matching Engine", [&]() { this->Run(); });
+    mRunningThread =
+        CreateAndStartThread(mCore, "Matching Engine " + std::to_string(mShard), [&]() { this->Run(); });
     CHECK_FATAL(mRunningThread != nullptr, "Unable to start matching engine thread");
 }
 
@@ -82,6 +149,13 @@ void MatchingEngine::Stop()
         mRunningThread->join();
 
     mRunningThread.reset();
+
+    mLogger.Log("Client responses queue: capacity = ", mClientResponses->GetCapacity(),
+                "; high water mark = ", mClientResponses->GetHighWaterMark(),
+                "; full events = ", mClientResponses->GetFullEvents(), "\n");
+    mLogger.Log("Market updates queue: capacity = ", mMarketUpdate->GetCapacity(),
+                "; high water mark = ", mMarketUpdate->GetHighWaterMark(),
+                "; full events = ", mMarketUpdate->GetFullEvents(), "\n");
 }
 
 } // namespace Exchange
\ No newline at end of file
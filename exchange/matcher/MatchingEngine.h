@@ -2,18 +2,23 @@
 
 #include "Logger.h"
 #include "MarketUpdate.h"
+#include "exchange/matcher/Checkpoint.h"
 #include "exchange/matcher/MEOrderBook.h"
+#include "exchange/matcher/ShardConfig.h"
 #include "exchange/order_server/ClientRequest.h"
 #include "exchange/order_server/ClientResponse.h"
 #include <thread>
 
 namespace Exchange
 {
+/* One matching thread. It holds the books of the tickers the shard config gives to its shard and reads only the
+ * requests routed to that shard */
 class MatchingEngine
 {
 public:
     MatchingEngine(MEClientRequestQueue *clientRequests, MEClientResponseQueue *clientResponses,
-                   MEMarketUpdateQueue *marketUpdate);
+                   MEMarketUpdateQueue *marketUpdate, ShardConfig const &shardConfig = {}, u32 shard = 0,
+                   MemoryOptions const &memoryOptions = {});
 
     ~MatchingEngine();
 
@@ -27,13 +32,66 @@ public:
     MatchingEngine &operator=(const MatchingEngine &&) = delete;
 
 public:
-    void SendClientResponse(MEClientResponse *response);
-    void SendMarketUpdate(MEMarketUpdate *marketUpdate);
+    /* Slots for the outputs of the request being processed. They are written in place in the queues and published
+     * together by PublishOutputs once the request has been handled */
+    MEClientResponse *NextClientResponse()
+    {
+        return ReserveOutput(mClientResponses, mPendingClientResponses, mDroppedClientResponse);
+    }
+
+    MEMarketUpdate *NextMarketUpdate()
+    {
+        ++mNumMarketUpdates;
+        return ReserveOutput(mMarketUpdate, mPendingMarketUpdates, mDroppedMarketUpdate);
+    }
+
+    void PublishOutputs()
+    {
+        mClientResponses->UpdateWriteIndex(mPendingClientResponses);
+        mMarketUpdate->UpdateWriteIndex(mPendingMarketUpdates);
+        mPendingClientResponses = 0;
+        mPendingMarketUpdates = 0;
+    }
+
+    /* nullptr for the tickers of other shards */
+    MEOrderBook *GetOrderBook(TickerId tickerId) const
+    {
+        return tickerId < mOrderBook.size() ? mOrderBook[tickerId] : nullptr;
+    }
+
+    /* Where the shard's part of every checkpoint goes. Without one checkpoint requests are ignored */
+    void SetCheckpointWriter(CheckpointWriter *checkpointWriter)
+    {
+        mCheckpointWriter = checkpointWriter;
+    }
+
+    void ProcessClientRequest(MEClientRequest *request);
 
 private:
     void Run();
+    void WriteCheckpoint(u64 sequenceNumber);
 
-    void ProcessClientRequest(MEClientRequest *request);
+    /* Outputs must not be lost, so when the queue is full the part of the batch written so far is published and we
+     * wait for the consumer to make room. Once the engine is stopping the consumer may be gone, the output is written
+     * to dropped instead */
+    template <typename T> T *ReserveOutput(SafeQueue<T> *queue, std::size_t &pending, T &dropped)
+    {
+        auto slot = queue->TryGetNextWriteTo(pending);
+        if (slot == nullptr) [[unlikely]]
+        {
+            queue->UpdateWriteIndex(pending);
+            pending = 0;
+            while ((slot = queue->TryGetNextWriteTo()) == nullptr && mRunning)
+                ;
+            if (slot == nullptr)
+            {
+                mLogger.Log("Dropping an output of shard ", mShard, " while stopping\n");
+                return &dropped;
+            }
+        }
+        ++pending;
+        return slot;
+    }
 
 private:
     OrderBookHashMap mOrderBook;
@@ -41,6 +99,19 @@ private:
     MEClientResponseQueue *mClientResponses = nullptr;
     MEMarketUpdateQueue *mMarketUpdate = nullptr;
 
+    std::size_t mPendingClientResponses = 0;
+    std::size_t mPendingMarketUpdates = 0;
+    /* Written instead of a queue slot while stopping, see ReserveOutput */
+    MEClientResponse mDroppedClientResponse;
+    MEMarketUpdate mDroppedMarketUpdate;
+    /* Every market update since the start, the publisher numbers them in turn */
+    u64 mNumMarketUpdates = 0;
+
+    CheckpointWriter *mCheckpointWriter = nullptr;
+
+    u32 mShard = 0;
+    i32 mCore = -1;
+
     std::unique_ptr<std::thread> mRunningThread;
     volatile bool mRunning = false;
 
@@ -0,0 +1,230 @@
+#pragma once
+
+#include "Check.h"
+#include "Limits.h"
+#include "Types.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+
+namespace Exchange
+{
+/* Price levels of one side of a book, in a dense array indexed by ticks from a base price.
+ * The index grows away from the best price (up for asks, down for bids), so the best level is always the lowest set
+ * index. Non-empty levels are tracked in a two level bitmap: one bit per level in the words and one bit per non-empty
+ * word in the summary. The best level and the next level after a given one are found with a couple of
+ * count-trailing-zeros, and inserting a level never walks anything. When a price falls outside the window the ladder is
+ * re-centered on the range of prices in use; that costs a pass over the array but only happens when the market drifts
+ * by a large fraction of the window. */
+template <typename Level> class PriceLadder
+{
+public:
+    static constexpr u32 SIZE = ME_PRICE_LADDER_SIZE;
+    static_assert(SIZE % 64 == 0 && SIZE <= 64 * 64, "The ladder's bitmap has two levels of 64 bits");
+
+    explicit PriceLadder(Side side) : mDirection(side == Side::BUY ? -1 : 1)
+    {
+        mLevels.fill(nullptr);
+        mWords.fill(0);
+    }
+
+    PriceLadder() = delete;
+    PriceLadder(const PriceLadder &) = delete;
+    PriceLadder(const PriceLadder &&) = delete;
+    PriceLadder &operator=(const PriceLadder &) = delete;
+    PriceLadder &operator=(const PriceLadder &&) = delete;
+
+    Level *Get(Price price) const
+    {
+        const auto index = ToIndex(price);
+        return IsInWindow(index) ? mLevels[index] : nullptr;
+    }
+
+    /* Whether Insert(price) would find room, moving the window if it has to. The levels in use and the new one must
+     * all be less than SIZE ticks apart */
+    bool Fits(Price price) const
+    {
+        const auto index = ToIndex(price);
+        if (IsInWindow(index) || IsEmpty())
+        {
+            return true;
+        }
+        return std::max(FindLast(), index) - std::min(FindFirst(), index) < SIZE;
+    }
+
+    /* The price must fit, see Fits */
+    void Insert(Price price, Level *level)
+    {
+        auto index = ToIndex(price);
+        if (!IsInWindow(index)) [[unlikely]]
+        {
+            Recenter(index);
+            index = ToIndex(price);
+        }
+
+        CHECK_FATAL(mLevels[index] == nullptr, "Price level ", price, " is already in the ladder");
+        mLevels[index] = level;
+        SetBit(index);
+    }
+
+    void Erase(Price price)
+    {
+        const auto index = ToIndex(price);
+        DCHECK_FATAL(IsInWindow(index) && mLevels[index] != nullptr, "Price level ", price, " is not in the ladder");
+        mLevels[index] = nullptr;
+        ClearBit(index);
+    }
+
+    bool IsEmpty() const
+    {
+        return mSummary == 0;
+    }
+
+    Level *GetBest() const
+    {
+        const auto index = FindFirst();
+        return index == NO_INDEX ? nullptr : mLevels[index];
+    }
+
+    /* The first level after price going away from the best price */
+    Level *GetNext(Price price) const
+    {
+        const auto index = FindNext(ToIndex(price) + 1);
+        return index == NO_INDEX ? nullptr : mLevels[index];
+    }
+
+    /* Number of times the window had to move */
+    std::size_t GetNumRecenters() const
+    {
+        return mNumRecenters;
+    }
+
+private:
+    static constexpr u32 NUM_WORDS = SIZE / 64;
+    static constexpr int64_t NO_INDEX = -1;
+
+    /* Prices wrap around like any unsigned value, only the distance to the base price matters */
+    int64_t ToIndex(Price price) const
+    {
+        return static_cast<int64_t>(price - mBasePrice) * mDirection;
+    }
+
+    Price ToPrice(int64_t index) const
+    {
+        return mBasePrice + static_cast<Price>(index * mDirection);
+    }
+
+    static bool IsInWindow(int64_t index)
+    {
+        return index >= 0 && index < SIZE;
+    }
+
+    void SetBit(int64_t index)
+    {
+        mWords[index / 64] |= u64(1) << (index % 64);
+        mSummary |= u64(1) << (index / 64);
+    }
+
+    void ClearBit(int64_t index)
+    {
+        auto &word = mWords[index / 64];
+        word &= ~(u64(1) << (index % 64));
+        if (word == 0)
+        {
+            mSummary &= ~(u64(1) << (index / 64));
+        }
+    }
+
+    int64_t FindFirst() const
+    {
+        if (mSummary == 0)
+        {
+            return NO_INDEX;
+        }
+        const auto word = std::countr_zero(mSummary);
+        return word * 64 + std::countr_zero(mWords[word]);
+    }
+
+    /* First set index at or after from */
+    int64_t FindNext(int64_t from) const
+    {
+        if (from >= SIZE)
+        {
+            return NO_INDEX;
+        }
+
+        auto word = from / 64;
+        const auto bits = mWords[word] & (~u64(0) << (from % 64));
+        if (bits != 0)
+        {
+            return word * 64 + std::countr_zero(bits);
+        }
+
+        const auto words = word + 1 < 64 ? mSummary & (~u64(0) << (word + 1)) : 0;
+        if (words == 0)
+        {
+            return NO_INDEX;
+        }
+        word = std::countr_zero(words);
+        return word * 64 + std::countr_zero(mWords[word]);
+    }
+
+    int64_t FindLast() const
+    {
+        const auto word = 63 - std::countl_zero(mSummary);
+        return word * 64 + 63 - std::countl_zero(mWords[word]);
+    }
+
+    /* Moves the window so that the levels in use and the index that didn't fit sit in its middle */
+    void Recenter(int64_t index)
+    {
+        ++mNumRecenters;
+        if (IsEmpty())
+        {
+            mBasePrice = ToPrice(index - SIZE / 2);
+            return;
+        }
+
+        const auto low = std::min(FindFirst(), index);
+        const auto high = std::max(FindLast(), index);
+        CHECK_FATAL(high - low < SIZE, "Prices from ", ToPrice(low), " to ", ToPrice(high),
+                    " don't fit in a price ladder of ", SIZE, " levels");
+
+        const auto shift = low - (SIZE - (high - low + 1)) / 2;
+        if (shift > 0)
+        {
+            std::copy(mLevels.begin() + shift, mLevels.end(), mLevels.begin());
+            std::fill(mLevels.end() - shift, mLevels.end(), nullptr);
+        }
+        else
+        {
+            std::copy_backward(mLevels.begin(), mLevels.end() + shift, mLevels.end());
+            std::fill(mLevels.begin(), mLevels.begin() - shift, nullptr);
+        }
+        mBasePrice = ToPrice(shift);
+
+        mWords.fill(0);
+        mSummary = 0;
+        for (u32 i = 0; i < SIZE; ++i)
+        {
+            if (mLevels[i] != nullptr)
+            {
+                SetBit(i);
+            }
+        }
+    }
+
+private:
+    const int64_t mDirection;
+    Price mBasePrice = 0;
+
+    u64 mSummary = 0;
+    std::array<u64, NUM_WORDS> mWords;
+    std::array<Level *, SIZE> mLevels;
+
+    std::size_t mNumRecenters = 0;
+};
+
+} // namespace Exchange
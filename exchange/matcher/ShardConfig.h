@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Check.h"
+#include "Limits.h"
+#include "Types.h"
+
+#include <array>
+
+namespace Exchange
+{
+/* How the tickers are split between the matching engine's threads. All the requests of a ticker go to one shard, which
+ * processes them in the order the sequencer published them, so the responses and market updates of a ticker come out
+ * in the same order whatever the number of shards. Only the interleaving of different tickers depends on timing */
+struct ShardConfig
+{
+    u32 numShards = 1;
+    std::array<u32, ME_MAX_TICKERS> tickerToShard{};
+    /* Core each shard's thread is pinned to, -1 leaves it to the OS */
+    std::array<i32, ME_MAX_MATCHING_SHARDS> cores;
+
+    ShardConfig()
+    {
+        cores.fill(-1);
+    }
+
+    /* Ticker i goes to shard i % numShards */
+    static ShardConfig RoundRobin(u32 numShards)
+    {
+        CHECK_FATAL(numShards >= 1 && numShards <= ME_MAX_MATCHING_SHARDS, "Invalid number of matching shards ",
+                    numShards);
+        ShardConfig config;
+        config.numShards = numShards;
+        for (TickerId tickerId = 0; tickerId < ME_MAX_TICKERS; ++tickerId)
+        {
+            config.tickerToShard[tickerId] = tickerId % numShards;
+        }
+        return config;
+    }
+
+    /* Requests for a ticker that isn't listed go to the first shard, which drops them */
+    u32 GetShard(TickerId tickerId) const
+    {
+        return tickerId < ME_MAX_TICKERS ? tickerToShard[tickerId] : 0;
+    }
+
+    void Validate() const
+    {
+        CHECK_FATAL(numShards >= 1 && numShards <= ME_MAX_MATCHING_SHARDS, "Invalid number of matching shards ",
+                    numShards);
+        for (TickerId tickerId = 0; tickerId < ME_MAX_TICKERS; ++tickerId)
+        {
+            CHECK_FATAL(tickerToShard[tickerId] < numShards, "Ticker ", tickerId, " is mapped to shard ",
+                        tickerToShard[tickerId], " out of ", numShards);
+        }
+    }
+};
+
+} // namespace Exchange
@@ -0,0 +1,102 @@
+#include "ShardedMatchingEngine.h"
+
+namespace Exchange
+{
+ShardedMatchingEngine::Shard::Shard(ShardConfig const &shardConfig, u32 shard, MemoryOptions const &memoryOptions)
+    : memoryOptions(memoryOptions.ForCpu(shardConfig.cores[shard])),
+      clientRequests(ME_MAX_CLIENT_UPDATES, this->memoryOptions),
+      clientResponses(ME_MAX_CLIENT_UPDATES, this->memoryOptions),
+      marketUpdates(ME_MAX_MARKET_UPDATES, this->memoryOptions),
+      matchingEngine(&clientRequests, &clientResponses, &marketUpdates, shardConfig, shard, this->memoryOptions)
+{
+}
+
+ShardedMatchingEngine::ShardedMatchingEngine(ShardConfig const &shardConfig, MemoryOptions const &memoryOptions)
+    : mShardConfig(shardConfig)
+{
+    mShardConfig.Validate();
+    for (u32 shard = 0; shard < mShardConfig.numShards; ++shard)
+    {
+        mShards.push_back(std::make_unique<Shard>(mShardConfig, shard, memoryOptions));
+    }
+}
+
+void ShardedMatchingEngine::Start()
+{
+    if (mCheckpointWriter != nullptr)
+    {
+        mCheckpointWriter->Start();
+    }
+    for (auto &shard : mShards)
+    {
+        shard->matchingEngine.Start();
+    }
+}
+
+void ShardedMatchingEngine::Stop()
+{
+    for (auto &shard : mShards)
+    {
+        shard->matchingEngine.Stop();
+    }
+    if (mCheckpointWriter != nullptr)
+    {
+        mCheckpointWriter->Stop();
+    }
+}
+
+CheckpointInfo ShardedMatchingEngine::LoadCheckpoint(std::string const &directory)
+{
+    const auto path = FindLatestCheckpoint(directory);
+    if (path.empty())
+    {
+        return {};
+    }
+
+    /* Books go to whichever shard has their ticker now, the shard config may have changed since the checkpoint */
+    return ReadCheckpoint(path, [this](TickerId tickerId) {
+        return mShards[mShardConfig.GetShard(tickerId)]->matchingEngine.GetOrderBook(tickerId);
+    });
+}
+
+void ShardedMatchingEngine::EnableCheckpoints(std::string const &directory, u64 nextMarketDataSequenceNumber)
+{
+    mCheckpointWriter = std::make_unique<CheckpointWriter>(directory, mShardConfig.numShards,
+                                                           nextMarketDataSequenceNumber);
+    for (auto &shard : mShards)
+    {
+        shard->matchingEngine.SetCheckpointWriter(mCheckpointWriter.get());
+    }
+}
+
+std::vector<MEClientRequestQueue *> ShardedMatchingEngine::GetClientRequestQueues() const
+{
+    std::vector<MEClientRequestQueue *> queues;
+    for (auto &shard : mShards)
+    {
+        queues.push_back(&shard->clientRequests);
+    }
+    return queues;
+}
+
+std::vector<MEClientResponseQueue *> ShardedMatchingEngine::GetClientResponseQueues() const
+{
+    std::vector<MEClientResponseQueue *> queues;
+    for (auto &shard : mShards)
+    {
+        queues.push_back(&shard->clientResponses);
+    }
+    return queues;
+}
+
+std::vector<MEMarketUpdateQueue *> ShardedMatchingEngine::GetMarketUpdateQueues() const
+{
+    std::vector<MEMarketUpdateQueue *> queues;
+    for (auto &shard : mShards)
+    {
+        queues.push_back(&shard->marketUpdates);
+    }
+    return queues;
+}
+
+} // namespace Exchange
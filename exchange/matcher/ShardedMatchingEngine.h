@@ -0,0 +1,67 @@
+#pragma once
+
+#include "MappedMemory.h"
+#include "MarketUpdate.h"
+#include "exchange/matcher/Checkpoint.h"
+#include "exchange/matcher/MatchingEngine.h"
+#include "exchange/matcher/ShardConfig.h"
+#include "exchange/order_server/ClientRequest.h"
+#include "exchange/order_server/ClientResponse.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Exchange
+{
+/* The matching engine split across the threads of a shard config. Every shard has its own request queue, fed by the
+ * sequencer, and its own response and market update queues, drained by the order server and the market data
+ * publisher. Nothing is shared between the shards, so they never wait on each other */
+class ShardedMatchingEngine
+{
+public:
+    explicit ShardedMatchingEngine(ShardConfig const &shardConfig, MemoryOptions const &memoryOptions = {});
+
+    ShardedMatchingEngine() = delete;
+    ShardedMatchingEngine(const ShardedMatchingEngine &) = delete;
+    ShardedMatchingEngine(const ShardedMatchingEngine &&) = delete;
+    ShardedMatchingEngine &operator=(const ShardedMatchingEngine &) = delete;
+    ShardedMatchingEngine &operator=(const ShardedMatchingEngine &&) = delete;
+
+    void Start();
+    void Stop();
+
+    /* Restores the books from the most recent checkpoint of the directory, if there is one. Must come before Start */
+    CheckpointInfo LoadCheckpoint(std::string const &directory);
+    /* Checkpoint requests are written to the directory from then on. Must come before Start */
+    void EnableCheckpoints(std::string const &directory, u64 nextMarketDataSequenceNumber);
+
+    ShardConfig const &GetShardConfig() const
+    {
+        return mShardConfig;
+    }
+
+    /* Indexed by shard */
+    std::vector<MEClientRequestQueue *> GetClientRequestQueues() const;
+    std::vector<MEClientResponseQueue *> GetClientResponseQueues() const;
+    std::vector<MEMarketUpdateQueue *> GetMarketUpdateQueues() const;
+
+private:
+    struct Shard
+    {
+        Shard(ShardConfig const &shardConfig, u32 shard, MemoryOptions const &memoryOptions);
+
+        /* Everything is built on the caller's thread, so the node comes from the core the shard will run on */
+        MemoryOptions memoryOptions;
+        MEClientRequestQueue clientRequests;
+        MEClientResponseQueue clientResponses;
+        MEMarketUpdateQueue marketUpdates;
+        MatchingEngine matchingEngine;
+    };
+
+    ShardConfig mShardConfig;
+    /* Outlives the shards, their threads may still be checkpointing while they are destroyed */
+    std::unique_ptr<CheckpointWriter> mCheckpointWriter;
+    std::vector<std::unique_ptr<Shard>> mShards;
+};
+} // namespace Exchange
@@ -12,7 +12,15 @@ enum class ClientRequestType : u8
 {
     INVALID = 0,
     NEW = 1,
-    CANCEL = 2
+    CANCEL = 2,
+    /* Gives the resting order orderId the price and the open quantity of the request, keeping its ids */
+    MODIFY = 3,
+    /* Cancels every order of the client, in one ticker unless tickerId is TickerId_INVALID and on one side unless side
+     * is Side::INVALID */
+    MASS_CANCEL = 4,
+    /* Internal, never accepted from a client: every matching shard checkpoints its books when it gets to it. orderId
+     * holds the sequence number of the first request journaled after it */
+    CHECKPOINT = 5
 };
 
 inline auto ClientRequestTypeToString(ClientRequestType request) -> std::string
@@ -25,6 +33,12 @@ inline auto ClientRequestTypeToString(ClientRequestType request) -> std::string
         return "NEW";
     case ClientRequestType::CANCEL:
         return "CANCEL";
+    case ClientRequestType::MODIFY:
+        return "MODIFY";
+    case ClientRequestType::MASS_CANCEL:
+        return "MASS_CANCEL";
+    case ClientRequestType::CHECKPOINT:
+        return "CHECKPOINT";
     }
     return "UNKNOWN";
 }
@@ -60,24 +74,6 @@ struct MEClientRequest
     }
 };
 
-struct OMClientRequest
-{
-    u64 sequenceNumber = 0;
-    MEClientRequest clientRequest;
-
-    inline auto ToString() const -> std::string
-    {
-        std::stringstream ss;
-
-        ss << "OMClientRequest {\n";
-        ss << "\tsequenceNumber : " << sequenceNumber << '\n';
-        ss << "\tclientRequest : " << clientRequest.ToString(1) << "\n";
-        ss << "}";
-
-        return ss.str();
-    }
-};
-
 #pragma pack(pop)
 
 using MEClientRequestQueue = SafeQueue<MEClientRequest>;
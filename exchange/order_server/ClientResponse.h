@@ -14,6 +14,11 @@ enum class ClientResponseType : u8
     CANCELED = 2,
     FILLED = 3,
     CANCEL_REJECTED = 4,
+    MODIFIED = 5,
+    /* Carries the order's market id if the order is still there, OrderId_INVALID if the exchange doesn't know it */
+    MODIFY_REJECTED = 6,
+    /* One per book a mass cancel went through, whatever the number of orders it cancelled there */
+    MASS_CANCELED = 7,
 };
 
 inline auto ClientResponseTypeToString(ClientResponseType type) -> std::string
@@ -30,6 +35,12 @@ inline auto ClientResponseTypeToString(ClientResponseType type) -> std::string
         return "FILLED";
     case ClientResponseType::CANCEL_REJECTED:
         return "CANCEL_REJECTED";
+    case ClientResponseType::MODIFIED:
+        return "MODIFIED";
+    case ClientResponseType::MODIFY_REJECTED:
+        return "MODIFY_REJECTED";
+    case ClientResponseType::MASS_CANCELED:
+        return "MASS_CANCELED";
     }
     return "UNKNOWN";
 }
@@ -68,24 +79,6 @@ struct MEClientResponse
     };
 };
 
-struct OMClientResponse
-{
-    u64 sequenceNumber = 0;
-    MEClientResponse clientResponse;
-
-    inline auto ToString() const -> std::string
-    {
-        std::stringstream ss;
-
-        ss << "OMClientResponse {\n";
-        ss << "\tsequenceNumber : " << sequenceNumber << '\n';
-        ss << "\tclientResponse : " << clientResponse.ToString(1) << "\n";
-        ss << "}";
-
-        return ss.str();
-    }
-};
-
 #pragma pack(pop)
 
 using MEClientResponseQueue = SafeQueue<MEClientResponse>;
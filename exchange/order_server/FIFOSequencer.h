@@ -4,31 +4,76 @@
 #include "Limits.h"
 #include "Logger.h"
 #include "TimeUtils.h"
+#include "exchange/matcher/ShardConfig.h"
 #include "exchange/order_server/ClientRequest.h"
+#include "exchange/order_server/Journal.h"
+
+#include <algorithm>
+#include <array>
+#include <compare>
+#include <functional>
+#include <utility>
+#include <vector>
 
 namespace Exchange
 {
 class FIFOSequencer
 {
 public:
-    FIFOSequencer(MEClientRequestQueue *clientRequests, QuickLogger *logger)
-        : mLogger(logger), mClientRequests(clientRequests)
+    /* clientRequests holds the request queue of every matching shard. Every request published is also copied to the
+     * journal's queue, if there is one */
+    FIFOSequencer(std::vector<MEClientRequestQueue *> const &clientRequests, ShardConfig const &shardConfig,
+                  QuickLogger *logger, Journal *journal = nullptr)
+        : mLogger(logger), mClientRequests(clientRequests), mShardConfig(shardConfig),
+          mJournal(journal != nullptr ? journal->GetQueue() : nullptr),
+          mNextJournalSequenceNumber(journal != nullptr ? journal->GetNextSequenceNumber() : 1)
     {
+        CHECK_FATAL(mClientRequests.size() == mShardConfig.numShards, "Expected one request queue per shard");
     }
     ~FIFOSequencer()
     {
     }
 
+    /* Called over and over while a queue SequenceAndPublish writes to is full. A shard waiting for room for its
+     * responses doesn't read its requests, so whoever drains the responses must do it here too */
+    std::function<void()> waitCallback = [] {};
+
     FIFOSequencer() = delete;
     FIFOSequencer(const FIFOSequencer &) = delete;
     FIFOSequencer(const FIFOSequencer &&) = delete;
     FIFOSequencer &operator=(const FIFOSequencer &) = delete;
     FIFOSequencer &operator=(const FIFOSequencer &&) = delete;
 
-    void AddClientRequest(Nanos recvTime, MEClientRequest &request)
+    /* The requests of a client arrive on its connection in receive time order, so they are kept as one run per client
+     * and SequenceAndPublish only has to merge the runs. A request can't wait behind ME_MAX_PENDING_REQUESTS others
+     * or for more than ME_SEQUENCER_MAX_WAIT_US of newer ones: the batch is published before it grows past that */
+    void AddClientRequest(Nanos recvTime, MEClientRequest const &request)
     {
-        CHECK_FATAL(mPendingSize < ME_MAX_PENDING_REQUESTS, "Too many pending requests");
-        mPendingRequests[mPendingSize++] = {recvTime, request};
+        if (mPendingSize == ME_MAX_PENDING_REQUESTS ||
+            (mPendingSize != 0 && recvTime - mOldestRecvTime >= ME_SEQUENCER_MAX_WAIT_US * NANOS_TO_MICROS)) [[unlikely]]
+        {
+            SequenceAndPublish();
+        }
+
+        const auto index = mPendingSize++;
+        mPendingRequests[index] = {recvTime, request, NO_REQUEST};
+        mOldestRecvTime = index == 0 ? recvTime : std::min(mOldestRecvTime, recvTime);
+
+        auto &run = mRuns[request.clientId % ME_MAX_NUM_CLIENTS];
+        if (run.first == NO_REQUEST)
+        {
+            run.first = run.last = index;
+            mActiveRuns[mNumActiveRuns++] = request.clientId % ME_MAX_NUM_CLIENTS;
+        }
+        else if (mPendingRequests[run.last].recvTime <= recvTime) [[likely]]
+        {
+            mPendingRequests[run.last].next = index;
+            run.last = index;
+        }
+        else
+        {
+            InsertOutOfOrder(run, index);
+        }
     }
 
     void SequenceAndPublish()
@@ -38,40 +83,241 @@ public:
             return;
         }
 
-        mLogger->Log("Reordering ", mPendingSize, " requests\n");
-
-        std::sort(mPendingRequests.begin(), mPendingRequests.begin() + mPendingSize);
+        QLOG_TRACE(*mLogger, "Sequencing {} requests from {} clients\n", mPendingSize, mNumActiveRuns);
+        Merge();
 
+        /* Each request goes to the shard of its ticker, so every shard sees its tickers' requests in time order. The
+           journal gets them in the same order */
+        std::array<u32, ME_MAX_MATCHING_SHARDS> numRouted{};
+        u32 numJournaled = 0;
         for (u32 i = 0; i < mPendingSize; ++i)
         {
-            auto clientRequest = mPendingRequests[i];
+            auto &clientRequest = mPendingRequests[mSequence[i]];
+            const auto &request = clientRequest.clientRequest;
+            if (mJournal != nullptr)
+            {
+                /* Only waits when the journal thread is a whole queue behind */
+                auto record = mJournal->TryGetNextWriteTo(numJournaled);
+                while (record == nullptr) [[unlikely]]
+                {
+                    Publish(numRouted, numJournaled);
+                    waitCallback();
+                    record = mJournal->TryGetNextWriteTo(numJournaled);
+                }
+                record->recvTime = clientRequest.recvTime;
+                record->request = request;
+                ++numJournaled;
+            }
+
+            const auto [firstShard, endShard] = GetShards(request);
+            for (auto shard = firstShard; shard < endShard; ++shard)
+            {
+                QLOG_TRACE(*mLogger, "Writing request of client {} order {} to the FIFO of shard {} (recv time = {})\n",
+                           request.clientId, request.orderId, shard, clientRequest.recvTime);
+                /* A shard a whole queue behind first gets what is already routed to it, then is waited for */
+                auto slot = mClientRequests[shard]->TryGetNextWriteTo(numRouted[shard]);
+                while (slot == nullptr) [[unlikely]]
+                {
+                    Publish(numRouted, numJournaled);
+                    waitCallback();
+                    slot = mClientRequests[shard]->TryGetNextWriteTo(numRouted[shard]);
+                }
+                *slot = request;
+                ++numRouted[shard];
+            }
+        }
 
-            mLogger->Log("Writing request ", clientRequest.clientRequest.ToString(),
-                         " to  FIFO (recv time = ", clientRequest.recvTime, ")\n");
-            auto nextWrite = mClientRequests->GetNextWriteTo();
-            *nextWrite = std::move(clientRequest.clientRequest);
-            mClientRequests->UpdateWriteIndex();
+        /* Publish the whole sorted batch at once, one index update per shard */
+        Publish(numRouted, numJournaled);
+        if (mJournal != nullptr)
+        {
+            mNextJournalSequenceNumber += mPendingSize;
         }
 
+        for (u32 i = 0; i < mNumActiveRuns; ++i)
+        {
+            mRuns[mActiveRuns[i]] = {};
+        }
+        mNumActiveRuns = 0;
         mPendingSize = 0;
     }
 
+    /* Puts a checkpoint request behind everything sequenced so far, so every shard checkpoints its books at the same
+     * point of the journal. Returns false, for the caller to try again later, while a shard's queue is full */
+    bool Checkpoint()
+    {
+        SequenceAndPublish();
+        if (mNextJournalSequenceNumber == mLastCheckpoint)
+        {
+            /* Nothing happened since the last one */
+            return true;
+        }
+
+        MEClientRequest checkpoint;
+        checkpoint.type = ClientRequestType::CHECKPOINT;
+        checkpoint.orderId = mNextJournalSequenceNumber;
+        if (!TryRoute(checkpoint))
+        {
+            return false;
+        }
+        mLastCheckpoint = mNextJournalSequenceNumber;
+        return true;
+    }
+
+    /* Routes a request straight away, without journaling it: a request read back from the journal goes where it went
+     * the first time. Returns false, having routed nothing, while a queue it goes to is full */
+    bool TryRoute(MEClientRequest const &request)
+    {
+        const auto [firstShard, endShard] = GetShards(request);
+        for (auto shard = firstShard; shard < endShard; ++shard)
+        {
+            if (mClientRequests[shard]->TryGetNextWriteTo() == nullptr)
+            {
+                return false;
+            }
+        }
+
+        for (auto shard = firstShard; shard < endShard; ++shard)
+        {
+            *mClientRequests[shard]->GetNextWriteTo() = request;
+            mClientRequests[shard]->UpdateWriteIndex();
+        }
+        return true;
+    }
+
 private:
+    /* Makes the requests written by SequenceAndPublish so far visible and starts over. The journal's copy goes first */
+    void Publish(std::array<u32, ME_MAX_MATCHING_SHARDS> &numRouted, u32 &numJournaled)
+    {
+        if (numJournaled != 0)
+        {
+            mJournal->UpdateWriteIndex(numJournaled);
+            numJournaled = 0;
+        }
+        for (u32 shard = 0; shard < mShardConfig.numShards; ++shard)
+        {
+            if (numRouted[shard] != 0)
+            {
+                mClientRequests[shard]->UpdateWriteIndex(numRouted[shard]);
+                numRouted[shard] = 0;
+            }
+        }
+    }
+
+    /* A request goes to the shard of its ticker. A mass cancel that isn't limited to one ticker and a checkpoint go to
+     * every shard */
+    std::pair<u32, u32> GetShards(MEClientRequest const &request) const
+    {
+        const bool allTickers = request.type == ClientRequestType::MASS_CANCEL && request.tickerId == TickerId_INVALID;
+        const bool allShards = allTickers || request.type == ClientRequestType::CHECKPOINT;
+        const auto firstShard = allShards ? 0 : mShardConfig.GetShard(request.tickerId);
+        return {firstShard, allShards ? mShardConfig.numShards : firstShard + 1};
+    }
+
+private:
+    static constexpr u32 NO_REQUEST = ~u32(0);
+
+    struct Run
+    {
+        u32 first = NO_REQUEST;
+        u32 last = NO_REQUEST;
+    };
+
+    /* Only for requests whose client sent a newer one first, which a single connection doesn't do. The request goes
+     * after the ones received at the same time, like a stable sort would put it */
+    void InsertOutOfOrder(Run &run, u32 index)
+    {
+        const auto recvTime = mPendingRequests[index].recvTime;
+        if (recvTime < mPendingRequests[run.first].recvTime)
+        {
+            mPendingRequests[index].next = run.first;
+            run.first = index;
+            return;
+        }
+
+        auto previous = run.first;
+        while (mPendingRequests[mPendingRequests[previous].next].recvTime <= recvTime)
+        {
+            previous = mPendingRequests[previous].next;
+        }
+        mPendingRequests[index].next = mPendingRequests[previous].next;
+        mPendingRequests[previous].next = index;
+    }
+
+    /* Fills mSequence with the pending requests in receive time order, a k-way merge of the runs on a heap of their
+     * heads. Only indices move. Ties go to the request added first, the order of a stable sort */
+    void Merge()
+    {
+        u32 numSequenced = 0;
+        if (mNumActiveRuns == 1) [[likely]]
+        {
+            for (auto index = mRuns[mActiveRuns[0]].first; index != NO_REQUEST; index = mPendingRequests[index].next)
+            {
+                mSequence[numSequenced++] = index;
+            }
+            return;
+        }
+
+        u32 heapSize = 0;
+        for (u32 i = 0; i < mNumActiveRuns; ++i)
+        {
+            const auto first = mRuns[mActiveRuns[i]].first;
+            mHeap[heapSize++] = {mPendingRequests[first].recvTime, first};
+        }
+        std::make_heap(mHeap.begin(), mHeap.begin() + heapSize, std::greater<>());
+
+        while (heapSize != 0)
+        {
+            std::pop_heap(mHeap.begin(), mHeap.begin() + heapSize, std::greater<>());
+            auto &head = mHeap[heapSize - 1];
+            mSequence[numSequenced++] = head.index;
+
+            const auto next = mPendingRequests[head.index].next;
+            if (next == NO_REQUEST)
+            {
+                --heapSize;
+                continue;
+            }
+            head = {mPendingRequests[next].recvTime, next};
+            std::push_heap(mHeap.begin(), mHeap.begin() + heapSize, std::greater<>());
+        }
+        DCHECK_FATAL(numSequenced == mPendingSize, "Merged ", numSequenced, " of ", mPendingSize, " requests");
+    }
+
     QuickLogger *mLogger;
-    MEClientRequestQueue *mClientRequests;
+    std::vector<MEClientRequestQueue *> mClientRequests;
+    ShardConfig mShardConfig;
+    JournalQueue *mJournal;
+    u64 mNextJournalSequenceNumber;
+    u64 mLastCheckpoint = 0;
 
-    struct RecvTimeClientRequest
+    struct PendingRequest
     {
         Nanos recvTime;
         MEClientRequest clientRequest;
+        /* Next request of the same run */
+        u32 next;
+    };
 
-        bool operator<(const RecvTimeClientRequest &rhs) const
-        {
-            return recvTime < rhs.recvTime;
-        }
+    /* The requests stay where they were added, the merge orders their indices */
+    std::array<PendingRequest, ME_MAX_PENDING_REQUESTS> mPendingRequests;
+    u32 mPendingSize = 0;
+    Nanos mOldestRecvTime = 0;
+
+    /* Runs are per client, with client ids out of range sharing them */
+    std::array<Run, ME_MAX_NUM_CLIENTS> mRuns;
+    std::array<u32, ME_MAX_NUM_CLIENTS> mActiveRuns;
+    u32 mNumActiveRuns = 0;
+
+    struct HeapEntry
+    {
+        Nanos recvTime;
+        u32 index;
+
+        auto operator<=>(HeapEntry const &) const = default;
     };
 
-    std::array<RecvTimeClientRequest, ME_MAX_PENDING_REQUESTS> mPendingRequests;
-    u32 mPendingSize;
+    std::array<HeapEntry, ME_MAX_NUM_CLIENTS> mHeap;
+    std::array<u32, ME_MAX_PENDING_REQUESTS> mSequence;
 };
 } // namespace Exchange
\ No newline at end of file
@@ -0,0 +1,357 @@
+#include "Journal.h"
+#include "Check.h"
+#include "MappedMemory.h"
+#include "ThreadUtils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr char SEGMENT_PREFIX[] = "journal_";
+constexpr char SEGMENT_SUFFIX[] = ".bin";
+
+auto GetSegmentPath(std::string const &directory, u64 firstSequenceNumber) -> std::string
+{
+    /* Zero padded, so the names sort like the sequence numbers */
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s%020llu%s", SEGMENT_PREFIX,
+                  static_cast<unsigned long long>(firstSequenceNumber), SEGMENT_SUFFIX);
+    return directory + "/" + name;
+}
+
+/* Maps the whole file. A new file is allocated in full first, so writing to the mapping never runs out of disk */
+auto MapFile(std::string const &path, bool writable, bool create, u64 &size) -> char *
+{
+    const int flags = writable ? (O_RDWR | (create ? O_CREAT | O_EXCL : 0)) : O_RDONLY;
+    const int fd = open(path.c_str(), flags, 0644);
+    CHECK_FATAL(fd >= 0, "Unable to open journal segment ", path, ": ", strerror(errno));
+
+    if (create)
+    {
+        const auto error = posix_fallocate(fd, 0, static_cast<off_t>(size));
+        CHECK_FATAL(error == 0, "Unable to allocate journal segment ", path, ": ", strerror(error));
+    }
+    else
+    {
+        struct stat fileStat;
+        CHECK_FATAL(fstat(fd, &fileStat) == 0, "Unable to stat journal segment ", path, ": ", strerror(errno));
+        size = static_cast<u64>(fileStat.st_size);
+    }
+    CHECK_FATAL(size >= sizeof(Exchange::JournalSegmentHeader), "Journal segment ", path, " is truncated");
+
+    const int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    auto memory = mmap(nullptr, size, protection, MAP_SHARED | MAP_POPULATE, fd, 0);
+    CHECK_FATAL(memory != MAP_FAILED, "Unable to map journal segment ", path, ": ", strerror(errno));
+    close(fd);
+
+    /* Only honoured where the file system can back files with huge pages, like tmpfs mounted with huge=advise */
+    madvise(memory, size, writable ? MADV_HUGEPAGE : MADV_SEQUENTIAL);
+    return static_cast<char *>(memory);
+}
+
+/* Segments are named after their first record */
+auto GetFirstSequenceNumber(std::string const &path) -> u64
+{
+    const auto name = std::filesystem::path(path).filename().string();
+    return std::strtoull(name.c_str() + sizeof(SEGMENT_PREFIX) - 1, nullptr, 10);
+}
+
+void CheckHeader(Exchange::JournalSegmentHeader const &header, std::string const &path)
+{
+    CHECK_FATAL(header.magic == Exchange::JournalSegmentHeader::MAGIC, path, " is not a journal segment");
+    CHECK_FATAL(header.version == Exchange::JournalSegmentHeader::VERSION, "Journal segment ", path, " has version ",
+                header.version);
+    CHECK_FATAL(header.recordSize == sizeof(Exchange::JournalRecord), "Journal segment ", path, " has records of ",
+                header.recordSize, " bytes");
+}
+} // namespace
+
+namespace Exchange
+{
+Journal::Journal(std::string const &directory, u64 segmentSize)
+    : mDirectory(directory), mSegmentSize(segmentSize), mRecords(ME_JOURNAL_QUEUE_SIZE), mLogger("exchange_journal.log")
+{
+    CHECK_FATAL(mSegmentSize % PAGE_SIZE == 0 && mSegmentSize >= sizeof(JournalSegmentHeader) + sizeof(JournalRecord),
+                "Journal segments must be whole pages with room for a record");
+
+    std::error_code error;
+    std::filesystem::create_directories(mDirectory, error);
+    CHECK_FATAL(!error, "Unable to create journal directory ", mDirectory, ": ", error.message());
+
+    const auto segments = JournalReader::ListSegments(mDirectory);
+    if (segments.empty())
+    {
+        CreateSegment();
+        return;
+    }
+
+    /* Carry on in the last segment, after its last complete record */
+    MapSegment(segments.back(), false);
+    mLogger.Log("Journal ", mDirectory, " continues at sequence number ", mNextSequenceNumber, "\n");
+}
+
+Journal::~Journal()
+{
+    Stop();
+    CloseSegment();
+}
+
+void Journal::Start()
+{
+    mShouldStop = false;
+    mRunningThread = CreateAndStartThread(HOUSEKEEPING_CORE, "Exchange/Journal", [this]() { Run(); });
+    CHECK_FATAL(mRunningThread != nullptr, "Unable to start the journal thread");
+}
+
+void Journal::Stop()
+{
+    mShouldStop = true;
+    if (mRunningThread && mRunningThread->joinable())
+    {
+        mRunningThread->join();
+    }
+    mRunningThread.reset();
+
+    for (auto records = mRecords.GetNextReadSpan(ME_JOURNAL_QUEUE_SIZE); !records.empty();
+         records = mRecords.GetNextReadSpan(ME_JOURNAL_QUEUE_SIZE))
+    {
+        for (auto const &record : records)
+        {
+            Append(record);
+        }
+        mRecords.UpdateReadIndex(records.size());
+    }
+    Sync(true);
+
+    mLogger.Log("Journal queue: capacity = ", mRecords.GetCapacity(),
+                "; high water mark = ", mRecords.GetHighWaterMark(),
+                "; next sequence number = ", mNextSequenceNumber, "\n");
+}
+
+void Journal::Run()
+{
+    mLastSync = GetCurrentNanos();
+    while (!mShouldStop)
+    {
+        auto records = mRecords.GetNextReadSpan(ME_JOURNAL_QUEUE_SIZE);
+        for (auto const &record : records)
+        {
+            Append(record);
+        }
+        if (!records.empty())
+        {
+            mRecords.UpdateReadIndex(records.size());
+        }
+
+        /* Hand the new pages to the kernel now and then instead of letting them pile up until munmap */
+        if (GetCurrentNanos() - mLastSync >= ME_JOURNAL_SYNC_INTERVAL_MS * NANOS_TO_MILLIS)
+        {
+            Sync(false);
+        }
+
+        /* Keep going while there's work, otherwise wake up once per millisecond at most */
+        if (records.empty())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+void Journal::Append(JournalRecord const &record)
+{
+    if (mWriteOffset + sizeof(JournalRecord) > mMappedSize) [[unlikely]]
+    {
+        CloseSegment();
+        CreateSegment();
+    }
+
+    /* The sequence number goes in last, so a record cut short by a crash doesn't look complete */
+    auto destination = mSegment + mWriteOffset;
+    std::memcpy(destination + sizeof(u64), reinterpret_cast<char const *>(&record) + sizeof(u64),
+                sizeof(JournalRecord) - sizeof(u64));
+    std::atomic_signal_fence(std::memory_order_release);
+    std::memcpy(destination, &mNextSequenceNumber, sizeof(u64));
+
+    ++mNextSequenceNumber;
+    mWriteOffset += sizeof(JournalRecord);
+}
+
+void Journal::CreateSegment()
+{
+    mMappedSize = mSegmentSize;
+    MapSegment(GetSegmentPath(mDirectory, mNextSequenceNumber), true);
+}
+
+void Journal::MapSegment(std::string const &path, bool create)
+{
+    mSegment = MapFile(path, true, create, mMappedSize);
+
+    auto header = reinterpret_cast<JournalSegmentHeader *>(mSegment);
+    if (create)
+    {
+        *header = JournalSegmentHeader();
+        header->firstSequenceNumber = mNextSequenceNumber;
+        mWriteOffset = sizeof(JournalSegmentHeader);
+        mSyncOffset = 0;
+        mLogger.Log("Created journal segment ", path, "\n");
+        return;
+    }
+
+    CheckHeader(*header, path);
+    mNextSequenceNumber = header->firstSequenceNumber;
+    mWriteOffset = JournalReader::FindEnd(mSegment, mMappedSize, mNextSequenceNumber);
+    mSyncOffset = mWriteOffset;
+}
+
+void Journal::CloseSegment()
+{
+    if (mSegment == nullptr)
+    {
+        return;
+    }
+
+    Sync(false);
+    munmap(mSegment, mMappedSize);
+    mSegment = nullptr;
+}
+
+void Journal::Sync(bool wait)
+{
+    mLastSync = GetCurrentNanos();
+    if (mSegment == nullptr || mSyncOffset == mWriteOffset)
+    {
+        return;
+    }
+
+    const auto start = mSyncOffset / PAGE_SIZE * PAGE_SIZE;
+    if (msync(mSegment + start, mWriteOffset - start, wait ? MS_SYNC : MS_ASYNC) != 0) [[unlikely]]
+    {
+        mLogger.Log("msync of the journal failed: ", strerror(errno), "\n");
+        return;
+    }
+    mSyncOffset = mWriteOffset;
+}
+
+JournalReader::JournalReader(std::string const &directory, u64 firstSequenceNumber)
+    : mSegments(ListSegments(directory))
+{
+    if (firstSequenceNumber == mNextSequenceNumber)
+    {
+        return;
+    }
+
+    while (mNextSegment + 1 < mSegments.size() &&
+           GetFirstSequenceNumber(mSegments[mNextSegment + 1]) <= firstSequenceNumber)
+    {
+        ++mNextSegment;
+    }
+    if (mNextSegment < mSegments.size())
+    {
+        mNextSequenceNumber = GetFirstSequenceNumber(mSegments[mNextSegment]);
+    }
+    while (mNextSequenceNumber < firstSequenceNumber && Next() != nullptr)
+        ;
+    CHECK_FATAL(mNextSequenceNumber == firstSequenceNumber, "The journal in ", directory, " stops at ",
+                mNextSequenceNumber, " before record ", firstSequenceNumber);
+}
+
+JournalReader::~JournalReader()
+{
+    CloseSegment();
+}
+
+JournalRecord const *JournalReader::Next()
+{
+    while (true)
+    {
+        if (mSegment != nullptr && mReadOffset + sizeof(JournalRecord) <= mSegmentSize)
+        {
+            auto record = reinterpret_cast<JournalRecord const *>(mSegment + mReadOffset);
+            if (record->sequenceNumber == mNextSequenceNumber)
+            {
+                ++mNextSequenceNumber;
+                mReadOffset += sizeof(JournalRecord);
+                return record;
+            }
+        }
+
+        if (!OpenNextSegment())
+        {
+            return nullptr;
+        }
+    }
+}
+
+bool JournalReader::OpenNextSegment()
+{
+    if (mNextSegment == mSegments.size())
+    {
+        return false;
+    }
+
+    CloseSegment();
+    auto const &path = mSegments[mNextSegment++];
+    mSegment = MapFile(path, false, false, mSegmentSize);
+    mReadOffset = sizeof(JournalSegmentHeader);
+
+    /* Replaying past a gap would build different books, so a journal with one is not replayed at all */
+    auto header = reinterpret_cast<JournalSegmentHeader const *>(mSegment);
+    CheckHeader(*header, path);
+    CHECK_FATAL(header->firstSequenceNumber == mNextSequenceNumber, "Journal segment ", path, " starts at ",
+                header->firstSequenceNumber, " instead of ", mNextSequenceNumber);
+    return true;
+}
+
+void JournalReader::CloseSegment()
+{
+    if (mSegment != nullptr)
+    {
+        munmap(const_cast<char *>(mSegment), mSegmentSize);
+        mSegment = nullptr;
+    }
+}
+
+std::vector<std::string> JournalReader::ListSegments(std::string const &directory)
+{
+    std::vector<std::string> segments;
+    std::error_code error;
+    for (auto const &entry : std::filesystem::directory_iterator(directory, error))
+    {
+        const auto name = entry.path().filename().string();
+        if (name.starts_with(SEGMENT_PREFIX) && name.ends_with(SEGMENT_SUFFIX))
+        {
+            segments.push_back(entry.path().string());
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+u64 JournalReader::FindEnd(char const *segment, u64 size, u64 &nextSequenceNumber)
+{
+    u64 offset = sizeof(JournalSegmentHeader);
+    for (; offset + sizeof(JournalRecord) <= size; offset += sizeof(JournalRecord))
+    {
+        u64 sequenceNumber;
+        std::memcpy(&sequenceNumber, segment + offset, sizeof(sequenceNumber));
+        if (sequenceNumber != nextSequenceNumber)
+        {
+            break;
+        }
+        ++nextSequenceNumber;
+    }
+    return offset;
+}
+
+} // namespace Exchange
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "Limits.h"
+#include "Logger.h"
+#include "SafeQueue.h"
+#include "TimeUtils.h"
+#include "Types.h"
+#include "exchange/order_server/ClientRequest.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Exchange
+{
+/* Append-only record of every request the sequencer published, in the order the matching shards got them. Replaying
+ * it into empty books rebuilds them as they were.
+ * The journal is a directory of segment files named after the sequence number of their first record. A segment is a
+ * header followed by fixed size records and is allocated in full when it is created, so the records after the last one
+ * written are zeros. */
+
+#pragma pack(push, 1)
+
+struct JournalRecord
+{
+    /* Numbers the records from 1, across segments. Written last, a record with the wrong sequence number was never
+     * completed */
+    u64 sequenceNumber = 0;
+    Nanos recvTime = 0;
+    MEClientRequest request;
+};
+
+#pragma pack(pop)
+
+struct JournalSegmentHeader
+{
+    static constexpr u64 MAGIC = 0x4c4e524a5851454dull;
+    static constexpr u32 VERSION = 1;
+
+    u64 magic = MAGIC;
+    u32 version = VERSION;
+    u32 recordSize = sizeof(JournalRecord);
+    u64 firstSequenceNumber = 0;
+    u64 reserved[5] = {};
+};
+static_assert(sizeof(JournalSegmentHeader) == 64, "The records start on the second cache line of a segment");
+
+using JournalQueue = SafeQueue<JournalRecord>;
+
+/* Writes the records the sequencer pushes on its queue from a thread of its own. The sequencer only copies each
+ * request into the queue, the matching shards never wait on the journal */
+class Journal
+{
+public:
+    /* Carries on after the last record already in the directory. segmentSize is for tests, segments are normally
+     * ME_JOURNAL_SEGMENT_SIZE */
+    explicit Journal(std::string const &directory, u64 segmentSize = ME_JOURNAL_SEGMENT_SIZE);
+    ~Journal();
+
+    Journal() = delete;
+    Journal(const Journal &) = delete;
+    Journal(const Journal &&) = delete;
+    Journal &operator=(const Journal &) = delete;
+    Journal &operator=(const Journal &&) = delete;
+
+    void Start();
+    /* Writes what is still queued and waits for it to reach the disk */
+    void Stop();
+
+    /* Filled by the sequencer. The journal gives the records their sequence number */
+    JournalQueue *GetQueue()
+    {
+        return &mRecords;
+    }
+
+    /* Sequence number of the next record written */
+    u64 GetNextSequenceNumber() const
+    {
+        return mNextSequenceNumber;
+    }
+
+private:
+    void Run();
+    void Append(JournalRecord const &record);
+    void CreateSegment();
+    void MapSegment(std::string const &path, bool create);
+    void CloseSegment();
+    void Sync(bool wait);
+
+private:
+    std::string mDirectory;
+    u64 mSegmentSize;
+
+    JournalQueue mRecords;
+
+    char *mSegment = nullptr;
+    u64 mMappedSize = 0;
+    u64 mWriteOffset = 0;
+    /* Start of what hasn't been handed to msync yet */
+    u64 mSyncOffset = 0;
+    Nanos mLastSync = 0;
+
+    u64 mNextSequenceNumber = 1;
+
+    QuickLogger mLogger;
+
+    volatile bool mShouldStop = true;
+    std::unique_ptr<std::thread> mRunningThread;
+};
+
+/* Reads the records of a journal directory back in sequence, for replay */
+class JournalReader
+{
+public:
+    /* Starts at record firstSequenceNumber, the segments before the one holding it aren't even opened */
+    explicit JournalReader(std::string const &directory, u64 firstSequenceNumber = 1);
+    ~JournalReader();
+
+    JournalReader() = delete;
+    JournalReader(const JournalReader &) = delete;
+    JournalReader(const JournalReader &&) = delete;
+    JournalReader &operator=(const JournalReader &) = delete;
+    JournalReader &operator=(const JournalReader &&) = delete;
+
+    /* Returns nullptr after the last complete record. The record stays valid until the next call */
+    JournalRecord const *Next();
+
+    /* Sequence number the record after the last one read has, or would have */
+    u64 GetNextSequenceNumber() const
+    {
+        return mNextSequenceNumber;
+    }
+
+    /* Segment files of the directory, oldest first */
+    static std::vector<std::string> ListSegments(std::string const &directory);
+
+    /* Offset of the first record of a segment that isn't complete or doesn't follow nextSequenceNumber - 1, which is
+     * advanced over the records before it */
+    static u64 FindEnd(char const *segment, u64 size, u64 &nextSequenceNumber);
+
+private:
+    bool OpenNextSegment();
+    void CloseSegment();
+
+private:
+    std::vector<std::string> mSegments;
+    std::size_t mNextSegment = 0;
+
+    char const *mSegment = nullptr;
+    u64 mSegmentSize = 0;
+    u64 mReadOffset = 0;
+
+    u64 mNextSequenceNumber = 1;
+};
+
+} // namespace Exchange
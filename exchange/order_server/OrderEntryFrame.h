@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Check.h"
+#include "Limits.h"
+#include "TCPSocket.h"
+#include "Types.h"
+
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <sstream>
+#include <string>
+
+namespace Exchange
+{
+/* Order entry messages travel in frames: a header, then numMessages MEClientRequest (to the exchange) or
+ * MEClientResponse (from it) back to back. Sequence numbers count frames, per client and direction, so a batch is
+ * checked and logged once however many messages it carries. A single message is a frame of one */
+
+#pragma pack(push, 1)
+
+struct OMFrameHeader
+{
+    u64 sequenceNumber = 0;
+    u8 numMessages = 0;
+
+    inline auto ToString() const -> std::string
+    {
+        std::stringstream ss;
+
+        ss << "OMFrameHeader {\n";
+        ss << "\tsequenceNumber : " << sequenceNumber << '\n';
+        ss << "\tnumMessages : " << static_cast<u32>(numMessages) << '\n';
+        ss << "}";
+
+        return ss.str();
+    }
+};
+
+#pragma pack(pop)
+
+static_assert(ME_MAX_FRAME_MESSAGES <= 255, "The message count of a frame is a u8");
+
+template <typename Message> constexpr std::size_t GetFrameSize(std::size_t numMessages)
+{
+    return sizeof(OMFrameHeader) + numMessages * sizeof(Message);
+}
+
+/* Queues one frame on the socket. The header is copied, the messages are sent from where they are and must stay there
+ * until the socket is flushed */
+template <typename Message> void SendFrame(TCPSocket &socket, u64 sequenceNumber, std::span<Message const> messages)
+{
+    DCHECK_FATAL(!messages.empty() && messages.size() <= ME_MAX_FRAME_MESSAGES, "A frame carries 1 to ",
+                 ME_MAX_FRAME_MESSAGES, " messages, not ", messages.size());
+
+    const OMFrameHeader header{sequenceNumber, static_cast<u8>(messages.size())};
+    socket.Send(&header, sizeof(header));
+    socket.SendInPlace(messages.data(), messages.size_bytes());
+}
+
+/* Calls onFrame(header, messages) for every complete frame at the start of data and returns the number of bytes they
+ * take, what follows being a frame still on its way. A header announcing no messages or more than
+ * ME_MAX_FRAME_MESSAGES leaves the rest of the stream impossible to follow: parsing stops there and malformed is set */
+template <typename Message, typename OnFrame>
+std::size_t ParseFrames(char const *data, std::size_t size, bool &malformed, OnFrame &&onFrame)
+{
+    static_assert(alignof(Message) == 1, "Messages are read in place, they must be packed");
+
+    malformed = false;
+    std::size_t consumed = 0;
+    while (size - consumed >= sizeof(OMFrameHeader))
+    {
+        OMFrameHeader header;
+        std::memcpy(&header, data + consumed, sizeof(header));
+        if (header.numMessages == 0 || header.numMessages > ME_MAX_FRAME_MESSAGES) [[unlikely]]
+        {
+            malformed = true;
+            break;
+        }
+
+        const auto frameSize = GetFrameSize<Message>(header.numMessages);
+        if (size - consumed < frameSize)
+        {
+            break;
+        }
+
+        auto messages = reinterpret_cast<Message const *>(data + consumed + sizeof(header));
+        onFrame(header, std::span<Message const>(messages, header.numMessages));
+        consumed += frameSize;
+    }
+    return consumed;
+}
+
+} // namespace Exchange
@@ -0,0 +1,256 @@
+#include "OrderEntryThread.h"
+#include "Check.h"
+#include "Logger.h"
+#include "TCPServer.h"
+#include "ThreadUtils.h"
+#include "exchange/order_server/ClientRequest.h"
+#include "exchange/order_server/ClientResponse.h"
+#include "exchange/order_server/OrderEntryFrame.h"
+
+#include <cstring>
+#include <span>
+
+namespace Exchange
+{
+OrderEntryThread::OrderEntryThread(u32 index, ClientOwners &clientOwners)
+    : mIndex(index), mClientOwners(clientOwners), mClientRequests(ME_MAX_CLIENT_UPDATES),
+      mClientResponses(ME_MAX_CLIENT_UPDATES), mLogger("order_server_" + std::to_string(index) + ".log"),
+      mTCPServer(mLogger)
+{
+    mClientIdToNextResponseSequenceNumber.fill(1);
+    mClientIdToNextRequestSequenceNumber.fill(1);
+    mClientIdToSocket.fill(nullptr);
+
+    mTCPServer.socketBufferSize = ME_ORDER_ENTRY_BUFFER_SIZE;
+    mTCPServer.recvCallback = [this](auto socket, auto rxTime) { RecvCallback(socket, rxTime); };
+    mTCPServer.recvFinishedCallback = [this]() { RecvFinishCallback(); };
+    mTCPServer.disconnectCallback = [this](auto socket) { DisconnectCallback(socket); };
+}
+
+OrderEntryThread::~OrderEntryThread()
+{
+    Stop();
+}
+
+void OrderEntryThread::Start(std::string const &iface, i32 port)
+{
+    mTCPServer.Listen(iface, port);
+
+    mShouldStop = false;
+    mRunningThread = CreateAndStartThread(-1, "Exchange/OrderEntry" + std::to_string(mIndex), [this]() { Run(); });
+    CHECK_FATAL(mRunningThread != nullptr, "Couldn't start order entry thread ", mIndex);
+}
+
+void OrderEntryThread::Stop()
+{
+    mShouldStop = true;
+    if (mRunningThread && mRunningThread->joinable())
+    {
+        mRunningThread->join();
+    }
+    mRunningThread.reset();
+
+    /* Frees the port for the next listener */
+    mTCPServer.Destroy();
+}
+
+void OrderEntryThread::Run()
+{
+    while (!mShouldStop)
+    {
+        mTCPServer.Poll();
+        mTCPServer.RecvAndSend();
+
+        SendClientResponses();
+    }
+}
+
+void OrderEntryThread::SendClientResponses()
+{
+    /* A client's responses are numbered in the order they are sent, whichever shard they come from. Consecutive
+       responses to the same client go out as one frame */
+    auto clientResponses = mClientResponses.GetNextReadSpan(ME_MAX_CLIENT_UPDATES);
+    for (std::size_t i = 0; i < clientResponses.size();)
+    {
+        const auto clientId = clientResponses[i].clientId;
+        std::size_t end = i + 1;
+        while (end < clientResponses.size() && end - i < ME_MAX_FRAME_MESSAGES &&
+               clientResponses[end].clientId == clientId)
+        {
+            ++end;
+        }
+        std::span<MEClientResponse const> frame = clientResponses.subspan(i, end - i);
+        i = end;
+
+        /* Responses still on their way when a client disconnects are dropped */
+        auto socket = mClientIdToSocket[clientId];
+        if (socket == nullptr) [[unlikely]]
+        {
+            mLogger.Log("Dropping ", frame.size(), " response(s) for disconnected client ", clientId, "\n");
+            continue;
+        }
+
+        auto &nextOutgoingSeqNum = mClientIdToNextResponseSequenceNumber[clientId];
+        QLOG_TRACE(mLogger, "Sending {} response(s) to client {} with sequence number {}\n", frame.size(), clientId,
+                   nextOutgoingSeqNum);
+        SendFrame(*socket, nextOutgoingSeqNum, frame);
+
+        /* Advance to the next frame */
+        nextOutgoingSeqNum++;
+    }
+
+    /* The frames point into the queue, they are written out before the slots are given back */
+    if (!clientResponses.empty())
+    {
+        mTCPServer.Flush();
+        mClientResponses.UpdateReadIndex(clientResponses.size());
+    }
+}
+
+void OrderEntryThread::RecvCallback(TCPSocket *socket, Nanos rxTime)
+{
+    auto received = socket->recvBuffer.GetReadSpan();
+    QLOG_TRACE(mLogger, "Receiving socket: {}; length: {}; rxTime: {}\n", socket->socket, received.size(), rxTime);
+
+    bool malformed = false;
+    const auto consumed = ParseFrames<MEClientRequest>(
+        received.data(), received.size(), malformed,
+        [&](OMFrameHeader const &header, std::span<MEClientRequest const> requests) {
+            RecvFrame(socket, rxTime, header, requests);
+        });
+
+    if (malformed) [[unlikely]]
+    {
+        /* There is no telling where the next frame starts, drop everything received after the last good one */
+        mLogger.Log("Malformed frame from socket ", socket->socket, ", dropping ", received.size() - consumed,
+                    " bytes\n");
+        socket->recvBuffer.UpdateReadIndex(received.size());
+        return;
+    }
+
+    /* A partial frame stays where it is, the rest of it lands right after */
+    socket->recvBuffer.UpdateReadIndex(consumed);
+}
+
+/* A frame is checked as a whole: one client, the expected sequence number. Its requests are then sequenced together
+ * and in order */
+void OrderEntryThread::RecvFrame(TCPSocket *socket, Nanos rxTime, OMFrameHeader const &header,
+                                 std::span<MEClientRequest const> requests)
+{
+    const u64 sequenceNumber = header.sequenceNumber;
+    const auto clientId = requests.front().clientId;
+    QLOG_TRACE(mLogger, "Received frame {} of client {} with {} request(s)\n", sequenceNumber, clientId,
+               requests.size());
+
+    if (clientId >= ME_MAX_NUM_CLIENTS) [[unlikely]]
+    {
+        mLogger.Log("This frame is invalid as client id ", clientId, " is out of range\n");
+        return;
+    }
+
+    for (auto const &request : requests)
+    {
+        if (request.clientId != clientId) [[unlikely]]
+        {
+            mLogger.Log("This frame is invalid as it mixes the requests of clients ", clientId, " and ",
+                        request.clientId, "\n");
+            return;
+        }
+        if (request.type == ClientRequestType::CHECKPOINT) [[unlikely]]
+        {
+            mLogger.Log("This frame is invalid as client ", clientId, " sent a checkpoint request\n");
+            return;
+        }
+    }
+
+    if (mClientIdToSocket[clientId] == nullptr) [[unlikely]]
+    {
+        /* First time we see this client => save it's client id, unless it is logged in on another thread */
+        u32 owner = NO_OWNER;
+        if (!mClientOwners[clientId].compare_exchange_strong(owner, mIndex))
+        {
+            mLogger.Log("This frame is invalid as client ", clientId, " is connected to order entry thread ", owner,
+                        "\n");
+            return;
+        }
+        mClientIdToSocket[clientId] = socket;
+    }
+
+    if (mClientIdToSocket[clientId] != socket) [[unlikely]]
+    {
+        /* Client id is different than what was expected */
+        mLogger.Log("This frame is invalid as the client id does not match the expected client id \n");
+        return;
+    }
+
+    auto &expectedSequenceNumber = mClientIdToNextRequestSequenceNumber[clientId];
+    if (expectedSequenceNumber != sequenceNumber)
+    {
+        mLogger.Log("This frame is invalid as sequence number does not match the expected number (",
+                    expectedSequenceNumber, " != ", sequenceNumber, ")\n");
+        return;
+    }
+    ++expectedSequenceNumber;
+
+    for (auto const &request : requests)
+    {
+        AddClientRequest(rxTime, request);
+    }
+}
+
+void OrderEntryThread::AddClientRequest(Nanos recvTime, MEClientRequest const &request)
+{
+    /* When the sequencer is a whole queue behind, what was written so far is published and we wait for room. The
+       sequencer may itself be waiting to route responses to us, so they are sent meanwhile */
+    auto slot = mClientRequests.TryGetNextWriteTo(mPendingClientRequests);
+    if (slot == nullptr) [[unlikely]]
+    {
+        mClientRequests.UpdateWriteIndex(mPendingClientRequests);
+        mPendingClientRequests = 0;
+        while ((slot = mClientRequests.TryGetNextWriteTo()) == nullptr && !mShouldStop)
+        {
+            SendClientResponses();
+        }
+        if (slot == nullptr)
+        {
+            mLogger.Log("Dropping a request of client ", request.clientId, " while stopping\n");
+            return;
+        }
+    }
+    *slot = {recvTime, request};
+    ++mPendingClientRequests;
+}
+
+void OrderEntryThread::RecvFinishCallback()
+{
+    mClientRequests.UpdateWriteIndex(mPendingClientRequests);
+    mPendingClientRequests = 0;
+}
+
+/* The orders of a client that lost its session would rest with nobody watching them, so they are all cancelled. The
+ * client can log in again afresh, on any thread, its sequence numbers start over */
+void OrderEntryThread::DisconnectCallback(TCPSocket *socket)
+{
+    for (ClientId clientId = 0; clientId < ME_MAX_NUM_CLIENTS; ++clientId)
+    {
+        if (mClientIdToSocket[clientId] != socket)
+        {
+            continue;
+        }
+
+        mLogger.Log("Client ", clientId, " disconnected, cancelling its orders. Send queue high water mark = ",
+                    socket->GetSendQueueHighWaterMark(), " bytes\n");
+        const MEClientRequest massCancel{.type = ClientRequestType::MASS_CANCEL,
+                                         .clientId = clientId,
+                                         .tickerId = TickerId_INVALID,
+                                         .side = Side::INVALID};
+        AddClientRequest(GetCurrentNanos(), massCancel);
+
+        mClientIdToSocket[clientId] = nullptr;
+        mClientIdToNextRequestSequenceNumber[clientId] = 1;
+        mClientIdToNextResponseSequenceNumber[clientId] = 1;
+        mClientOwners[clientId].store(NO_OWNER, std::memory_order_release);
+    }
+}
+
+} // namespace Exchange
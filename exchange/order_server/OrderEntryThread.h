@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Limits.h"
+#include "Logger.h"
+#include "SafeQueue.h"
+#include "TCPSocket.h"
+#include "TimeUtils.h"
+#include "common/TCPServer.h"
+#include "exchange/order_server/ClientRequest.h"
+#include "exchange/order_server/ClientResponse.h"
+#include "exchange/order_server/OrderEntryFrame.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+
+namespace Exchange
+{
+/* A request and the time its packet was received, on its way from an order entry thread to the sequencer */
+struct TimedClientRequest
+{
+    Nanos recvTime = 0;
+    MEClientRequest request;
+};
+
+using TimedClientRequestQueue = SafeQueue<TimedClientRequest>;
+
+/* Order entry thread each client id is logged in on, shared by the threads so a client has a single session */
+using ClientOwners = std::array<std::atomic<u32>, ME_MAX_NUM_CLIENTS>;
+
+/* One of the order server's I/O threads. It accepts on a SO_REUSEPORT listener of its own, so the kernel spreads the
+ * connections over the threads, and owns the sessions of the clients that connect to it: it reads and checks their
+ * frames, passes the requests to the sequencer and writes the responses the sequencer routes back to it */
+class OrderEntryThread
+{
+public:
+    static constexpr u32 NO_OWNER = ~u32(0);
+
+    OrderEntryThread(u32 index, ClientOwners &clientOwners);
+    ~OrderEntryThread();
+
+    OrderEntryThread() = delete;
+    OrderEntryThread(const OrderEntryThread &) = delete;
+    OrderEntryThread(const OrderEntryThread &&) = delete;
+    OrderEntryThread &operator=(const OrderEntryThread &) = delete;
+    OrderEntryThread &operator=(const OrderEntryThread &&) = delete;
+
+    /* Listens before returning, connections are accepted from then on */
+    void Start(std::string const &iface, i32 port);
+    void Stop();
+
+    /* Read by the sequencer, in the order the thread received them */
+    TimedClientRequestQueue *GetClientRequests()
+    {
+        return &mClientRequests;
+    }
+
+    /* Filled by the sequencer with the responses of this thread's clients */
+    MEClientResponseQueue *GetClientResponses()
+    {
+        return &mClientResponses;
+    }
+
+private:
+    void Run();
+
+    void RecvCallback(TCPSocket *socket, Nanos rxTime);
+    void RecvFrame(TCPSocket *socket, Nanos rxTime, OMFrameHeader const &header,
+                   std::span<MEClientRequest const> requests);
+    void RecvFinishCallback();
+    void DisconnectCallback(TCPSocket *socket);
+
+    void AddClientRequest(Nanos recvTime, MEClientRequest const &request);
+    void SendClientResponses();
+
+private:
+    u32 mIndex;
+    ClientOwners &mClientOwners;
+
+    TimedClientRequestQueue mClientRequests;
+    /* Written but not published yet, they go out together once every socket has been read */
+    std::size_t mPendingClientRequests = 0;
+    MEClientResponseQueue mClientResponses;
+
+    std::array<TCPSocket *, ME_MAX_NUM_CLIENTS> mClientIdToSocket;
+
+    std::array<u64, ME_MAX_NUM_CLIENTS> mClientIdToNextResponseSequenceNumber;
+    std::array<u64, ME_MAX_NUM_CLIENTS> mClientIdToNextRequestSequenceNumber;
+
+    volatile bool mShouldStop = true;
+    std::unique_ptr<std::thread> mRunningThread;
+
+    QuickLogger mLogger;
+    TCPServer mTCPServer;
+};
+
+} // namespace Exchange
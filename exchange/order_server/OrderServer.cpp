@@ -1,27 +1,40 @@
 #include "OrderServer.h"
 #include "Check.h"
 #include "Logger.h"
-#include "TCPServer.h"
 #include "ThreadUtils.h"
 #include "exchange/order_server/ClientRequest.h"
 #include "exchange/order_server/ClientResponse.h"
 #include "exchange/order_server/FIFOSequencer.h"
-
-#include <cstring>
+#include "exchange/order_server/Journal.h"
+#include "exchange/order_server/OrderEntryThread.h"
 
 namespace Exchange
 {
-OrderServer::OrderServer(MEClientRequestQueue *clientRequests, MEClientResponseQueue *clientResponses,
-                         std::string const &iface, i32 port)
-    : mIFace(iface), mPort(port), mClientResponses(clientResponses), mLogger("order_server.log"), mTCPServer(mLogger),
-      mSequencer(clientRequests, &mLogger)
+OrderServer::OrderServer(std::vector<MEClientRequestQueue *> const &clientRequests, ShardConfig const &shardConfig,
+                         std::vector<MEClientResponseQueue *> const &clientResponses, std::string const &iface,
+                         i32 port, std::string const &journalDirectory, u64 firstReplaySequenceNumber,
+                         u32 numIOThreads)
+    : mIFace(iface), mPort(port), mJournalDirectory(journalDirectory),
+      mFirstReplaySequenceNumber(firstReplaySequenceNumber), mClientRequests(clientRequests),
+      mClientResponses(clientResponses), mLogger("order_server.log"),
+      mJournal(journalDirectory.empty() ? nullptr : std::make_unique<Journal>(journalDirectory)),
+      mSequencer(clientRequests, shardConfig, &mLogger, mJournal.get())
 {
-    mClientIdToNextResponseSequenceNumber.fill(1);
-    mClientIdToNextRequestSequenceNumber.fill(1);
-    mClientIdToSocket.fill(nullptr);
+    CHECK_FATAL(numIOThreads > 0 && numIOThreads <= ME_MAX_ORDER_ENTRY_THREADS, "Invalid number of I/O threads ",
+                numIOThreads);
+
+    /* The shards only read their requests while their responses are taken away */
+    mSequencer.waitCallback = [this]() { RouteClientResponses(); };
 
-    mTCPServer.recvCallback = [this](auto socket, auto rxTime) { RecvCallback(socket, rxTime); };
-    mTCPServer.recvFinishedCallback = [this]() { RecvFinishCallback(); };
+    mClientIdToIOThread.fill(OrderEntryThread::NO_OWNER);
+    for (auto &owner : mClientOwners)
+    {
+        owner = OrderEntryThread::NO_OWNER;
+    }
+    for (u32 i = 0; i < numIOThreads; ++i)
+    {
+        mIOThreads.push_back(std::make_unique<OrderEntryThread>(i, mClientOwners));
+    }
 }
 
 OrderServer::~OrderServer()
@@ -32,90 +45,162 @@ OrderServer::~OrderServer()
 void OrderServer::Start()
 {
     mShouldStop = false;
-    mTCPServer.Listen(mIFace, mPort);
+    if (mJournal != nullptr)
+    {
+        ReplayJournal();
+        mJournal->Start();
+        mNextCheckpoint = GetCurrentNanos() + ME_CHECKPOINT_INTERVAL_SECS * NANOS_TO_SECS;
+    }
 
     mRunningThread = CreateAndStartThread(-1, "Exchange/OrderServer", [this]() { Run(); });
     CHECK_FATAL(mRunningThread != nullptr, "Couldn't start order server thread");
+
+    for (auto &ioThread : mIOThreads)
+    {
+        ioThread->Start(mIFace, mPort);
+    }
 }
 
 void OrderServer::Run()
 {
     while (!mShouldStop)
     {
-        /* Poll the server and process sockets */
-        mTCPServer.Poll();
-        mTCPServer.RecvAndSend();
+        SequenceClientRequests();
+        RouteClientResponses();
 
-        while (mClientResponses->GetSize() != 0)
+        /* A shard whose queue is full doesn't get the checkpoint request, it is tried again on the next pass */
+        if (mJournal != nullptr && GetCurrentNanos() >= mNextCheckpoint && mSequencer.Checkpoint())
         {
-            auto clientResponse = mClientResponses->GetNextRead();
-
-            auto &nextOutgoingSeqNum = mClientIdToNextResponseSequenceNumber[clientResponse->clientId];
-            mLogger.Log("Sending response ", clientResponse->ToString(), " with sequence number ", nextOutgoingSeqNum,
-                        "\n");
-
-            /* Get the queue and send the data */
-            CHECK_FATAL(mClientIdToSocket[clientResponse->clientId] != nullptr, "Can't send response to a null socket");
-            auto &socket = mClientIdToSocket[clientResponse->clientId];
-            socket->Send(&nextOutgoingSeqNum, sizeof(nextOutgoingSeqNum));
-            socket->Send(clientResponse, sizeof(*clientResponse));
-
-            /* Advance to the next response */
-            mClientResponses->UpdateReadIndex();
-            nextOutgoingSeqNum++;
+            mNextCheckpoint = GetCurrentNanos() + ME_CHECKPOINT_INTERVAL_SECS * NANOS_TO_SECS;
         }
     }
 }
 
-void OrderServer::Stop()
+/* Every I/O thread hands over its requests in the order it read them, the sequencer merges them by receive time */
+void OrderServer::SequenceClientRequests()
 {
-    mShouldStop = true;
-    mRunningThread->join();
+    for (u32 ioThread = 0; ioThread < mIOThreads.size(); ++ioThread)
+    {
+        auto clientRequests = mIOThreads[ioThread]->GetClientRequests();
+        auto requests = clientRequests->GetNextReadSpan(ME_MAX_CLIENT_UPDATES);
+        for (auto const &request : requests)
+        {
+            mClientIdToIOThread[request.request.clientId] = ioThread;
+            mSequencer.AddClientRequest(request.recvTime, request.request);
+        }
+        if (!requests.empty())
+        {
+            clientRequests->UpdateReadIndex(requests.size());
+        }
+    }
+    mSequencer.SequenceAndPublish();
 }
 
-void OrderServer::RecvCallback(TCPSocket *socket, Nanos rxTime)
+/* An I/O thread waits for the sequencer when its request queue is full, so waiting here for room in its response queue
+ * could wait forever. A shard's responses stop at the first one that doesn't fit, the rest is routed on a later pass */
+void OrderServer::RouteClientResponses()
 {
-    mLogger.Log("Receiving socket: ", socket->socket, "; length: ", socket->nextRecvIndex, "; rxTime: ", rxTime, "\n");
-    if (socket->nextRecvIndex >= sizeof(OMClientRequest))
+    std::array<std::size_t, ME_MAX_ORDER_ENTRY_THREADS> numRouted{};
+    for (auto clientResponseQueue : mClientResponses)
     {
-        u64 i = 0;
-        for (; i + sizeof(OMClientRequest) <= socket->nextRecvIndex; i += sizeof(OMClientRequest))
+        auto clientResponses = clientResponseQueue->GetNextReadSpan(ME_MAX_CLIENT_UPDATES);
+        std::size_t numRead = 0;
+        for (; numRead < clientResponses.size(); ++numRead)
         {
-            auto request = reinterpret_cast<OMClientRequest *>(socket->recvBuffer.data() + i);
-            mLogger.Log("Received request: ", request->ToString(), "\n");
-
-            if (mClientIdToSocket[request->clientRequest.clientId] == nullptr) [[unlikely]]
-            {
-                /* First time we see this client => save it's client id */
-                mClientIdToSocket[request->clientRequest.clientId] = socket;
-            }
-
-            if (mClientIdToSocket[request->clientRequest.clientId] != socket) [[unlikely]]
+            auto const &response = clientResponses[numRead];
+            const auto ioThread = response.clientId < ME_MAX_NUM_CLIENTS ? mClientIdToIOThread[response.clientId]
+                                                                         : OrderEntryThread::NO_OWNER;
+            if (ioThread == OrderEntryThread::NO_OWNER) [[unlikely]]
             {
-                /* Client id is different than what was expected */
-                mLogger.Log("This request is invalid as the client id does not match the expected client id \n");
+                QLOG_TRACE(mLogger, "Dropping a response for client {} which never connected\n", response.clientId);
                 continue;
             }
 
-            auto &expectedSequenceNumber = mClientIdToNextRequestSequenceNumber[request->clientRequest.clientId];
-            if (expectedSequenceNumber != request->sequenceNumber)
+            /* When the I/O thread is a whole queue behind, what was routed so far is published to make room */
+            auto queue = mIOThreads[ioThread]->GetClientResponses();
+            auto slot = queue->TryGetNextWriteTo(numRouted[ioThread]);
+            if (slot == nullptr) [[unlikely]]
             {
-                mLogger.Log("This request is invalid as sequence number does not match the expected number (",
-                            expectedSequenceNumber, " != ", request->sequenceNumber, ")\n");
-                continue;
+                queue->UpdateWriteIndex(numRouted[ioThread]);
+                numRouted[ioThread] = 0;
+                slot = queue->TryGetNextWriteTo();
+                if (slot == nullptr)
+                {
+                    break;
+                }
             }
-            ++expectedSequenceNumber;
+            *slot = response;
+            ++numRouted[ioThread];
+        }
 
-            mSequencer.AddClientRequest(rxTime, request->clientRequest);
+        if (numRead != 0)
+        {
+            clientResponseQueue->UpdateReadIndex(numRead);
+        }
+    }
+
+    for (u32 ioThread = 0; ioThread < mIOThreads.size(); ++ioThread)
+    {
+        if (numRouted[ioThread] != 0)
+        {
+            mIOThreads[ioThread]->GetClientResponses()->UpdateWriteIndex(numRouted[ioThread]);
         }
-        memcpy(socket->recvBuffer.data(), socket->recvBuffer.data() + i, socket->nextRecvIndex - i);
-        socket->nextRecvIndex -= i;
     }
 }
 
-void OrderServer::RecvFinishCallback()
+/* Feeds the journal of the previous run, from where the books' checkpoint stopped, to the matching shards before any
+ * client can connect, so the books are back to where they were when the first new request arrives. The responses go
+ * nowhere, their clients are gone */
+void OrderServer::ReplayJournal()
 {
-    mSequencer.SequenceAndPublish();
+    JournalReader reader(mJournalDirectory, mFirstReplaySequenceNumber);
+    u64 numReplayed = 0;
+    for (auto record = reader.Next(); record != nullptr; record = reader.Next())
+    {
+        while (!mSequencer.TryRoute(record->request))
+        {
+            RouteClientResponses();
+        }
+        ++numReplayed;
+    }
+    CHECK_FATAL(reader.GetNextSequenceNumber() == mJournal->GetNextSequenceNumber(),
+                "The journal was replayed up to sequence number ", reader.GetNextSequenceNumber(),
+                " but continues at ", mJournal->GetNextSequenceNumber());
+
+    /* A shard has published everything for the requests it took off its queue, so once the queues are empty the last
+       responses can be drained before a client that reconnects could see them */
+    for (auto clientRequestQueue : mClientRequests)
+    {
+        while (clientRequestQueue->GetSize() != 0)
+        {
+            RouteClientResponses();
+        }
+    }
+    RouteClientResponses();
+
+    mLogger.Log("Replayed ", numReplayed, " journaled request(s)\n");
+}
+
+/* The sequencer stage goes first: it stops while the I/O threads still drain what it routed to them. What they read
+ * after that is not sequenced any more */
+void OrderServer::Stop()
+{
+    mShouldStop = true;
+    if (mRunningThread && mRunningThread->joinable())
+    {
+        mRunningThread->join();
+    }
+    mRunningThread.reset();
+
+    for (auto &ioThread : mIOThreads)
+    {
+        ioThread->Stop();
+    }
+
+    if (mJournal != nullptr)
+    {
+        mJournal->Stop();
+    }
 }
 
-} // namespace Exchange
\ No newline at end of file
+} // namespace Exchange
@@ -2,23 +2,32 @@
 
 #include "Limits.h"
 #include "Logger.h"
-#include "TCPSocket.h"
 #include "TimeUtils.h"
-#include "common/TCPServer.h"
 #include "exchange/order_server/ClientRequest.h"
 #include "exchange/order_server/ClientResponse.h"
 #include "exchange/order_server/FIFOSequencer.h"
+#include "exchange/order_server/Journal.h"
+#include "exchange/order_server/OrderEntryThread.h"
 #include <array>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace Exchange
 {
 
+/* Order entry is spread over numIOThreads OrderEntryThread, each with its own listener on the port and its own
+ * clients. The order server's thread is the sequencer stage between them and the matching shards: it merges the
+ * requests of every I/O thread into one sequence and routes each response back to the thread its client is on */
 class OrderServer
 {
 public:
-    OrderServer(MEClientRequestQueue *clientRequests, MEClientResponseQueue *clientResponses, std::string const &iface,
-                i32 port);
+    /* Takes the request and response queues of every matching shard. With a journal directory, every sequenced request
+     * is journaled there, Start first replays what an earlier run left in it from firstReplaySequenceNumber on, and the
+     * shards are asked to checkpoint their books every ME_CHECKPOINT_INTERVAL_SECS */
+    OrderServer(std::vector<MEClientRequestQueue *> const &clientRequests, ShardConfig const &shardConfig,
+                std::vector<MEClientResponseQueue *> const &clientResponses, std::string const &iface, i32 port,
+                std::string const &journalDirectory = "", u64 firstReplaySequenceNumber = 1, u32 numIOThreads = 1);
     ~OrderServer();
 
     OrderServer() = delete;
@@ -31,21 +40,24 @@ public:
     void Stop();
 
 private:
-    void RecvCallback(TCPSocket *socket, Nanos rxTime);
-    void RecvFinishCallback();
+    void SequenceClientRequests();
+    void RouteClientResponses();
+    void ReplayJournal();
 
     void Run();
 
 private:
     std::string mIFace;
     i32 mPort = 0;
+    std::string mJournalDirectory;
+    u64 mFirstReplaySequenceNumber = 1;
+    Nanos mNextCheckpoint = 0;
 
-    MEClientResponseQueue *mClientResponses = nullptr;
+    std::vector<MEClientRequestQueue *> mClientRequests;
+    std::vector<MEClientResponseQueue *> mClientResponses;
 
-    std::array<TCPSocket *, ME_MAX_NUM_CLIENTS> mClientIdToSocket;
-
-    std::array<u64, ME_MAX_NUM_CLIENTS> mClientIdToNextResponseSequenceNumber;
-    std::array<u64, ME_MAX_NUM_CLIENTS> mClientIdToNextRequestSequenceNumber;
+    /* I/O thread the last request of each client came from, its responses go there */
+    std::array<u32, ME_MAX_NUM_CLIENTS> mClientIdToIOThread;
 
     volatile bool mShouldStop = false;
 
@@ -53,8 +65,11 @@ private:
 
     QuickLogger mLogger;
 
-    TCPServer mTCPServer;
+    std::unique_ptr<Journal> mJournal;
     FIFOSequencer mSequencer;
+
+    ClientOwners mClientOwners;
+    std::vector<std::unique_ptr<OrderEntryThread>> mIOThreads;
 };
 
 } // namespace Exchange
\ No newline at end of file
@@ -25,6 +25,7 @@ int main(i32 argc, char **argv)
     auto algoType = StringToAlgorithmType(argv[2]);
     CHECK_FATAL(algoType != AlgorithmType::INVALID, "Invalid algorithm type");
 
+    LogService::SetCore(HOUSEKEEPING_CORE);
     QuickLogger logger("trading_main_" + std::to_string(clientId) + ".log");
 
     Exchange::MEClientRequestQueue clientRequests(ME_MAX_CLIENT_UPDATES);
@@ -127,12 +127,11 @@ void MarketDataConsumer::CheckSnapshotSync()
         return;
     }
 
-    for (auto &itr : finalEvents)
+    for (u32 i = 0; i < finalEvents.size(); ++i)
     {
-        auto nextWrite = mMarketUpdates->GetNextWriteTo();
-        *nextWrite = itr;
-        mMarketUpdates->UpdateWriteIndex();
+        *mMarketUpdates->GetNextWriteTo(i) = finalEvents[i];
     }
+    mMarketUpdates->UpdateWriteIndex(finalEvents.size());
 
     mInRecovery = false;
     mSnapshotQueuedMessages.clear();
@@ -183,8 +182,8 @@ void MarketDataConsumer::RecvCallback(MCastSocket *socket)
         {
             auto marketUpdate = reinterpret_cast<Exchange::MPDMarketUpdate *>(socket->inboundData.data() + i);
 
-            mLogger.Log("Received market update: ", marketUpdate->ToString(), " on ",
-                        isSnapshot ? "snapshot" : "incremental", " socket\n");
+            QLOG_TRACE(mLogger, "Received market update: {} on {} socket\n", marketUpdate->ToString(),
+                       isSnapshot ? "snapshot" : "incremental");
 
             const bool alreadyInRecovery = mInRecovery;
             mInRecovery = alreadyInRecovery || marketUpdate->sequenceNumber != mNextExpectedSequenceNumber;
@@ -193,8 +192,8 @@ void MarketDataConsumer::RecvCallback(MCastSocket *socket)
             {
                 if (!alreadyInRecovery) [[unlikely]]
                 {
-                    mLogger.Log("Found some packet drops ;( Sequence number expected ", mNextExpectedSequenceNumber,
-                                " but found ", marketUpdate->sequenceNumber, "\n");
+                    QLOG_WARNING(mLogger, "Found some packet drops ;( Sequence number expected {} but found {}\n",
+                                 mNextExpectedSequenceNumber, marketUpdate->sequenceNumber);
                     StartSnaphotSync();
                 }
 
@@ -1,7 +1,11 @@
 #include "OrderGateway.h"
+#include "Limits.h"
 #include "exchange/order_server/ClientResponse.h"
+#include "exchange/order_server/OrderEntryFrame.h"
 
+#include <algorithm>
 #include <cstring>
+#include <span>
 
 namespace Trading
 {
@@ -26,54 +30,71 @@ void OrderGateway::Run()
     {
         mSocket.RecvAndSend();
 
-        while (mRequests->GetSize() > 0)
+        /* Whatever the trade engine queued since the last pass goes out in as few frames as possible */
+        auto requests = mRequests->GetNextReadSpan(ME_MAX_CLIENT_UPDATES);
+        for (std::size_t i = 0; i < requests.size(); i += ME_MAX_FRAME_MESSAGES)
         {
-            auto request = mRequests->GetNextRead();
+            std::span<Exchange::MEClientRequest const> frame =
+                requests.subspan(i, std::min<std::size_t>(ME_MAX_FRAME_MESSAGES, requests.size() - i));
+            QLOG_TRACE(mLogger, "Sending frame {} with {} request(s)\n", mNextOutgoingSequenceNumber, frame.size());
 
-            mLogger.Log("Sending request with id: ", mNextOutgoingSequenceNumber, ": ", request->ToString(), "\n");
+            Exchange::SendFrame(mSocket, mNextOutgoingSequenceNumber, frame);
 
-            mSocket.Send(&mNextOutgoingSequenceNumber, sizeof(mNextOutgoingSequenceNumber));
-            mSocket.Send(&request, sizeof(Exchange::MEClientRequest));
-
-            mRequests->UpdateReadIndex();
             mNextOutgoingSequenceNumber++;
         }
+
+        /* The frames point into the queue, they are written out before the slots are given back */
+        if (!requests.empty())
+        {
+            mSocket.Flush();
+            mRequests->UpdateReadIndex(requests.size());
+        }
     }
 }
 
 void OrderGateway::RecvCallback(TCPSocket *socket, Nanos rxTime)
 {
-    if (socket->nextRecvIndex >= sizeof(Exchange::OMClientResponse))
-    {
-        u64 i = 0;
-        for (; i + sizeof(Exchange::OMClientResponse) <= socket->nextRecvIndex; i += sizeof(Exchange::OMClientResponse))
-        {
-            auto response = reinterpret_cast<Exchange::OMClientResponse *>(socket->recvBuffer.data() + i);
-            mLogger.Log("Received response from server: ", response->ToString(), "\n");
+    auto received = socket->recvBuffer.GetReadSpan();
+    bool malformed = false;
+    const auto consumed = Exchange::ParseFrames<Exchange::MEClientResponse>(
+        received.data(), received.size(), malformed,
+        [&](Exchange::OMFrameHeader const &header, std::span<Exchange::MEClientResponse const> responses) {
+            const u64 sequenceNumber = header.sequenceNumber;
+            QLOG_TRACE(mLogger, "Received frame {} with {} response(s) from server\n", sequenceNumber,
+                       responses.size());
 
-            if (response->clientResponse.clientId != mClientId)
+            if (sequenceNumber != mNextExpectedSequenceNumber)
             {
-                mLogger.Log("Received a response for a different client\n");
-                continue;
-            }
-
-            if (response->sequenceNumber != mNextExpectedSequenceNumber)
-            {
-                mLogger.Log("Incorrect sequence number received in response. Expecting ", mNextExpectedSequenceNumber,
-                            " but received ", response->sequenceNumber, "\n");
-                continue;
+                QLOG_WARNING(mLogger, "Incorrect sequence number received in response. Expecting {} but received {}\n",
+                             mNextExpectedSequenceNumber, sequenceNumber);
+                return;
             }
 
             ++mNextExpectedSequenceNumber;
 
-            auto nextWrite = mResponses->GetNextWriteTo();
-            *nextWrite = std::move(response->clientResponse);
-            mResponses->UpdateWriteIndex();
-        }
+            for (auto const &response : responses)
+            {
+                if (response.clientId != mClientId)
+                {
+                    QLOG_WARNING(mLogger, "Received a response for a different client\n");
+                    continue;
+                }
 
-        memcpy(socket->recvBuffer.data(), socket->recvBuffer.data() + i, socket->nextRecvIndex - i);
-        socket->nextRecvIndex -= i;
+                auto nextWrite = mResponses->GetNextWriteTo();
+                *nextWrite = response;
+                mResponses->UpdateWriteIndex();
+            }
+        });
+
+    if (malformed) [[unlikely]]
+    {
+        QLOG_ERROR(mLogger, "Malformed frame from server, dropping {} bytes\n", received.size() - consumed);
+        socket->recvBuffer.UpdateReadIndex(received.size());
+        return;
     }
+
+    /* A partial frame stays where it is, the rest of it lands right after */
+    socket->recvBuffer.UpdateReadIndex(consumed);
 }
 
 } // namespace Trading
\ No newline at end of file
@@ -33,7 +33,7 @@ public:
                            ((f64)bbo.bidQuantity + (f64)bbo.askQuantity);
         }
 
-        mLogger->Log("FeatureEngine::OnOrderBookUpdate() -> new fair market price is ", mMarketPrice, "\n");
+        QLOG_TRACE(*mLogger, "FeatureEngine::OnOrderBookUpdate() -> new fair market price is {}\n", mMarketPrice);
     }
 
     void OnTradeUpdate(Exchange::MEMarketUpdate *marketUpdate, MarketOrderBook *book)
@@ -45,8 +45,8 @@ public:
                 f64(marketUpdate->quantity) / (marketUpdate->side == Side::BUY ? bbo.bidQuantity : bbo.askQuantity);
         }
 
-        mLogger->Log("FeatureEngine::OnTradeUpdate() -> new aggressive trade quantity ratio is ",
-                     mAggresiveTradeQuantityRatio, "\n");
+        QLOG_TRACE(*mLogger, "FeatureEngine::OnTradeUpdate() -> new aggressive trade quantity ratio is {}\n",
+                   mAggresiveTradeQuantityRatio);
     }
 
     FeatureEngine() = delete;
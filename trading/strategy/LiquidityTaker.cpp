@@ -35,7 +35,7 @@ void LiquidityTaker::OnOrderUpdate(Exchange::MEClientResponse *clientResponse)
 
 void LiquidityTaker::OnTradeUpdate(Exchange::MEMarketUpdate *marketUpdate, MarketOrderBook *book)
 {
-    mLogger->Log("LiquidityTaker::OnTradeUpdate(marketUpdate: ", marketUpdate->ToString(), "; book\n");
+    QLOG_TRACE(*mLogger, "LiquidityTaker::OnTradeUpdate(marketUpdate: {}; book\n", marketUpdate->ToString());
 
     auto &bbo = book->GetBestBidOffer();
     auto aggresiveQuantityRatio = mFeatureEngine->GetAggresiveTradeQuantityRatio();
@@ -43,7 +43,7 @@ void LiquidityTaker::OnTradeUpdate(Exchange::MEMarketUpdate *marketUpdate, Marke
     if (bbo.bidPrice != Price_INVALID && bbo.askPrice != Price_INVALID && aggresiveQuantityRatio != Feature_INVALID)
         [[likely]]
     {
-        mLogger->Log("LiquidityTaker::OnTradeUpdate(): Found aggresive quantity ratio");
+        QLOG_TRACE(*mLogger, "LiquidityTaker::OnTradeUpdate(): Found aggresive quantity ratio\n");
 
         auto clip = mTickerConfig[marketUpdate->tickerId].clip;
         auto threshold = mTickerConfig[marketUpdate->tickerId].threshold;
@@ -21,15 +21,15 @@ MarketMaker::MarketMaker(QuickLogger *logger, TradeEngine *tradeEngine, FeatureE
 
 void MarketMaker::OnOrderBookUpdate(TickerId tickerId, Price price, Side side, const MarketOrderBook *book)
 {
-    mLogger->Log("MarketMaker::OnOrderBookUpdate(tickerId: ", tickerId, "; price: ", price,
-                 "; side: ", SideToString(side), ")\n");
+    QLOG_TRACE(*mLogger, "MarketMaker::OnOrderBookUpdate(tickerId: {}; price: {}; side: {})\n", tickerId, price,
+               SideToString(side));
 
     const auto &bbo = book->GetBestBidOffer();
     const auto fairPrice = mFeatureEngine->GetFairMarketPrice();
 
     if (bbo.bidPrice != Price_INVALID && bbo.askPrice != Price_INVALID && fairPrice != Feature_INVALID) [[likely]]
     {
-        mLogger->Log("MarketMaker::OnOrderBookUpdate() found fair price: ", fairPrice, "\n");
+        QLOG_TRACE(*mLogger, "MarketMaker::OnOrderBookUpdate() found fair price: {}\n", fairPrice);
 
         auto clip = mTickerConfig[tickerId].clip;
         auto threshold = mTickerConfig[tickerId].threshold;
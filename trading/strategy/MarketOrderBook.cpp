@@ -7,9 +7,10 @@
 namespace Trading
 {
 MarketOrderBook::MarketOrderBook(TickerId tickerId, QuickLogger *logger)
-    : mTickerId(tickerId), mOrdersAtPricePool(ME_MAX_PRICE_LEVELS), mMartketOrdersPool(ME_MAX_ORDER_IDS),
+    : mTickerId(tickerId), mOrdersAtPricePool(ME_MAX_PRICE_LEVELS), mOrders(ME_MAX_ORDER_IDS),
       mLogger(logger)
 {
+    mOrderIdToOrder.fill(OrderIndex_INVALID);
 }
 
 MarketOrderBook::~MarketOrderBook()
@@ -17,7 +18,7 @@ MarketOrderBook::~MarketOrderBook()
     mTradeEngine = nullptr;
     mBidsByPrice = nullptr;
     mAsksByPrice = nullptr;
-    mOrderIdToOrder.fill(nullptr);
+    mOrderIdToOrder.fill(OrderIndex_INVALID);
 }
 
 void MarketOrderBook::AddOrdersAtPrice(MarketOrdersAtPrice *ordersAtPrice)
@@ -85,26 +86,17 @@ void MarketOrderBook::AddOrdersAtPrice(MarketOrdersAtPrice *ordersAtPrice)
     }
 }
 
-void MarketOrderBook::AddOrder(MarketOrder *order)
+void MarketOrderBook::AddOrder(OrderIndex orderIndex)
 {
-    auto ordersAtPrice = GetOrdersAtPrice(order->price);
+    auto const &order = mOrders.Hot(orderIndex);
+    auto ordersAtPrice = GetOrdersAtPrice(order.price);
     if (ordersAtPrice == nullptr)
     {
-        order->nextOrder = nullptr;
-        order->prevOrder = nullptr;
-
-        auto newOrdersAtPrice = mOrdersAtPricePool.Allocate(order->side, order->price, order, nullptr, nullptr);
-        AddOrdersAtPrice(newOrdersAtPrice);
+        ordersAtPrice = mOrdersAtPricePool.Allocate(order.side, order.price, nullptr, nullptr);
+        AddOrdersAtPrice(ordersAtPrice);
     }
-    else
-    {
-        auto firstOrder = ordersAtPrice->firstMarketOrder;
-        firstOrder->prevOrder->nextOrder = order;
-        order->prevOrder = firstOrder->prevOrder;
-        order->nextOrder = firstOrder;
-        firstOrder->prevOrder = order;
-    }
-    mOrderIdToOrder[order->orderId] = order;
+    mOrders.PushBack(*ordersAtPrice, orderIndex);
+    mOrderIdToOrder[mOrders.Cold(orderIndex).orderId] = orderIndex;
 }
 
 void MarketOrderBook::RemoveOrdersAtPrice(Side side, Price price)
@@ -136,33 +128,18 @@ void MarketOrderBook::RemoveOrdersAtPrice(Side side, Price price)
     mOrdersAtPricePool.Deallocate(ordersAtPrice);
 }
 
-void MarketOrderBook::RemoveOrder(MarketOrder *order)
+void MarketOrderBook::RemoveOrder(OrderIndex orderIndex)
 {
-    auto ordersAtPrice = GetOrdersAtPrice(order->price);
-    if (ordersAtPrice->nextEntry == ordersAtPrice)
+    auto const &order = mOrders.Hot(orderIndex);
+    auto ordersAtPrice = GetOrdersAtPrice(order.price);
+    mOrders.Unlink(*ordersAtPrice, orderIndex);
+    if (ordersAtPrice->numOrders == 0)
     {
-        /* This means there's only one order at this price => Remove all orders at price */
-        RemoveOrdersAtPrice(order->side, order->price);
+        RemoveOrdersAtPrice(order.side, order.price);
     }
-    else
-    {
-        const auto beforeOrder = order->prevOrder;
-        const auto nextOrder = order->nextOrder;
-
-        beforeOrder->nextOrder = nextOrder;
-        nextOrder->prevOrder = beforeOrder;
-
-        if (ordersAtPrice->firstMarketOrder == order)
-        {
-            ordersAtPrice->firstMarketOrder = nextOrder;
-        }
 
-        order->prevOrder = nullptr;
-        order->nextOrder = nullptr;
-    }
-
-    mOrderIdToOrder[order->orderId] = nullptr;
-    mMartketOrdersPool.Deallocate(order);
+    mOrderIdToOrder[mOrders.Cold(orderIndex).orderId] = OrderIndex_INVALID;
+    mOrders.Deallocate(orderIndex);
 }
 
 void MarketOrderBook::UpdateBestBidOffer(bool bidUpdated, bool askUpdated)
@@ -172,12 +149,7 @@ void MarketOrderBook::UpdateBestBidOffer(bool bidUpdated, bool askUpdated)
         if (mBidsByPrice)
         {
             mBestBidOffer.bidPrice = mBidsByPrice->price;
-            mBestBidOffer.bidQuantity = mBidsByPrice->firstMarketOrder->quantity;
-            for (auto order = mBidsByPrice->firstMarketOrder->nextOrder; order != mBidsByPrice->firstMarketOrder;
-                 order = order->nextOrder)
-            {
-                mBestBidOffer.bidQuantity += order->quantity;
-            }
+            mBestBidOffer.bidQuantity = mBidsByPrice->totalQuantity;
         }
         else
         {
@@ -191,12 +163,7 @@ void MarketOrderBook::UpdateBestBidOffer(bool bidUpdated, bool askUpdated)
         if (mAsksByPrice)
         {
             mBestBidOffer.askPrice = mAsksByPrice->price;
-            mBestBidOffer.askQuantity = mAsksByPrice->firstMarketOrder->quantity;
-            for (auto order = mAsksByPrice->firstMarketOrder->nextOrder; order != mAsksByPrice->firstMarketOrder;
-                 order = order->nextOrder)
-            {
-                mBestBidOffer.askQuantity += order->quantity;
-            }
+            mBestBidOffer.askQuantity = mAsksByPrice->totalQuantity;
         }
         else
         {
@@ -213,14 +180,17 @@ void MarketOrderBook::OnMarketUpdate(Exchange::MEMarketUpdate *marketUpdate)
     switch (marketUpdate->type)
     {
     case Exchange::MarketUpdateType::ADD: {
-        auto order = mMartketOrdersPool.Allocate(marketUpdate->orderId, marketUpdate->side, marketUpdate->price,
-                                                 marketUpdate->quantity, marketUpdate->priority, nullptr, nullptr);
+        auto order = mOrders.Allocate({.price = marketUpdate->price,
+                                       .priority = marketUpdate->priority,
+                                       .quantity = marketUpdate->quantity,
+                                       .side = marketUpdate->side},
+                                      {marketUpdate->orderId});
         AddOrder(order);
         break;
     }
     case Exchange::MarketUpdateType::MODIFY: {
         auto order = mOrderIdToOrder[marketUpdate->orderId];
-        order->quantity = marketUpdate->quantity;
+        mOrders.SetQuantity(*GetOrdersAtPrice(marketUpdate->price), order, marketUpdate->quantity);
         break;
     }
     case Exchange::MarketUpdateType::CANCEL: {
@@ -228,25 +198,39 @@ void MarketOrderBook::OnMarketUpdate(Exchange::MEMarketUpdate *marketUpdate)
         RemoveOrder(order);
         break;
     }
+    case Exchange::MarketUpdateType::REPLACE: {
+        /* The level the order leaves may have been the best one */
+        (marketUpdate->side == Side::BUY ? bidUpdated : askUpdated) = true;
+        RemoveOrder(mOrderIdToOrder[marketUpdate->orderId]);
+        auto order = mOrders.Allocate({.price = marketUpdate->price,
+                                       .priority = marketUpdate->priority,
+                                       .quantity = marketUpdate->quantity,
+                                       .side = marketUpdate->side},
+                                      {marketUpdate->orderId});
+        AddOrder(order);
+        break;
+    }
     case Exchange::MarketUpdateType::TRADE: {
         mTradeEngine->OnTradeUpdate(marketUpdate, this);
         break;
     }
     case Exchange::MarketUpdateType::CLEAR: {
-        for (auto &order : mOrderIdToOrder)
+        for (auto order : mOrderIdToOrder)
         {
-            if (order)
+            if (order != OrderIndex_INVALID)
             {
-                mMartketOrdersPool.Deallocate(order);
+                mOrders.Deallocate(order);
             }
         }
-        mOrderIdToOrder.fill(nullptr);
+        mOrderIdToOrder.fill(OrderIndex_INVALID);
 
         if (mBidsByPrice)
         {
-            for (auto bid = mBidsByPrice->nextEntry; bid != mBidsByPrice; bid = bid->nextEntry)
+            for (auto bid = mBidsByPrice->nextEntry; bid != mBidsByPrice;)
             {
+                auto nextBid = bid->nextEntry;
                 mOrdersAtPricePool.Deallocate(bid);
+                bid = nextBid;
             }
             mOrdersAtPricePool.Deallocate(mBidsByPrice);
             mBidsByPrice = nullptr;
@@ -254,9 +238,11 @@ void MarketOrderBook::OnMarketUpdate(Exchange::MEMarketUpdate *marketUpdate)
 
         if (mAsksByPrice)
         {
-            for (auto ask = mAsksByPrice->nextEntry; ask != mAsksByPrice; ask = ask->nextEntry)
+            for (auto ask = mAsksByPrice->nextEntry; ask != mAsksByPrice;)
             {
+                auto nextAsk = ask->nextEntry;
                 mOrdersAtPricePool.Deallocate(ask);
+                ask = nextAsk;
             }
             mOrdersAtPricePool.Deallocate(mAsksByPrice);
             mAsksByPrice = nullptr;
@@ -273,7 +259,10 @@ void MarketOrderBook::OnMarketUpdate(Exchange::MEMarketUpdate *marketUpdate)
 
     UpdateBestBidOffer(bidUpdated, askUpdated);
 
-    mLogger->Log("MarketOrderBook::OnMarketUpdate: ", marketUpdate->ToString(), "\n");
+    QLOG_TRACE(*mLogger,
+               "MarketOrderBook::OnMarketUpdate: type {} order {} ticker {} side {} price {} priority {} quantity {}\n",
+               marketUpdate->type, marketUpdate->orderId, marketUpdate->tickerId, marketUpdate->side,
+               marketUpdate->price, marketUpdate->priority, marketUpdate->quantity);
 
     mTradeEngine->OnOrderBookUpdate(marketUpdate->tickerId, marketUpdate->price, marketUpdate->side, this);
 }
@@ -36,8 +36,8 @@ public:
     }
 
 private:
-    void AddOrder(MarketOrder *order);
-    void RemoveOrder(MarketOrder *order);
+    void AddOrder(OrderIndex orderIndex);
+    void RemoveOrder(OrderIndex orderIndex);
 
     void AddOrdersAtPrice(MarketOrdersAtPrice *ordersAtPrice);
     void RemoveOrdersAtPrice(Side side, Price price);
@@ -64,7 +64,7 @@ private:
     MarketOrdersAtPrice *mBidsByPrice = nullptr;
     MarketOrdersAtPrice *mAsksByPrice = nullptr;
 
-    MemoryPool<MarketOrder> mMartketOrdersPool;
+    MarketOrderStore mOrders;
 
     OrdersAtPriceHashMap mPriceOrdersAtPrice;
 
@@ -13,6 +13,7 @@ enum class OMOrderState : i8
     LIVE = 2,
     PENDING_CANCEL = 3,
     DEAD = 4,
+    PENDING_MODIFY = 5,
 };
 
 inline auto OMOrderStateToString(OMOrderState state) -> std::string
@@ -29,6 +30,8 @@ inline auto OMOrderStateToString(OMOrderState state) -> std::string
         return "PENDING_CANCEL";
     case Trading::OMOrderState::DEAD:
         return "DEAD";
+    case Trading::OMOrderState::PENDING_MODIFY:
+        return "PENDING_MODIFY";
     default:
         return "UNKNOWN";
     }
@@ -12,7 +12,7 @@ void OrderManager::NewOrder(OMOrder *order, TickerId tickerId, Price price, Side
 {
     Exchange::MEClientRequest request;
     {
-        request.clientId = 0; /* TODO: Fill client id */
+        request.clientId = mTradeEngine->GetClientId();
         request.orderId = mNextOrderId;
         request.type = Exchange::ClientRequestType::NEW;
         request.tickerId = tickerId;
@@ -25,14 +25,14 @@ void OrderManager::NewOrder(OMOrder *order, TickerId tickerId, Price price, Side
     *order = {tickerId, mNextOrderId, side, price, quantity, OMOrderState::PENDING_NEW};
     ++mNextOrderId;
 
-    mLogger->Log("OrderManager::NewOrder: ", order->ToString(), "\n");
+    QLOG_TRACE(*mLogger, "OrderManager::NewOrder: {}\n", order->ToString());
 }
 
 void OrderManager::CancelOrder(OMOrder *order)
 {
     Exchange::MEClientRequest request;
     {
-        request.clientId = 0; /* TODO: Fill client id */
+        request.clientId = mTradeEngine->GetClientId();
         request.orderId = order->orderId;
         request.type = Exchange::ClientRequestType::CANCEL;
         request.tickerId = order->tickerId;
@@ -43,14 +43,32 @@ void OrderManager::CancelOrder(OMOrder *order)
     mTradeEngine->SendClientRequest(&request);
 
     order->state = OMOrderState::PENDING_CANCEL;
-    mLogger->Log("OrderManager::CancelOrder: ", order->ToString(), "\n");
+    QLOG_TRACE(*mLogger, "OrderManager::CancelOrder: {}\n", order->ToString());
+}
+
+void OrderManager::ModifyOrder(OMOrder *order, Price price, Quantity quantity)
+{
+    Exchange::MEClientRequest request;
+    {
+        request.clientId = mTradeEngine->GetClientId();
+        request.orderId = order->orderId;
+        request.type = Exchange::ClientRequestType::MODIFY;
+        request.tickerId = order->tickerId;
+        request.price = price;
+        request.side = order->side;
+        request.quantity = quantity;
+    }
+    mTradeEngine->SendClientRequest(&request);
+
+    order->state = OMOrderState::PENDING_MODIFY;
+    QLOG_TRACE(*mLogger, "OrderManager::ModifyOrder: {}\n", order->ToString());
 }
 
 void OrderManager::OnOrderUpdate(Exchange::MEClientResponse *clientResponse)
 {
     /* Get the order */
     auto order = &mTickerSideOrder[clientResponse->tickerId][SideToIndex(clientResponse->side)];
-    mLogger->Log("OrderManager::OnOrderUpdate: Order: ", order->ToString(), "\n");
+    QLOG_TRACE(*mLogger, "OrderManager::OnOrderUpdate: Order: {}\n", order->ToString());
     switch (clientResponse->type)
     {
     case Exchange::ClientResponseType::ACCEPTED: {
@@ -59,6 +77,7 @@ void OrderManager::OnOrderUpdate(Exchange::MEClientResponse *clientResponse)
     }
     case Exchange::ClientResponseType::CANCELED: {
         order->state = OMOrderState::DEAD;
+        break;
     }
     case Exchange::ClientResponseType::FILLED: {
         order->quantity = clientResponse->leaves_quantity;
@@ -66,9 +85,50 @@ void OrderManager::OnOrderUpdate(Exchange::MEClientResponse *clientResponse)
         {
             order->state = OMOrderState::DEAD;
         }
+        break;
+    }
+    case Exchange::ClientResponseType::MODIFIED: {
+        /* Fills of the new price and quantity, if any, come after this */
+        if (order->orderId == clientResponse->clientOrderId)
+        {
+            order->state = OMOrderState::LIVE;
+            order->price = clientResponse->price;
+            order->quantity = clientResponse->leaves_quantity;
+        }
+        break;
+    }
+    case Exchange::ClientResponseType::MODIFY_REJECTED: {
+        /* Without a market id the order was gone, most likely filled while the request was on its way. Otherwise only
+         * the new price or quantity was refused and the order still rests where it was */
+        if (order->orderId == clientResponse->clientOrderId && order->state == OMOrderState::PENDING_MODIFY)
+        {
+            order->state =
+                clientResponse->marketOrderId == OrderId_INVALID ? OMOrderState::DEAD : OMOrderState::LIVE;
+        }
+        break;
+    }
+    case Exchange::ClientResponseType::MASS_CANCELED: {
+        /* A new order still pending was sent after the mass cancel, so it wasn't cancelled */
+        for (auto side : {Side::BUY, Side::SELL})
+        {
+            auto &sideOrder = mTickerSideOrder[clientResponse->tickerId][SideToIndex(side)];
+            if ((clientResponse->side == Side::INVALID || clientResponse->side == side) &&
+                sideOrder.state != OMOrderState::PENDING_NEW)
+            {
+                sideOrder.state = OMOrderState::DEAD;
+            }
+        }
+        break;
     }
-    case Exchange::ClientResponseType::CANCEL_REJECTED:
     case Exchange::ClientResponseType::INVALID: {
+        /* A new order the exchange refused, its price being too far from the book */
+        if (order->orderId == clientResponse->clientOrderId && order->state == OMOrderState::PENDING_NEW)
+        {
+            order->state = OMOrderState::DEAD;
+        }
+        break;
+    }
+    case Exchange::ClientResponseType::CANCEL_REJECTED: {
         break;
     }
     }
@@ -79,8 +139,24 @@ void OrderManager::MoveOrder(OMOrder *order, TickerId tickerId, Price price, Sid
     switch (order->state)
     {
     case Trading::OMOrderState::LIVE: {
-        if (order->price != price || order->quantity != qty)
+        if (order->price == price && order->quantity == qty)
+        {
+            break;
+        }
+
+        /* Requote in place. Without a price there is nothing to quote, so the order is pulled */
+        if (price == Price_INVALID)
+        {
+            CancelOrder(order);
+        }
+        else if (mRiskManager.CheckPreTradeRisk(tickerId, side, qty) == RiskCheckResult::ALLOWED) [[likely]]
+        {
+            ModifyOrder(order, price, qty);
+        }
+        else
         {
+            mLogger->Log("The risk manager didn't allow the modification of order ", OrderIdToString(order->orderId),
+                         " to price: ", PriceToString(price), "; quantity: ", QuantityToString(qty), "\n");
             CancelOrder(order);
         }
         break;
@@ -103,7 +179,8 @@ void OrderManager::MoveOrder(OMOrder *order, TickerId tickerId, Price price, Sid
         break;
     }
     case Trading::OMOrderState::PENDING_NEW:
-    case Trading::OMOrderState::PENDING_CANCEL: {
+    case Trading::OMOrderState::PENDING_CANCEL:
+    case Trading::OMOrderState::PENDING_MODIFY: {
         break;
     }
     }
@@ -24,6 +24,7 @@ public:
 
     void NewOrder(OMOrder *order, TickerId tickerId, Price price, Side side, Quantity quantity);
     void CancelOrder(OMOrder *order);
+    void ModifyOrder(OMOrder *order, Price price, Quantity quantity);
 
     void MoveOrders(TickerId tickerId, Price bidPrice, Price askPrice, Quantity tradeSize)
     {
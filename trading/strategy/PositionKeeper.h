@@ -104,7 +104,7 @@ struct PositionInfo
 
         totalPnL = unrealizedPnL + realizedPnL;
 
-        logger->Log("PositionInfo::AddFill(", clientResponse->ToString(), ")\n");
+        QLOG_TRACE(*logger, "PositionInfo::AddFill({})\n", clientResponse->ToString());
     }
 
     void UpdateBestBidOffer(BestBidOffer const *bbo, QuickLogger *logger)
@@ -128,8 +128,8 @@ struct PositionInfo
 
             if (totalPnL != oldTotalPnl)
             {
-                logger->Log("PositionInfo::UpdateBestBidOffer(", bbo->ToString(),
-                            ") results in a new total pnl: ", ToString(), "\n");
+                QLOG_TRACE(*logger, "PositionInfo::UpdateBestBidOffer({}) results in a new total pnl: {}\n",
+                           bbo->ToString(), ToString());
             }
         }
     }
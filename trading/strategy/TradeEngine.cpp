@@ -110,24 +110,24 @@ void TradeEngine::Run()
 {
     while (!mShouldStop)
     {
-        for (auto clientResponse = mResponsesQueue->GetNextRead(); clientResponse != nullptr;
-             mResponsesQueue->GetNextRead())
+        auto clientResponses = mResponsesQueue->GetNextReadSpan(ME_MAX_CLIENT_UPDATES);
+        for (auto &clientResponse : clientResponses)
         {
-            OnOrderUpdate(clientResponse);
-
-            mResponsesQueue->UpdateReadIndex();
-
-            mLastEventTime = GetCurrentNanos();
+            OnOrderUpdate(&clientResponse);
         }
 
-        for (auto marketUpdate = mMarketUpdates->GetNextRead(); marketUpdate != nullptr;
-             marketUpdate = mMarketUpdates->GetNextRead())
+        auto marketUpdates = mMarketUpdates->GetNextReadSpan(ME_MAX_MARKET_UPDATES);
+        for (auto &marketUpdate : marketUpdates)
         {
-            mTickerOrderBook[marketUpdate->tickerId]->OnMarketUpdate(marketUpdate);
+            mTickerOrderBook[marketUpdate.tickerId]->OnMarketUpdate(&marketUpdate);
+        }
 
-            mMarketUpdates->UpdateReadIndex();
+        if (!clientResponses.empty() || !marketUpdates.empty())
+        {
+            mResponsesQueue->UpdateReadIndex(clientResponses.size());
+            mMarketUpdates->UpdateReadIndex(marketUpdates.size());
 
-            mLastEventTime = GetCurrentNanos();
+            mLastEventTicks = GetCurrentTicks();
         }
     }
 }
@@ -34,9 +34,16 @@ public:
     void Start();
     void Stop();
 
+    ClientId GetClientId() const
+    {
+        return mClientId;
+    }
+
     void SendClientRequest(Exchange::MEClientRequest *clientRequest)
     {
-        mLogger.Log("Sending request: ", clientRequest->ToString(), "\n");
+        QLOG_TRACE(mLogger, "Sending request: type {} client {} ticker {} order {} side {} price {} quantity {}\n",
+                   clientRequest->type, clientRequest->clientId, clientRequest->tickerId, clientRequest->orderId,
+                   clientRequest->side, clientRequest->price, clientRequest->quantity);
 
         auto *nextWrite = mRequestsQueue->GetNextWriteTo();
         *nextWrite = std::move(*clientRequest);
@@ -49,12 +56,12 @@ public:
 
     void InitLastEventTime()
     {
-        mLastEventTime = GetCurrentNanos();
+        mLastEventTicks = GetCurrentTicks();
     }
 
     i32 SilentSeconds()
     {
-        return (GetCurrentNanos() - mLastEventTime) / NANOS_TO_SECS;
+        return TicksToDuration(GetCurrentTicks() - mLastEventTicks) / NANOS_TO_SECS;
     }
 
 public:
@@ -78,7 +85,7 @@ private:
     volatile bool mShouldStop = false;
     std::unique_ptr<std::thread> mRunningThread;
 
-    Nanos mLastEventTime = 0;
+    Ticks mLastEventTicks = 0;
 
     FeatureEngine mFeatureEngine;
 